@@ -0,0 +1,550 @@
+#ifndef ASYNC_FORWARDER_HPP
+#define ASYNC_FORWARDER_HPP
+
+#include <grpcpp/grpcpp.h>
+#include "data.grpc.pb.h"
+#include "channel_pool.hpp"
+#include "raw_message.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Default cap on outstanding forwards to a single downstream node.
+const int DEFAULT_MAX_IN_FLIGHT_PER_EDGE = 1024;
+// Default number of streamed rows routed before per-edge batches are forwarded.
+const int DEFAULT_FORWARD_BATCH_SIZE = 256;
+// Default cap on rows queued or in flight toward a single downstream node.
+const int DEFAULT_MAX_QUEUED_PER_EDGE = 1024;
+// Default retry hint returned to callers turned away by backpressure.
+const int DEFAULT_RETRY_AFTER_MS = 100;
+// Trailing metadata key carrying the retry hint.
+const char* const RETRY_AFTER_METADATA_KEY = "retry-after-ms";
+
+// When a forwarding handler may return to its caller.
+enum class AckMode {
+    Enqueue,     // as soon as the forward has been started
+    Downstream   // once the downstream node has acknowledged it
+};
+
+inline AckMode parseAckMode(const std::string& mode) {
+    if (mode == "enqueue") {
+        return AckMode::Enqueue;
+    }
+    if (mode == "downstream") {
+        return AckMode::Downstream;
+    }
+    throw std::runtime_error("Unknown ack_mode: " + mode);
+}
+
+// Non-blocking forwarding engine built on a CompletionQueue.
+// Forwards are started on the calling thread and completed by a single poller
+// thread, so handler threads never wait on a downstream RPC unless the ack mode
+// asks for it. The number of outstanding forwards per edge is bounded: a
+// forward over the limit is prepared and parked on the edge, and the poller
+// starts it when an earlier one finishes, so starting one never waits either.
+// So is the number of rows queued toward each edge: handlers route a row first and
+// call admit() (unary) or waitForCapacity() (streams) for its destination
+// before taking on work, so a slow edge pushes back on the callers with rows
+// for it instead of piling up handler threads and memory, while rows stored
+// locally or bound for other edges keep flowing.
+class AsyncForwarder {
+public:
+    using Callback = std::function<void(const grpc::Status&)>;
+
+private:
+    // One outstanding RPC; owned by the completion queue until it finishes.
+    struct PendingCall {
+        grpc::ClientContext context;
+        grpc::Status status;
+        std::string edge_id;
+        size_t rows = 0;
+        Callback done;
+        virtual ~PendingCall() = default;
+        // Start the prepared RPC; it completes on the completion queue.
+        virtual void launch() = 0;
+    };
+
+    template <typename Reply>
+    struct UnaryCall : PendingCall {
+        Reply reply;
+        Reply* destination = &reply;   // where the reply is received; the caller's for fetchRow()
+        std::unique_ptr<grpc::ClientAsyncResponseReader<Reply>> reader;
+
+        void launch() override {
+            reader->StartCall();
+            reader->Finish(destination, &status, this);
+        }
+    };
+
+    // In-flight and queued-row accounting for one edge.
+    struct EdgeSlots {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int in_flight = 0;
+        size_t queued_rows = 0;
+        // Prepared forwards waiting for one of the max_in_flight_ slots, oldest first.
+        std::deque<PendingCall*> parked;
+        bool stopping = false;            // the forwarder is going away; nothing more is started
+        // Set when the edge itself pushed back; no new work is admitted before then.
+        std::chrono::steady_clock::time_point backoff_until;
+    };
+
+    const ChannelPool& channels_;
+    std::string node_name_;
+    AckMode ack_mode_;
+    int max_in_flight_;
+    size_t max_queued_;
+    int retry_after_ms_;
+    std::unordered_map<std::string, std::unique_ptr<EdgeSlots>> slots_;
+    grpc::CompletionQueue cq_;
+    std::thread poller_;
+
+    EdgeSlots& slots(const std::string& edge_id) {
+        auto it = slots_.find(edge_id);
+        if (it == slots_.end()) {
+            throw std::runtime_error("No forwarding slots for edge " + edge_id);
+        }
+        return *it->second;
+    }
+
+    // True if the edge cannot take another row: its queue or its in-flight
+    // window is full, or it asked us to back off. Caller holds s.mutex.
+    bool full(const EdgeSlots& s) const {
+        return s.queued_rows >= max_queued_ || s.in_flight >= max_in_flight_ ||
+               std::chrono::steady_clock::now() < s.backoff_until;
+    }
+
+    // Give back rows that were counted but will not be forwarded.
+    void unqueueRows(const std::string& edge_id, size_t rows) {
+        EdgeSlots& s = slots(edge_id);
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.queued_rows -= rows;
+        }
+        s.cv.notify_all();
+    }
+
+    // Return a finished forward's rows and its slot, which goes straight to
+    // the oldest parked forward if there is one. That one is started with the
+    // edge's mutex held, so the destructor cannot shut the queue down under it.
+    void release(const std::string& edge_id, size_t rows) {
+        EdgeSlots& s = slots(edge_id);
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.queued_rows -= rows;
+            if (s.parked.empty() || s.stopping) {
+                s.in_flight--;
+            } else {
+                PendingCall* next = s.parked.front();
+                s.parked.pop_front();
+                next->launch();
+            }
+        }
+        s.cv.notify_all();
+    }
+
+    // Honour a downstream RESOURCE_EXHAUSTED: stop admitting work for the edge
+    // for the retry-after time it asked for.
+    void backOff(PendingCall& call) {
+        int retry_after_ms = retry_after_ms_;
+        const auto& trailers = call.context.GetServerTrailingMetadata();
+        auto it = trailers.find(RETRY_AFTER_METADATA_KEY);
+        if (it != trailers.end()) {
+            try {
+                retry_after_ms = std::stoi(std::string(it->second.data(), it->second.size()));
+            } catch (const std::exception&) {
+            }
+        }
+        EdgeSlots& s = slots(call.edge_id);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.backoff_until = std::max(s.backoff_until,
+                                   std::chrono::steady_clock::now() + std::chrono::milliseconds(retry_after_ms));
+    }
+
+    void poll() {
+        void* tag;
+        bool ok;
+        while (cq_.Next(&tag, &ok)) {
+            std::unique_ptr<PendingCall> call(static_cast<PendingCall*>(tag));
+            if (call->status.error_code() == grpc::StatusCode::RESOURCE_EXHAUSTED) {
+                backOff(*call);
+            }
+            release(call->edge_id, call->rows);
+            if (!ok && call->status.ok()) {
+                call->status = grpc::Status(grpc::StatusCode::UNAVAILABLE, "Forward was cancelled");
+            }
+            if (call->done) {
+                call->done(call->status);
+            }
+        }
+    }
+
+    // Start an RPC built by `prepare`, which must return a not-yet-started reader
+    // (the request is serialized into it, so the caller's copy may go). If the
+    // edge has max_in_flight_ forwards outstanding the call is parked instead and
+    // started by release(); either way this returns at once. `rows` must already
+    // be counted with queueRows(); they are released when the RPC ends. The reply
+    // is received into `reply` when given, which must outlive `done`.
+    template <typename Reply, typename Prepare>
+    void start(const std::string& edge_id, size_t rows, Prepare prepare, Callback done, Reply* reply = nullptr) {
+        EdgeSlots& s = slots(edge_id);
+        auto* call = new UnaryCall<Reply>();
+        call->edge_id = edge_id;
+        call->rows = rows;
+        call->done = std::move(done);
+        if (reply) {
+            call->destination = reply;
+        }
+        call->reader = prepare(&call->context);
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (s.in_flight >= max_in_flight_) {
+                s.parked.push_back(call);
+                return;
+            }
+            s.in_flight++;
+        }
+        call->launch();
+    }
+
+    // Status reported upstream for a failed forward. Backpressure is passed on as
+    // is so callers further up slow down too; anything else becomes INTERNAL.
+    static grpc::Status forwardFailure(const grpc::Status& status, const std::string& message) {
+        if (status.error_code() == grpc::StatusCode::RESOURCE_EXHAUSTED) {
+            return status;
+        }
+        return grpc::Status(grpc::StatusCode::INTERNAL, message);
+    }
+
+public:
+    // Rows admit() has counted toward their edges for one call. A forward
+    // handed the admission takes its rows over instead of counting them again;
+    // whatever is left when it goes out of scope (rows stored locally or
+    // skipped, or a call turned away) is given back.
+    class Admission {
+    public:
+        explicit Admission(AsyncForwarder& forwarder) : forwarder_(forwarder) {}
+
+        ~Admission() {
+            for (const auto& entry : rows_) {
+                if (entry.second > 0) {
+                    forwarder_.unqueueRows(entry.first, entry.second);
+                }
+            }
+        }
+
+        Admission(const Admission&) = delete;
+        Admission& operator=(const Admission&) = delete;
+
+    private:
+        friend class AsyncForwarder;
+        AsyncForwarder& forwarder_;
+        std::unordered_map<std::string, size_t> rows_;
+
+        // Hand over up to `rows` of the rows held for the edge; returns how many.
+        size_t take(const std::string& edge_id, size_t rows) {
+            auto it = rows_.find(edge_id);
+            if (it == rows_.end()) {
+                return 0;
+            }
+            size_t taken = std::min(rows, it->second);
+            it->second -= taken;
+            return taken;
+        }
+    };
+
+    AsyncForwarder(const ChannelPool& channels, const std::string& node_name, AckMode ack_mode,
+                   int max_in_flight_per_edge, int max_queued_per_edge = DEFAULT_MAX_QUEUED_PER_EDGE,
+                   int retry_after_ms = DEFAULT_RETRY_AFTER_MS)
+        : channels_(channels),
+          node_name_(node_name),
+          ack_mode_(ack_mode),
+          max_in_flight_(max_in_flight_per_edge < 1 ? 1 : max_in_flight_per_edge),
+          max_queued_(max_queued_per_edge < 1 ? 1 : static_cast<size_t>(max_queued_per_edge)),
+          retry_after_ms_(retry_after_ms) {
+        for (const auto& edge_id : channels_.edgeIds()) {
+            slots_[edge_id] = std::make_unique<EdgeSlots>();
+        }
+        poller_ = std::thread(&AsyncForwarder::poll, this);
+    }
+
+    AsyncForwarder(const ChannelPool& channels, const std::string& node_name, const json& config)
+        : AsyncForwarder(channels, node_name,
+                         parseAckMode(config.value("ack_mode", "downstream")),
+                         config.value("max_in_flight_per_edge", DEFAULT_MAX_IN_FLIGHT_PER_EDGE),
+                         config.value("max_queued_per_edge", DEFAULT_MAX_QUEUED_PER_EDGE),
+                         config.value("retry_after_ms", DEFAULT_RETRY_AFTER_MS)) {}
+
+    ~AsyncForwarder() {
+        // Parked forwards are never started; their callers hear they were cancelled.
+        std::vector<PendingCall*> parked;
+        for (auto& entry : slots_) {
+            EdgeSlots& s = *entry.second;
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.stopping = true;
+            parked.insert(parked.end(), s.parked.begin(), s.parked.end());
+            s.parked.clear();
+        }
+        for (PendingCall* call : parked) {
+            std::unique_ptr<PendingCall> owned(call);
+            if (owned->done) {
+                owned->done(grpc::Status(grpc::StatusCode::UNAVAILABLE, "Forward was cancelled"));
+            }
+        }
+        // Outstanding calls still complete; Next() returns false once they are drained.
+        cq_.Shutdown();
+        if (poller_.joinable()) {
+            poller_.join();
+        }
+    }
+
+    AsyncForwarder(const AsyncForwarder&) = delete;
+    AsyncForwarder& operator=(const AsyncForwarder&) = delete;
+
+    AckMode ackMode() const {
+        return ack_mode_;
+    }
+
+    // Count rows handed to this edge before their RPC starts (e.g. held by a coalescer).
+    // Rows already counted by `admission` are taken from it rather than counted twice.
+    void queueRows(const std::string& edge_id, size_t rows, Admission* admission = nullptr) {
+        if (admission) {
+            rows -= admission->take(edge_id, rows);
+        }
+        if (rows == 0) {
+            return;
+        }
+        EdgeSlots& s = slots(edge_id);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.queued_rows += rows;
+    }
+
+    // True if the edge's queue or in-flight window is full or it asked us to
+    // back off. Ids that are not edges (this node itself) are never saturated.
+    bool saturated(const std::string& edge_id) {
+        auto it = slots_.find(edge_id);
+        if (it == slots_.end()) {
+            return false;
+        }
+        EdgeSlots& s = *it->second;
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return full(s);
+    }
+
+    // Turn a call away because `node_id` cannot take more work: RESOURCE_EXHAUSTED
+    // with a retry-after-ms trailer, so the caller backs off and retries as is.
+    grpc::Status reject(grpc::ServerContextBase* context, const std::string& node_id) {
+        std::cerr << node_name_ << ": Node " << node_id << " is saturated, rejecting call" << std::endl;
+        context->AddTrailingMetadata(RETRY_AFTER_METADATA_KEY, std::to_string(retry_after_ms_));
+        return grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                            "Node " + node_id + " is overloaded, retry after " + std::to_string(retry_after_ms_) + " ms");
+    }
+
+    // Admission check for unary handlers, made once a row is routed but before
+    // any work is done so a rejected call can be retried as is. While the row's
+    // destination edge is full the call is turned away with RESOURCE_EXHAUSTED
+    // and a retry-after-ms trailer; rows for this node itself are always admitted.
+    // An admitted row is counted toward the edge in the same step and held in
+    // `admission` for the forward that carries it, so concurrent calls cannot
+    // all pass on the last free place.
+    grpc::Status admit(grpc::ServerContextBase* context, const std::string& edge_id, Admission* admission) {
+        auto it = slots_.find(edge_id);
+        if (it == slots_.end()) {
+            return grpc::Status::OK;
+        }
+        EdgeSlots& s = *it->second;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (!full(s)) {
+                s.queued_rows++;
+                admission->rows_[edge_id]++;
+                return grpc::Status::OK;
+            }
+        }
+        return reject(context, edge_id);
+    }
+
+    // Backpressure for streaming handlers: block until the edge the next row
+    // goes to has room. The handler stops reading meanwhile, so HTTP/2 flow
+    // control stalls the sender. Returns at once for this node itself.
+    void waitForCapacity(const std::string& edge_id) {
+        auto it = slots_.find(edge_id);
+        if (it == slots_.end()) {
+            return;
+        }
+        EdgeSlots& s = *it->second;
+        std::unique_lock<std::mutex> lock(s.mutex);
+        s.cv.wait(lock, [&] { return s.queued_rows < max_queued_ && s.in_flight < max_in_flight_; });
+        while (std::chrono::steady_clock::now() < s.backoff_until) {
+            s.cv.wait_until(lock, s.backoff_until);
+        }
+    }
+
+    // Apply the ack mode to a forward started by `start_call`: either report success
+    // right away or wait for the downstream status.
+    template <typename Start>
+    grpc::Status submit(const std::string& edge_id, int message_id, Start start_call) {
+        if (ack_mode_ == AckMode::Enqueue) {
+            std::string node_name = node_name_;
+            start_call([node_name, edge_id, message_id](const grpc::Status& status) {
+                if (!status.ok()) {
+                    std::cerr << node_name << ": Failed to forward message " << message_id
+                              << " to Node " << edge_id << ": " << status.error_message() << std::endl;
+                }
+            });
+            return grpc::Status::OK;
+        }
+        auto result = std::make_shared<std::promise<grpc::Status>>();
+        std::future<grpc::Status> acked = result->get_future();
+        start_call([result](const grpc::Status& status) { result->set_value(status); });
+        grpc::Status status = acked.get();
+        if (!status.ok()) {
+            std::cerr << node_name_ << ": Failed to forward message " << message_id
+                      << " to Node " << edge_id << ": " << status.error_message() << std::endl;
+            return forwardFailure(status, "Failed to forward message");
+        }
+        return status;
+    }
+
+    // Non-blocking variant of submit(): `reply` receives the status the handler should
+    // report under the ack mode, immediately for enqueue or from the poller thread
+    // once the edge answers for downstream. Neither waits for an in-flight slot:
+    // start() parks a forward over the edge's limit.
+    template <typename Start>
+    void submitAsync(const std::string& edge_id, int message_id, Start start_call, Callback reply) {
+        std::string node_name = node_name_;
+        bool enqueue = ack_mode_ == AckMode::Enqueue;
+        start_call([node_name, edge_id, message_id, enqueue, reply](const grpc::Status& status) {
+            if (!status.ok()) {
+                std::cerr << node_name << ": Failed to forward message " << message_id
+                          << " to Node " << edge_id << ": " << status.error_message() << std::endl;
+            }
+            if (!enqueue) {
+                reply(status.ok() ? grpc::Status::OK : forwardFailure(status, "Failed to forward message"));
+            }
+        });
+        if (enqueue) {
+            reply(grpc::Status::OK);
+        }
+    }
+
+    // Forward one message; `done` runs on the poller thread and must not block.
+    void forward(const std::string& edge_id, const data::DataMessage& message, Callback done,
+                 Admission* admission = nullptr) {
+        data::DataService::Stub* stub = channels_.stub(edge_id);
+        queueRows(edge_id, 1, admission);
+        start<data::Empty>(edge_id, 1, [&](grpc::ClientContext* context) {
+            return stub->PrepareAsyncPushData(context, message, &cq_);
+        }, std::move(done));
+    }
+
+    // Forward one message and return the status the handler should report under the ack mode.
+    grpc::Status forward(const std::string& edge_id, const data::DataMessage& message,
+                         Admission* admission = nullptr) {
+        return submit(edge_id, message.id(), [&](Callback done) {
+            forward(edge_id, message, std::move(done), admission);
+        });
+    }
+
+    // Forward a batch of messages in a single PushBatch call.
+    void forward(const std::string& edge_id, const data::DataBatch& batch, Callback done,
+                 Admission* admission = nullptr) {
+        data::DataService::Stub* stub = channels_.stub(edge_id);
+        size_t rows = static_cast<size_t>(batch.messages_size());
+        queueRows(edge_id, rows, admission);
+        start<data::Empty>(edge_id, rows, [&](grpc::ClientContext* context) {
+            return stub->PrepareAsyncPushBatch(context, batch, &cq_);
+        }, std::move(done));
+    }
+
+    // Forward a serialized DataMessage to the edge's PushData without parsing it.
+    void forwardRaw(const std::string& edge_id, const grpc::ByteBuffer& message, Callback done,
+                    Admission* admission = nullptr) {
+        grpc::GenericStub* stub = channels_.genericStub(edge_id);
+        queueRows(edge_id, 1, admission);
+        start<grpc::ByteBuffer>(edge_id, 1, [&](grpc::ClientContext* context) {
+            return stub->PrepareUnaryCall(context, PUSH_DATA_METHOD, message, &cq_);
+        }, std::move(done));
+    }
+
+    // Forward a serialized batch (DataBatch wire format) to the edge's PushBatch.
+    // Its `rows` must already have been counted with queueRows() when they were queued.
+    void forwardRawBatch(const std::string& edge_id, const grpc::ByteBuffer& batch, size_t rows, Callback done) {
+        grpc::GenericStub* stub = channels_.genericStub(edge_id);
+        start<grpc::ByteBuffer>(edge_id, rows, [&](grpc::ClientContext* context) {
+            return stub->PrepareUnaryCall(context, PUSH_BATCH_METHOD, batch, &cq_);
+        }, std::move(done));
+    }
+
+    // Forward a serialized message without blocking the caller, even while the
+    // edge is at max_in_flight_per_edge; see submitAsync().
+    void forwardRaw(const std::string& edge_id, int message_id, const grpc::ByteBuffer& message, Callback reply,
+                    Admission* admission = nullptr) {
+        submitAsync(edge_id, message_id, [&](Callback done) {
+            forwardRaw(edge_id, message, std::move(done), admission);
+        }, std::move(reply));
+    }
+
+    // Ask an edge for a row. The lookup shares the edge's in-flight window with
+    // forwards but carries no rows; `reply` must outlive `done`, which runs on
+    // the poller thread and must not block.
+    void fetchRow(const std::string& edge_id, const data::RowRequest& request, std::chrono::milliseconds timeout,
+                  data::Row* reply, Callback done) {
+        data::DataService::Stub* stub = channels_.stub(edge_id);
+        start<data::Row>(edge_id, 0, [&](grpc::ClientContext* context) {
+            context->set_deadline(std::chrono::system_clock::now() + timeout);
+            return stub->PrepareAsyncGetRow(context, request, &cq_);
+        }, std::move(done), reply);
+    }
+
+    // Forward one batch per edge concurrently and return the combined status under the ack mode.
+    grpc::Status forwardAll(const std::unordered_map<std::string, data::DataBatch>& batches,
+                            Admission* admission = nullptr) {
+        std::vector<std::future<grpc::Status>> acks;
+        for (const auto& entry : batches) {
+            const std::string& edge_id = entry.first;
+            const data::DataBatch& batch = entry.second;
+            if (batch.messages_size() == 0) {
+                continue;
+            }
+            if (ack_mode_ == AckMode::Enqueue) {
+                std::string node_name = node_name_;
+                int count = batch.messages_size();
+                forward(edge_id, batch, [node_name, edge_id, count](const grpc::Status& status) {
+                    if (!status.ok()) {
+                        std::cerr << node_name << ": Failed to forward batch of " << count
+                                  << " messages to Node " << edge_id << ": " << status.error_message() << std::endl;
+                    }
+                }, admission);
+                continue;
+            }
+            auto result = std::make_shared<std::promise<grpc::Status>>();
+            acks.push_back(result->get_future());
+            forward(edge_id, batch, [result](const grpc::Status& status) { result->set_value(status); }, admission);
+        }
+        grpc::Status combined = grpc::Status::OK;
+        for (auto& ack : acks) {
+            grpc::Status status = ack.get();
+            if (!status.ok() && combined.ok()) {
+                std::cerr << node_name_ << ": Failed to forward batch: " << status.error_message() << std::endl;
+                combined = forwardFailure(status, "Failed to forward batch");
+            }
+        }
+        return combined;
+    }
+};
+
+#endif // ASYNC_FORWARDER_HPP
@@ -0,0 +1,138 @@
+#ifndef CHANNEL_POOL_HPP
+#define CHANNEL_POOL_HPP
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/generic/generic_stub.h>
+#include "data.grpc.pb.h"
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Default number of channels (and therefore HTTP/2 connections) opened per edge.
+const int DEFAULT_CHANNELS_PER_EDGE = 4;
+
+// A downstream node this node may forward to, as listed in config.json.
+struct EdgeConfig {
+    std::string id;
+    std::string address;
+    int weight;   // share of the hash ring relative to the other members
+};
+
+// Collect the downstream edges from a node configuration.
+// Accepts the "edges" array as well as the legacy "nodeE_address" key used by Nodes C and D.
+inline std::vector<EdgeConfig> loadEdges(const json& config) {
+    std::vector<EdgeConfig> edges;
+    if (config.contains("edges")) {
+        for (const auto& edge : config["edges"]) {
+            edges.push_back({edge.at("id").get<std::string>(), edge.at("address").get<std::string>(),
+                             edge.value("weight", 1)});
+        }
+    }
+    if (config.contains("nodeE_address")) {
+        bool listed = false;
+        for (const auto& edge : edges) {
+            if (edge.id == "E") {
+                listed = true;
+            }
+        }
+        if (!listed) {
+            edges.push_back({"E", config["nodeE_address"].get<std::string>(), 1});
+        }
+    }
+    return edges;
+}
+
+// Long-lived pool of channels and stubs, one group per configured edge.
+// Every channel uses its own subchannel pool so the N channels of an edge map to
+// N separate HTTP/2 connections; stubs are handed out round-robin.
+// The pool is immutable after construction, so lookups need no locking.
+class ChannelPool {
+private:
+    struct EdgeChannels {
+        std::string address;
+        std::vector<std::shared_ptr<grpc::Channel>> channels;
+        std::vector<std::unique_ptr<data::DataService::Stub>> stubs;
+        std::vector<std::unique_ptr<grpc::GenericStub>> generic_stubs;
+        std::atomic<size_t> next{0};
+    };
+
+    std::unordered_map<std::string, std::unique_ptr<EdgeChannels>> edges_;
+
+    EdgeChannels& find(const std::string& edge_id) const {
+        auto it = edges_.find(edge_id);
+        if (it == edges_.end()) {
+            throw std::runtime_error("No channel configured for edge " + edge_id);
+        }
+        return *it->second;
+    }
+
+public:
+    ChannelPool(const std::vector<EdgeConfig>& edges, int channels_per_edge) {
+        if (channels_per_edge < 1) {
+            channels_per_edge = 1;
+        }
+        for (const auto& edge : edges) {
+            auto group = std::make_unique<EdgeChannels>();
+            group->address = edge.address;
+            for (int i = 0; i < channels_per_edge; ++i) {
+                grpc::ChannelArguments args;
+                args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+                auto channel = grpc::CreateCustomChannel(edge.address, grpc::InsecureChannelCredentials(), args);
+                // Start connecting now rather than on the first forwarded row.
+                channel->GetState(true);
+                group->stubs.push_back(data::DataService::NewStub(channel));
+                group->generic_stubs.push_back(std::make_unique<grpc::GenericStub>(channel));
+                group->channels.push_back(std::move(channel));
+            }
+            edges_[edge.id] = std::move(group);
+        }
+    }
+
+    explicit ChannelPool(const json& config)
+        : ChannelPool(loadEdges(config), config.value("channels_per_edge", DEFAULT_CHANNELS_PER_EDGE)) {}
+
+    std::vector<std::string> edgeIds() const {
+        std::vector<std::string> ids;
+        for (const auto& entry : edges_) {
+            ids.push_back(entry.first);
+        }
+        return ids;
+    }
+
+    bool hasEdge(const std::string& edge_id) const {
+        return edges_.count(edge_id) != 0;
+    }
+
+    const std::string& address(const std::string& edge_id) const {
+        return find(edge_id).address;
+    }
+
+    // Next stub for the edge; stubs are thread-safe and may be used concurrently.
+    data::DataService::Stub* stub(const std::string& edge_id) const {
+        EdgeChannels& group = find(edge_id);
+        size_t slot = group.next.fetch_add(1, std::memory_order_relaxed) % group.stubs.size();
+        return group.stubs[slot].get();
+    }
+
+    // Next byte-buffer stub for the edge, for forwarding already serialized messages.
+    grpc::GenericStub* genericStub(const std::string& edge_id) const {
+        EdgeChannels& group = find(edge_id);
+        size_t slot = group.next.fetch_add(1, std::memory_order_relaxed) % group.generic_stubs.size();
+        return group.generic_stubs[slot].get();
+    }
+
+    // Next channel for the edge, for callers that build their own stubs.
+    std::shared_ptr<grpc::Channel> channel(const std::string& edge_id) const {
+        EdgeChannels& group = find(edge_id);
+        size_t slot = group.next.fetch_add(1, std::memory_order_relaxed) % group.channels.size();
+        return group.channels[slot];
+    }
+};
+
+#endif // CHANNEL_POOL_HPP
@@ -0,0 +1,763 @@
+#ifndef COLUMN_STORE_HPP
+#define COLUMN_STORE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "crc32c.hpp"
+#include "row_segment.hpp"
+
+// Columnar table file: rows are stored in row groups, and within a group each
+// column is one contiguous, separately encoded chunk. Reading a column touches
+// only its chunks plus the small per-group metadata.
+//
+//   file        := "NCOL" u16 version u16 reserved                          (8 bytes)
+//                  group*
+//   group       := group_header chunk[columns] footer
+//   group_header:= "NRG1" u32 rows u16 columns u16 reserved
+//                  u32 chunks_length u32 footer_length u32 crc32c(footer)     (24 bytes)
+//   footer      := column_meta[columns]
+//   column_meta := u8 encoding u8 stats u16 reserved u32 offset u32 length u32 crc32c(chunk)
+//                  stats_value
+//   stats_value := i64 min i64 max                       (stats == COLUMN_STATS_INTEGER)
+//                | u16 length min_bytes u16 length max_bytes  (stats == COLUMN_STATS_TEXT)
+//                | nothing                               (stats == COLUMN_STATS_NONE)
+//
+// Chunk encodings (offsets are relative to the first chunk of the group):
+//   plain       u32 value_end[rows] value_bytes
+//   dictionary  u32 entries u32 entry_end[entries] entry_bytes u8 width codes
+//               (entries sorted, codes bit-packed at `width` bits)
+//   delta       i64 first u8 width zigzag(v[i] - v[i - 1]) for i >= 1, bit-packed
+//
+// Integer columns use "delta" when every value is an integer printed in its
+// canonical form, so the text reads back unchanged. Other columns use
+// "dictionary" when it is smaller than "plain". Integers are little-endian.
+
+const char COLUMNAR_MAGIC[4] = {'N', 'C', 'O', 'L'};
+const char ROW_GROUP_MAGIC[4] = {'N', 'R', 'G', '1'};
+const uint16_t COLUMNAR_VERSION = 1;
+const size_t COLUMNAR_HEADER_SIZE = 8;
+const size_t ROW_GROUP_HEADER_SIZE = 24;
+// Default number of rows per row group.
+const int DEFAULT_ROW_GROUP_ROWS = 65536;
+
+enum ColumnEncoding : uint8_t { COLUMN_PLAIN = 0, COLUMN_DICTIONARY = 1, COLUMN_DELTA = 2 };
+enum ColumnStats : uint8_t { COLUMN_STATS_NONE = 0, COLUMN_STATS_INTEGER = 1, COLUMN_STATS_TEXT = 2 };
+
+inline const char* columnEncodingName(uint8_t encoding) {
+    switch (encoding) {
+        case COLUMN_PLAIN: return "plain";
+        case COLUMN_DICTIONARY: return "dictionary";
+        case COLUMN_DELTA: return "delta";
+        default: return "unknown";
+    }
+}
+
+inline void putU64(std::string* out, uint64_t value) {
+    char bytes[8];
+    std::memcpy(bytes, &value, sizeof(value));
+    out->append(bytes, sizeof(bytes));
+}
+
+inline uint64_t getU64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Number of bits needed to represent `value` (0 for 0).
+inline unsigned bitWidth(uint64_t value) {
+    unsigned width = 0;
+    while (value != 0) {
+        width++;
+        value >>= 1;
+    }
+    return width;
+}
+
+inline size_t packedBytes(size_t count, unsigned width) {
+    return (count * width + 7) / 8;
+}
+
+// Append `values`, `width` bits each, least significant bit first.
+inline void packBits(const std::vector<uint64_t>& values, unsigned width, std::string* out) {
+    size_t start = out->size();
+    out->append(packedBytes(values.size(), width), '\0');
+    uint8_t* packed = reinterpret_cast<uint8_t*>(&(*out)[start]);
+    size_t bit = 0;
+    for (uint64_t value : values) {
+        for (unsigned done = 0; done < width;) {
+            unsigned offset = bit & 7;
+            unsigned take = std::min(8 - offset, width - done);
+            packed[bit >> 3] |= static_cast<uint8_t>(((value >> done) & ((1u << take) - 1)) << offset);
+            done += take;
+            bit += take;
+        }
+    }
+}
+
+inline uint64_t unpackBits(const uint8_t* packed, size_t index, unsigned width) {
+    uint64_t value = 0;
+    size_t bit = index * width;
+    for (unsigned done = 0; done < width;) {
+        unsigned offset = bit & 7;
+        unsigned take = std::min(8 - offset, width - done);
+        value |= static_cast<uint64_t>((packed[bit >> 3] >> offset) & ((1u << take) - 1)) << done;
+        done += take;
+        bit += take;
+    }
+    return value;
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Parse an integer that prints back exactly as `text` ("12", "-3"; not "007", "+1" or "-0").
+inline bool parseCanonicalInt(std::string_view text, int64_t* value) {
+    if (text.empty() || text.size() > 20) {
+        return false;
+    }
+    auto parsed = std::from_chars(text.data(), text.data() + text.size(), *value);
+    if (parsed.ec != std::errc() || parsed.ptr != text.data() + text.size()) {
+        return false;
+    }
+    char printed[24];
+    auto written = std::to_chars(printed, printed + sizeof(printed), *value);
+    return std::string_view(printed, written.ptr - printed) == text;
+}
+
+// Encoding and min/max of one column chunk.
+struct ColumnMeta {
+    uint8_t encoding = COLUMN_PLAIN;
+    uint8_t stats = COLUMN_STATS_NONE;
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    uint32_t crc = 0;
+    int64_t min_integer = 0;
+    int64_t max_integer = 0;
+    std::string min_text;
+    std::string max_text;
+};
+
+// Values of one column while its row group is being filled.
+class ColumnBuffer {
+private:
+    std::string bytes_;
+    std::vector<uint32_t> ends_;
+
+public:
+    void add(std::string_view value) {
+        bytes_.append(value.data(), value.size());
+        ends_.push_back(static_cast<uint32_t>(bytes_.size()));
+    }
+
+    size_t size() const {
+        return ends_.size();
+    }
+
+    std::string_view value(size_t i) const {
+        uint32_t begin = i == 0 ? 0 : ends_[i - 1];
+        return std::string_view(bytes_).substr(begin, ends_[i] - begin);
+    }
+
+    // Append the chunk for these values to *out and describe it in *meta.
+    void encode(std::string* out, ColumnMeta* meta) const {
+        size_t rows = size();
+        size_t start = out->size();
+        if (!encodeIntegers(out, meta) && !encodeDictionary(out, meta)) {
+            meta->encoding = COLUMN_PLAIN;
+            for (uint32_t end : ends_) {
+                putU32(out, end);
+            }
+            out->append(bytes_);
+            if (rows > 0) {
+                std::string_view min = value(0);
+                std::string_view max = min;
+                for (size_t i = 1; i < rows; i++) {
+                    min = std::min(min, value(i));
+                    max = std::max(max, value(i));
+                }
+                setTextStats(min, max, meta);
+            }
+        }
+        meta->length = static_cast<uint32_t>(out->size() - start);
+        meta->crc = crc32c(out->data() + start, meta->length);
+    }
+
+    void clear() {
+        bytes_.clear();
+        ends_.clear();
+    }
+
+private:
+    static void setTextStats(std::string_view min, std::string_view max, ColumnMeta* meta) {
+        if (min.size() <= UINT16_MAX && max.size() <= UINT16_MAX) {
+            meta->stats = COLUMN_STATS_TEXT;
+            meta->min_text.assign(min);
+            meta->max_text.assign(max);
+        }
+    }
+
+    bool encodeIntegers(std::string* out, ColumnMeta* meta) const {
+        size_t rows = size();
+        if (rows == 0) {
+            return false;
+        }
+        std::vector<int64_t> values(rows);
+        for (size_t i = 0; i < rows; i++) {
+            if (!parseCanonicalInt(value(i), &values[i])) {
+                return false;
+            }
+        }
+        std::vector<uint64_t> deltas(rows - 1);
+        uint64_t widest = 0;
+        for (size_t i = 1; i < rows; i++) {
+            // Wrapping subtraction, undone by wrapping addition when decoding.
+            deltas[i - 1] = zigzag(static_cast<int64_t>(static_cast<uint64_t>(values[i]) -
+                                                        static_cast<uint64_t>(values[i - 1])));
+            widest |= deltas[i - 1];
+        }
+        unsigned width = bitWidth(widest);
+        meta->encoding = COLUMN_DELTA;
+        putU64(out, static_cast<uint64_t>(values[0]));
+        out->push_back(static_cast<char>(width));
+        packBits(deltas, width, out);
+        meta->stats = COLUMN_STATS_INTEGER;
+        auto bounds = std::minmax_element(values.begin(), values.end());
+        meta->min_integer = *bounds.first;
+        meta->max_integer = *bounds.second;
+        return true;
+    }
+
+    bool encodeDictionary(std::string* out, ColumnMeta* meta) const {
+        size_t rows = size();
+        if (rows == 0) {
+            return false;
+        }
+        // More than one distinct value per two rows is never worth a dictionary.
+        std::unordered_map<std::string_view, uint32_t> codes;
+        size_t entry_bytes = 0;
+        for (size_t i = 0; i < rows; i++) {
+            std::string_view v = value(i);
+            if (codes.emplace(v, 0).second) {
+                entry_bytes += v.size();
+                if (codes.size() > rows / 2) {
+                    return false;
+                }
+            }
+        }
+        unsigned width = bitWidth(codes.size() - 1);
+        size_t dictionary_size = 4 + 4 * codes.size() + entry_bytes + 1 + packedBytes(rows, width);
+        size_t plain_size = 4 * rows + bytes_.size();
+        if (dictionary_size >= plain_size) {
+            return false;
+        }
+        std::vector<std::string_view> entries;
+        entries.reserve(codes.size());
+        for (const auto& entry : codes) {
+            entries.push_back(entry.first);
+        }
+        std::sort(entries.begin(), entries.end());
+        for (size_t code = 0; code < entries.size(); code++) {
+            codes[entries[code]] = static_cast<uint32_t>(code);
+        }
+        meta->encoding = COLUMN_DICTIONARY;
+        putU32(out, static_cast<uint32_t>(entries.size()));
+        uint32_t end = 0;
+        for (std::string_view entry : entries) {
+            end += static_cast<uint32_t>(entry.size());
+            putU32(out, end);
+        }
+        for (std::string_view entry : entries) {
+            out->append(entry.data(), entry.size());
+        }
+        out->push_back(static_cast<char>(width));
+        std::vector<uint64_t> row_codes(rows);
+        for (size_t i = 0; i < rows; i++) {
+            row_codes[i] = codes[value(i)];
+        }
+        packBits(row_codes, width, out);
+        setTextStats(entries.front(), entries.back(), meta);
+        return true;
+    }
+};
+
+// Rows collected for the next row group.
+class RowGroupBuilder {
+private:
+    std::vector<ColumnBuffer> columns_;
+    size_t rows_ = 0;
+
+public:
+    // Add a row (strings or string_views); rows narrower than the widest row in
+    // the group are padded with empty fields.
+    template <typename Columns>
+    void add(const Columns& row) {
+        while (columns_.size() < row.size()) {
+            ColumnBuffer column;
+            for (size_t i = 0; i < rows_; i++) {
+                column.add(std::string_view());
+            }
+            columns_.push_back(std::move(column));
+        }
+        for (size_t c = 0; c < columns_.size(); c++) {
+            columns_[c].add(c < row.size() ? std::string_view(row[c]) : std::string_view());
+        }
+        rows_++;
+    }
+
+    size_t rows() const {
+        return rows_;
+    }
+
+    bool empty() const {
+        return rows_ == 0;
+    }
+
+    // Columns of row i of the group being filled.
+    void row(size_t i, std::vector<std::string>* columns) const {
+        columns->clear();
+        for (const auto& column : columns_) {
+            columns->emplace_back(column.value(i));
+        }
+    }
+
+    // Append the encoded row group to *out and start a new one.
+    void encode(std::string* out) {
+        size_t start = out->size();
+        out->append(ROW_GROUP_MAGIC, sizeof(ROW_GROUP_MAGIC));
+        putU32(out, static_cast<uint32_t>(rows_));
+        putU16(out, static_cast<uint16_t>(columns_.size()));
+        putU16(out, 0);
+        putU32(out, 0);   // chunks length, patched below
+        putU32(out, 0);   // footer length, patched below
+        putU32(out, 0);   // footer crc, patched below
+
+        size_t chunks = out->size();
+        std::vector<ColumnMeta> metas(columns_.size());
+        for (size_t c = 0; c < columns_.size(); c++) {
+            metas[c].offset = static_cast<uint32_t>(out->size() - chunks);
+            columns_[c].encode(out, &metas[c]);
+        }
+        uint32_t chunks_length = static_cast<uint32_t>(out->size() - chunks);
+
+        size_t footer = out->size();
+        for (const auto& meta : metas) {
+            out->push_back(static_cast<char>(meta.encoding));
+            out->push_back(static_cast<char>(meta.stats));
+            putU16(out, 0);
+            putU32(out, meta.offset);
+            putU32(out, meta.length);
+            putU32(out, meta.crc);
+            if (meta.stats == COLUMN_STATS_INTEGER) {
+                putU64(out, static_cast<uint64_t>(meta.min_integer));
+                putU64(out, static_cast<uint64_t>(meta.max_integer));
+            } else if (meta.stats == COLUMN_STATS_TEXT) {
+                putU16(out, static_cast<uint16_t>(meta.min_text.size()));
+                out->append(meta.min_text);
+                putU16(out, static_cast<uint16_t>(meta.max_text.size()));
+                out->append(meta.max_text);
+            }
+        }
+        uint32_t footer_length = static_cast<uint32_t>(out->size() - footer);
+        uint32_t footer_crc = crc32c(out->data() + footer, footer_length);
+        std::memcpy(&(*out)[start + 12], &chunks_length, sizeof(chunks_length));
+        std::memcpy(&(*out)[start + 16], &footer_length, sizeof(footer_length));
+        std::memcpy(&(*out)[start + 20], &footer_crc, sizeof(footer_crc));
+
+        columns_.clear();
+        rows_ = 0;
+    }
+};
+
+// One encoded column chunk; values are decoded on demand.
+class ChunkView {
+private:
+    uint8_t encoding_ = COLUMN_PLAIN;
+    size_t rows_ = 0;
+    const uint8_t* ends_ = nullptr;       // plain: value ends; dictionary: entry ends
+    const char* bytes_ = nullptr;         // plain: values; dictionary: entries
+    size_t entries_ = 0;
+    unsigned width_ = 0;
+    const uint8_t* packed_ = nullptr;     // dictionary codes or zigzag deltas
+    int64_t first_ = 0;
+
+    std::string_view entry(size_t i) const {
+        uint32_t begin = i == 0 ? 0 : getU32(ends_ + 4 * (i - 1));
+        return std::string_view(bytes_ + begin, getU32(ends_ + 4 * i) - begin);
+    }
+
+    static std::string_view print(int64_t value, char* buffer) {
+        auto written = std::to_chars(buffer, buffer + 24, value);
+        return std::string_view(buffer, written.ptr - buffer);
+    }
+
+public:
+    // Check and map a chunk of `rows` values; false if it is malformed.
+    bool init(uint8_t encoding, const uint8_t* data, size_t size, size_t rows) {
+        encoding_ = encoding;
+        rows_ = rows;
+        if (encoding == COLUMN_PLAIN) {
+            if (size < 4 * rows) {
+                return false;
+            }
+            ends_ = data;
+            bytes_ = reinterpret_cast<const char*>(data + 4 * rows);
+            uint32_t previous = 0;
+            for (size_t i = 0; i < rows; i++) {
+                uint32_t end = getU32(ends_ + 4 * i);
+                if (end < previous) {
+                    return false;
+                }
+                previous = end;
+            }
+            return previous == size - 4 * rows;
+        }
+        if (encoding == COLUMN_DICTIONARY) {
+            if (size < 4) {
+                return false;
+            }
+            entries_ = getU32(data);
+            if (entries_ == 0 || (size - 4) / 4 < entries_) {
+                return false;
+            }
+            ends_ = data + 4;
+            bytes_ = reinterpret_cast<const char*>(ends_ + 4 * entries_);
+            uint32_t previous = 0;
+            for (size_t i = 0; i < entries_; i++) {
+                uint32_t end = getU32(ends_ + 4 * i);
+                if (end < previous) {
+                    return false;
+                }
+                previous = end;
+            }
+            size_t used = 4 + 4 * entries_ + previous;
+            if (size < used + 1) {
+                return false;
+            }
+            width_ = data[used];
+            packed_ = data + used + 1;
+            if (width_ > 32 || size - used - 1 < packedBytes(rows, width_)) {
+                return false;
+            }
+            for (size_t i = 0; i < rows; i++) {
+                if (unpackBits(packed_, i, width_) >= entries_) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        if (encoding == COLUMN_DELTA) {
+            if (size < 9 || rows == 0) {
+                return false;
+            }
+            first_ = static_cast<int64_t>(getU64(data));
+            width_ = data[8];
+            packed_ = data + 9;
+            return width_ <= 64 && size - 9 >= packedBytes(rows - 1, width_);
+        }
+        return false;
+    }
+
+    size_t rows() const {
+        return rows_;
+    }
+
+    uint8_t encoding() const {
+        return encoding_;
+    }
+
+    bool isInteger() const {
+        return encoding_ == COLUMN_DELTA;
+    }
+
+    // Call fn(size_t row, std::string_view value) for every value in order.
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        if (encoding_ == COLUMN_DELTA) {
+            char buffer[24];
+            int64_t value = first_;
+            for (size_t i = 0; i < rows_; i++) {
+                if (i > 0) {
+                    value = static_cast<int64_t>(static_cast<uint64_t>(value) +
+                                                 static_cast<uint64_t>(unzigzag(unpackBits(packed_, i - 1, width_))));
+                }
+                fn(i, print(value, buffer));
+            }
+            return;
+        }
+        for (size_t i = 0; i < rows_; i++) {
+            if (encoding_ == COLUMN_DICTIONARY) {
+                fn(i, entry(static_cast<size_t>(unpackBits(packed_, i, width_))));
+            } else {
+                fn(i, entry(i));
+            }
+        }
+    }
+
+    // Integer values of a delta chunk.
+    void integers(std::vector<int64_t>* values) const {
+        values->clear();
+        if (encoding_ != COLUMN_DELTA) {
+            return;
+        }
+        values->reserve(rows_);
+        int64_t value = first_;
+        for (size_t i = 0; i < rows_; i++) {
+            if (i > 0) {
+                value = static_cast<int64_t>(static_cast<uint64_t>(value) +
+                                             static_cast<uint64_t>(unzigzag(unpackBits(packed_, i - 1, width_))));
+            }
+            values->push_back(value);
+        }
+    }
+
+    // Value of row i. Delta chunks are summed up to i.
+    std::string value(size_t i) const {
+        if (encoding_ == COLUMN_PLAIN) {
+            return std::string(entry(i));
+        }
+        if (encoding_ == COLUMN_DICTIONARY) {
+            return std::string(entry(static_cast<size_t>(unpackBits(packed_, i, width_))));
+        }
+        int64_t value = first_;
+        for (size_t k = 1; k <= i; k++) {
+            value = static_cast<int64_t>(static_cast<uint64_t>(value) +
+                                         static_cast<uint64_t>(unzigzag(unpackBits(packed_, k - 1, width_))));
+        }
+        char buffer[24];
+        return std::string(print(value, buffer));
+    }
+};
+
+// Metadata of one row group, read from its header and footer only.
+class RowGroupView {
+private:
+    const uint8_t* chunks_ = nullptr;
+    size_t chunks_length_ = 0;
+    size_t rows_ = 0;
+    std::vector<ColumnMeta> columns_;
+
+public:
+    // Parse the group at the start of `data` (at most `size` bytes); *group_size
+    // receives its total size. Returns false for a truncated or damaged group.
+    static bool parse(const uint8_t* data, size_t size, RowGroupView* group, size_t* group_size) {
+        if (size < ROW_GROUP_HEADER_SIZE || std::memcmp(data, ROW_GROUP_MAGIC, sizeof(ROW_GROUP_MAGIC)) != 0) {
+            return false;
+        }
+        size_t rows = getU32(data + 4);
+        size_t columns = getU16(data + 8);
+        size_t chunks_length = getU32(data + 12);
+        size_t footer_length = getU32(data + 16);
+        uint32_t footer_crc = getU32(data + 20);
+        if (chunks_length > size - ROW_GROUP_HEADER_SIZE ||
+            footer_length > size - ROW_GROUP_HEADER_SIZE - chunks_length) {
+            return false;
+        }
+        const uint8_t* footer = data + ROW_GROUP_HEADER_SIZE + chunks_length;
+        if (crc32c(footer, footer_length) != footer_crc) {
+            return false;
+        }
+        group->chunks_ = data + ROW_GROUP_HEADER_SIZE;
+        group->chunks_length_ = chunks_length;
+        group->rows_ = rows;
+        group->columns_.assign(columns, ColumnMeta());
+        size_t at = 0;
+        for (auto& meta : group->columns_) {
+            if (footer_length - at < 16) {
+                return false;
+            }
+            meta.encoding = footer[at];
+            meta.stats = footer[at + 1];
+            meta.offset = getU32(footer + at + 4);
+            meta.length = getU32(footer + at + 8);
+            meta.crc = getU32(footer + at + 12);
+            at += 16;
+            if (meta.offset > chunks_length || meta.length > chunks_length - meta.offset) {
+                return false;
+            }
+            if (meta.stats == COLUMN_STATS_INTEGER) {
+                if (footer_length - at < 16) {
+                    return false;
+                }
+                meta.min_integer = static_cast<int64_t>(getU64(footer + at));
+                meta.max_integer = static_cast<int64_t>(getU64(footer + at + 8));
+                at += 16;
+            } else if (meta.stats == COLUMN_STATS_TEXT) {
+                for (std::string* text : {&meta.min_text, &meta.max_text}) {
+                    if (footer_length - at < 2 || footer_length - at - 2 < getU16(footer + at)) {
+                        return false;
+                    }
+                    size_t length = getU16(footer + at);
+                    text->assign(reinterpret_cast<const char*>(footer + at + 2), length);
+                    at += 2 + length;
+                }
+            }
+        }
+        *group_size = ROW_GROUP_HEADER_SIZE + chunks_length + footer_length;
+        return true;
+    }
+
+    size_t rows() const {
+        return rows_;
+    }
+
+    size_t columnCount() const {
+        return columns_.size();
+    }
+
+    const ColumnMeta& meta(size_t column) const {
+        return columns_[column];
+    }
+
+    // Map the chunk of a column, hinting the kernel to read just its pages.
+    bool chunk(size_t column, ChunkView* view, bool verify_crc = true) const {
+        if (column >= columns_.size()) {
+            return false;
+        }
+        const ColumnMeta& meta = columns_[column];
+        const uint8_t* data = chunks_ + meta.offset;
+        long page = ::sysconf(_SC_PAGESIZE);
+        uintptr_t begin = reinterpret_cast<uintptr_t>(data) & ~static_cast<uintptr_t>(page - 1);
+        ::madvise(reinterpret_cast<void*>(begin), reinterpret_cast<uintptr_t>(data) + meta.length - begin,
+                  MADV_WILLNEED);
+        if (verify_crc && crc32c(data, meta.length) != meta.crc) {
+            return false;
+        }
+        return view->init(meta.encoding, data, meta.length, rows_);
+    }
+
+    // Columns of row i; false if a chunk is damaged.
+    bool row(size_t i, std::vector<std::string>* columns) const {
+        columns->clear();
+        for (size_t c = 0; c < columns_.size(); c++) {
+            ChunkView view;
+            if (!chunk(c, &view) || i >= view.rows()) {
+                return false;
+            }
+            columns->push_back(view.value(i));
+        }
+        return true;
+    }
+};
+
+// Read-only, memory-mapped view of a columnar table. Opening it reads every
+// group's header and footer; column chunks are only touched when asked for.
+class ColumnarReader {
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t valid_end_ = COLUMNAR_HEADER_SIZE;
+    size_t rows_ = 0;
+    std::vector<RowGroupView> groups_;
+    std::vector<size_t> offsets_;
+
+public:
+    // Only the first `end` bytes are looked at, e.g. the part of a segment
+    // still being appended to that has been written out.
+    explicit ColumnarReader(const std::string& path, size_t end = SIZE_MAX) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open columnar table " + path + ": " + std::strerror(errno));
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to stat columnar table " + path);
+        }
+        size_ = std::min(static_cast<size_t>(st.st_size), end);
+        if (size_ > 0) {
+            void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Failed to map columnar table " + path + ": " + std::strerror(errno));
+            }
+            data_ = static_cast<const uint8_t*>(mapped);
+            // Scans read a few chunks per group; don't read ahead into the others.
+            ::madvise(mapped, size_, MADV_RANDOM);
+        }
+        ::close(fd);
+        if (size_ < COLUMNAR_HEADER_SIZE || std::memcmp(data_, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC)) != 0 ||
+            getU16(data_ + 4) != COLUMNAR_VERSION) {
+            if (data_) {
+                ::munmap(const_cast<uint8_t*>(data_), size_);
+            }
+            throw std::runtime_error("Not a columnar table: " + path);
+        }
+        while (valid_end_ < size_) {
+            RowGroupView group;
+            size_t group_size;
+            if (!RowGroupView::parse(data_ + valid_end_, size_ - valid_end_, &group, &group_size)) {
+                std::cerr << "Columnar: damaged row group at offset " << valid_end_ << " after " << rows_
+                          << " rows; ignoring the remaining " << (size_ - valid_end_) << " bytes" << std::endl;
+                break;
+            }
+            rows_ += group.rows();
+            groups_.push_back(std::move(group));
+            offsets_.push_back(valid_end_);
+            valid_end_ += group_size;
+        }
+    }
+
+    ~ColumnarReader() {
+        if (data_) {
+            ::munmap(const_cast<uint8_t*>(data_), size_);
+        }
+    }
+
+    ColumnarReader(const ColumnarReader&) = delete;
+    ColumnarReader& operator=(const ColumnarReader&) = delete;
+
+    const std::vector<RowGroupView>& groups() const {
+        return groups_;
+    }
+
+    // File offset of group i.
+    size_t offset(size_t i) const {
+        return offsets_[i];
+    }
+
+    size_t rows() const {
+        return rows_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    // End of the last intact row group.
+    size_t validEnd() const {
+        return valid_end_;
+    }
+};
+
+inline std::string columnarHeader() {
+    std::string header(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+    putU16(&header, COLUMNAR_VERSION);
+    putU16(&header, 0);
+    return header;
+}
+
+inline bool isColumnarHeader(const uint8_t* p, size_t size) {
+    return size >= COLUMNAR_HEADER_SIZE && std::memcmp(p, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC)) == 0 &&
+           getU16(p + 4) == COLUMNAR_VERSION;
+}
+
+#endif // COLUMN_STORE_HPP
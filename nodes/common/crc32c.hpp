@@ -0,0 +1,58 @@
+#ifndef CRC32C_HPP
+#define CRC32C_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+// CRC-32C (Castagnoli), as used by iSCSI, ext4 and most storage formats.
+// Uses the SSE4.2 crc32 instruction when the build enables it, otherwise a
+// byte-wise table. crc32c("123456789") == 0xE3069283.
+inline const std::array<uint32_t, 256>& crc32cTable() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+            }
+            t[i] = crc;
+        }
+        return t;
+    }();
+    return table;
+}
+
+// Extend `crc` (0 for a fresh checksum) over `size` bytes.
+inline uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#if defined(__SSE4_2__)
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+    while (size > 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+        size--;
+    }
+#else
+    const auto& table = crc32cTable();
+    while (size > 0) {
+        crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        size--;
+    }
+#endif
+    return ~crc;
+}
+
+#endif // CRC32C_HPP
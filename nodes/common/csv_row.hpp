@@ -0,0 +1,38 @@
+#ifndef CSV_ROW_HPP
+#define CSV_ROW_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Split a CSV payload into `count` columns viewing its own bytes: extra
+// columns are cut off and missing ones are empty, as the nodes have always
+// stored rows. Nothing is copied, so the views are valid while the payload is.
+inline void splitColumns(std::string_view payload, size_t count, std::vector<std::string_view>* columns) {
+    columns->clear();
+    columns->reserve(count);
+    size_t start = 0;
+    while (columns->size() < count && start <= payload.size()) {
+        size_t comma = payload.find(',', start);
+        if (comma == std::string_view::npos) {
+            comma = payload.size();
+        }
+        columns->push_back(payload.substr(start, comma - start));
+        start = comma + 1;
+    }
+    columns->resize(count);
+}
+
+// Append columns as one CSV line (comma-joined, newline-terminated) to *out.
+template <typename Columns>
+void appendCsvLine(const Columns& columns, std::string* out) {
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (i > 0) {
+            out->push_back(',');
+        }
+        out->append(columns[i].data(), columns[i].size());
+    }
+    out->push_back('\n');
+}
+
+#endif // CSV_ROW_HPP
@@ -0,0 +1,65 @@
+#ifndef DATA_CLIENT_HPP
+#define DATA_CLIENT_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <grpcpp/grpcpp.h>
+#include "data.grpc.pb.h"
+
+// Blocking client for one node's DataService.
+class DataClient {
+public:
+    DataClient(std::shared_ptr<grpc::Channel> channel)
+        : stub_(data::DataService::NewStub(channel)) {}
+
+    grpc::Status Send(const data::DataMessage& message) {
+        data::Empty reply;
+        grpc::ClientContext context;
+        return stub_->PushData(&context, message, &reply);
+    }
+
+    grpc::Status SendBatch(const data::DataBatch& batch) {
+        data::Empty reply;
+        grpc::ClientContext context;
+        return stub_->PushBatch(&context, batch, &reply);
+    }
+
+    grpc::Status GetRow(int32_t row_index, data::Row* row, uint32_t hop_count = 0) {
+        data::RowRequest request;
+        request.set_row_index(row_index);
+        request.set_hop_count(hop_count);
+        grpc::ClientContext context;
+        return stub_->GetRow(&context, request, row);
+    }
+
+    // Scan this node's own table, calling fn(const data::Row&, const std::string& node)
+    // for every row streamed back.
+    template <typename Fn>
+    grpc::Status Scan(const data::ScanRequest& request, Fn fn) {
+        grpc::ClientContext context;
+        std::unique_ptr<grpc::ClientReader<data::RowBatch>> reader(stub_->Scan(&context, request));
+        data::RowBatch batch;
+        while (reader->Read(&batch)) {
+            for (const auto& row : batch.rows()) {
+                fn(row, batch.node());
+            }
+        }
+        return reader->Finish();
+    }
+
+    bool PushData(const data::DataMessage& message) {
+        grpc::Status status = Send(message);
+        if (!status.ok()) {
+            std::cerr << "DataClient: RPC failed: " << status.error_message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::unique_ptr<data::DataService::Stub> stub_;
+};
+
+#endif // DATA_CLIENT_HPP
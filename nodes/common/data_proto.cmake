@@ -0,0 +1,20 @@
+# Generates data.pb.{h,cc} and data.grpc.pb.{h,cc} for the DataService from
+# nodes/common/data.proto into the current binary directory.
+# Requires Protobuf and gRPC to have been found by the including project.
+
+set(DATA_PROTO "${CMAKE_CURRENT_LIST_DIR}/data.proto")
+set(DATA_PROTO_SRCS "${CMAKE_CURRENT_BINARY_DIR}/data.pb.cc")
+set(DATA_PROTO_HDRS "${CMAKE_CURRENT_BINARY_DIR}/data.pb.h")
+set(DATA_GRPC_SRCS "${CMAKE_CURRENT_BINARY_DIR}/data.grpc.pb.cc")
+set(DATA_GRPC_HDRS "${CMAKE_CURRENT_BINARY_DIR}/data.grpc.pb.h")
+
+add_custom_command(
+    OUTPUT ${DATA_PROTO_SRCS} ${DATA_PROTO_HDRS} ${DATA_GRPC_SRCS} ${DATA_GRPC_HDRS}
+    COMMAND $<TARGET_FILE:protobuf::protoc>
+    ARGS --cpp_out "${CMAKE_CURRENT_BINARY_DIR}"
+         --grpc_out "${CMAKE_CURRENT_BINARY_DIR}"
+         --plugin=protoc-gen-grpc=$<TARGET_FILE:gRPC::grpc_cpp_plugin>
+         -I "${CMAKE_CURRENT_LIST_DIR}"
+         "${DATA_PROTO}"
+    DEPENDS "${DATA_PROTO}"
+)
@@ -0,0 +1,267 @@
+#ifndef EDGE_COALESCER_HPP
+#define EDGE_COALESCER_HPP
+
+#include <grpcpp/grpcpp.h>
+#include "data.grpc.pb.h"
+#include "async_forwarder.hpp"
+#include "raw_message.hpp"
+#include <google/protobuf/wire_format_lite.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Default number of rows that fills a coalesced batch.
+const int DEFAULT_BATCH_MAX_MESSAGES = 64;
+// Default time the oldest queued row may wait before its batch is shipped.
+const int DEFAULT_BATCH_MAX_DELAY_US = 500;
+// Minimum time between batch size reports in the node log.
+const std::chrono::seconds BATCH_METRICS_INTERVAL(10);
+
+// Per-edge micro-batching in front of the AsyncForwarder.
+// Single rows forwarded by PushData are queued per edge and shipped as one
+// PushBatch call once batch_max_messages rows are waiting or the oldest has
+// waited batch_max_delay_us. Rows are queued already serialized and the batch
+// is framed around them (DataBatch is just a sequence of field-1 messages), so
+// raw transit rows keep their original slices. A batch_max_messages of 1 or
+// less forwards every row on its own, as before.
+class EdgeCoalescer {
+public:
+    using Callback = AsyncForwarder::Callback;
+
+    // Achieved batch sizes for one edge.
+    struct BatchStats {
+        uint64_t batches = 0;
+        uint64_t rows = 0;
+        size_t largest = 0;
+    };
+
+private:
+    struct Row {
+        std::vector<grpc::Slice> slices;   // field tag and length, then the serialized message
+        Callback done;
+    };
+
+    struct EdgeQueue {
+        std::vector<Row> rows;
+        std::chrono::steady_clock::time_point oldest;
+        BatchStats stats;
+    };
+
+    AsyncForwarder& forwarder_;
+    std::string node_name_;
+    size_t max_messages_;
+    std::chrono::microseconds max_delay_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<std::string, EdgeQueue> queues_;
+    std::chrono::steady_clock::time_point last_report_;
+    bool stopping_ = false;
+    std::thread flusher_;
+
+    // Queue a serialized message; ships the edge's batch on the caller's thread when it fills up.
+    void enqueue(const std::string& edge_id, std::vector<grpc::Slice> message, size_t length, Callback done,
+                 AsyncForwarder::Admission* admission) {
+        using google::protobuf::internal::WireFormatLite;
+        uint8_t prefix[1 + 10];
+        uint8_t* end = WireFormatLite::WriteTagToArray(
+            data::DataBatch::kMessagesFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, prefix);
+        end = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(static_cast<uint32_t>(length), end);
+
+        Row row;
+        row.slices.reserve(message.size() + 1);
+        row.slices.emplace_back(prefix, static_cast<size_t>(end - prefix));
+        for (auto& slice : message) {
+            row.slices.push_back(std::move(slice));
+        }
+        row.done = std::move(done);
+
+        forwarder_.queueRows(edge_id, 1, admission);
+        std::vector<Row> full;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            EdgeQueue& queue = queues_[edge_id];
+            if (queue.rows.empty()) {
+                queue.oldest = std::chrono::steady_clock::now();
+                cv_.notify_one();
+            }
+            queue.rows.push_back(std::move(row));
+            if (queue.rows.size() >= max_messages_) {
+                full.swap(queue.rows);
+            }
+        }
+        if (!full.empty()) {
+            ship(edge_id, std::move(full));
+        }
+    }
+
+    // Send queued rows as one PushBatch call and hand its status to every row.
+    void ship(const std::string& edge_id, std::vector<Row> rows) {
+        std::vector<grpc::Slice> slices;
+        for (const auto& row : rows) {
+            slices.insert(slices.end(), row.slices.begin(), row.slices.end());
+        }
+        grpc::ByteBuffer batch(slices.data(), slices.size());
+        record(edge_id, rows.size());
+
+        auto callbacks = std::make_shared<std::vector<Callback>>();
+        callbacks->reserve(rows.size());
+        for (auto& row : rows) {
+            callbacks->push_back(std::move(row.done));
+        }
+        forwarder_.forwardRawBatch(edge_id, batch, rows.size(), [callbacks](const grpc::Status& status) {
+            for (const auto& done : *callbacks) {
+                done(status);
+            }
+        });
+    }
+
+    void record(const std::string& edge_id, size_t rows) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        BatchStats& stats = queues_[edge_id].stats;
+        stats.batches++;
+        stats.rows += rows;
+        stats.largest = std::max(stats.largest, rows);
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report_ >= BATCH_METRICS_INTERVAL) {
+            last_report_ = now;
+            for (const auto& entry : queues_) {
+                const BatchStats& s = entry.second.stats;
+                if (s.batches == 0) {
+                    continue;
+                }
+                std::cout << node_name_ << ": Edge " << entry.first << " batches: " << s.batches
+                          << ", rows: " << s.rows << ", average batch: " << (s.rows / s.batches)
+                          << ", largest batch: " << s.largest << std::endl;
+            }
+        }
+    }
+
+    // Ship batches whose oldest row has waited max_delay_.
+    void flushLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            auto now = std::chrono::steady_clock::now();
+            auto next_deadline = std::chrono::steady_clock::time_point::max();
+            std::vector<std::pair<std::string, std::vector<Row>>> due;
+            for (auto& entry : queues_) {
+                EdgeQueue& queue = entry.second;
+                if (queue.rows.empty()) {
+                    continue;
+                }
+                auto deadline = queue.oldest + max_delay_;
+                if (deadline <= now) {
+                    due.emplace_back(entry.first, std::move(queue.rows));
+                    queue.rows.clear();
+                } else {
+                    next_deadline = std::min(next_deadline, deadline);
+                }
+            }
+            if (!due.empty()) {
+                lock.unlock();
+                for (auto& batch : due) {
+                    ship(batch.first, std::move(batch.second));
+                }
+                lock.lock();
+                continue;
+            }
+            if (next_deadline == std::chrono::steady_clock::time_point::max()) {
+                cv_.wait(lock);
+            } else {
+                cv_.wait_until(lock, next_deadline);
+            }
+        }
+    }
+
+public:
+    EdgeCoalescer(AsyncForwarder& forwarder, const std::string& node_name, int max_messages, int max_delay_us)
+        : forwarder_(forwarder),
+          node_name_(node_name),
+          max_messages_(max_messages < 1 ? 1 : static_cast<size_t>(max_messages)),
+          max_delay_(max_delay_us < 0 ? 0 : max_delay_us),
+          last_report_(std::chrono::steady_clock::now()) {
+        if (max_messages_ > 1) {
+            flusher_ = std::thread(&EdgeCoalescer::flushLoop, this);
+        }
+    }
+
+    EdgeCoalescer(AsyncForwarder& forwarder, const std::string& node_name, const json& config)
+        : EdgeCoalescer(forwarder, node_name,
+                        config.value("batch_max_messages", DEFAULT_BATCH_MAX_MESSAGES),
+                        config.value("batch_max_delay_us", DEFAULT_BATCH_MAX_DELAY_US)) {}
+
+    ~EdgeCoalescer() {
+        std::vector<std::pair<std::string, std::vector<Row>>> remaining;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            for (auto& entry : queues_) {
+                if (!entry.second.rows.empty()) {
+                    remaining.emplace_back(entry.first, std::move(entry.second.rows));
+                }
+            }
+        }
+        cv_.notify_one();
+        if (flusher_.joinable()) {
+            flusher_.join();
+        }
+        for (auto& batch : remaining) {
+            ship(batch.first, std::move(batch.second));
+        }
+    }
+
+    EdgeCoalescer(const EdgeCoalescer&) = delete;
+    EdgeCoalescer& operator=(const EdgeCoalescer&) = delete;
+
+    // Forward one message and return the status the handler should report under the ack mode.
+    grpc::Status forward(const std::string& edge_id, const data::DataMessage& message,
+                         AsyncForwarder::Admission* admission = nullptr) {
+        if (max_messages_ <= 1) {
+            return forwarder_.forward(edge_id, message, admission);
+        }
+        // Serialize straight into a slice the batch can reference.
+        size_t length = message.ByteSizeLong();
+        grpc_slice bytes = grpc_slice_malloc(length);
+        message.SerializeWithCachedSizesToArray(GRPC_SLICE_START_PTR(bytes));
+        std::vector<grpc::Slice> slices;
+        slices.emplace_back(bytes, grpc::Slice::STEAL_REF);
+        return forwarder_.submit(edge_id, message.id(), [&](Callback done) {
+            enqueue(edge_id, std::move(slices), length, std::move(done), admission);
+        });
+    }
+
+    // Forward a serialized message without blocking; a batch it fills is shipped
+    // through AsyncForwarder::start(), which parks rather than waits for a slot.
+    // See AsyncForwarder::submitAsync().
+    void forwardRaw(const std::string& edge_id, int message_id, const grpc::ByteBuffer& message, Callback reply,
+                    AsyncForwarder::Admission* admission = nullptr) {
+        if (max_messages_ <= 1) {
+            forwarder_.forwardRaw(edge_id, message_id, message, std::move(reply), admission);
+            return;
+        }
+        std::vector<grpc::Slice> slices;
+        message.Dump(&slices);
+        size_t length = message.Length();
+        forwarder_.submitAsync(edge_id, message_id, [&](Callback done) {
+            enqueue(edge_id, std::move(slices), length, std::move(done), admission);
+        }, std::move(reply));
+    }
+
+    // Batch sizes achieved so far for an edge.
+    BatchStats stats(const std::string& edge_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = queues_.find(edge_id);
+        return it == queues_.end() ? BatchStats() : it->second.stats;
+    }
+};
+
+#endif // EDGE_COALESCER_HPP
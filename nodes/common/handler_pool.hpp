@@ -0,0 +1,102 @@
+#ifndef HANDLER_POOL_HPP
+#define HANDLER_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Default number of threads running handler work that may block.
+const int DEFAULT_HANDLER_THREADS = 8;
+// Default cap on handler work waiting for one of those threads.
+const int DEFAULT_MAX_QUEUED_HANDLERS = 1024;
+
+// Worker threads for the parts of a callback-API handler that may block, such
+// as logging and storing a row (group commit) or forwarding it under
+// ack_mode "downstream". The callback thread posts the work and returns, and
+// the work finishes the reactor itself. The queue is bounded so a node that
+// cannot keep up turns callers away instead of queueing without limit.
+class HandlerPool {
+public:
+    using Task = std::function<void()>;
+
+private:
+    std::string node_name_;
+    size_t max_queued_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Task> tasks_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            Task task = std::move(tasks_.front());
+            tasks_.pop_front();
+            lock.unlock();
+            try {
+                task();
+            } catch (const std::exception& e) {
+                std::cerr << node_name_ << ": Handler failed: " << e.what() << std::endl;
+            }
+            lock.lock();
+        }
+    }
+
+public:
+    HandlerPool(const std::string& node_name, int threads, int max_queued)
+        : node_name_(node_name),
+          max_queued_(max_queued < 1 ? 1 : static_cast<size_t>(max_queued)) {
+        for (int i = 0; i < (threads < 1 ? 1 : threads); i++) {
+            threads_.emplace_back(&HandlerPool::run, this);
+        }
+    }
+
+    HandlerPool(const std::string& node_name, const json& config)
+        : HandlerPool(node_name,
+                      config.value("handler_threads", DEFAULT_HANDLER_THREADS),
+                      config.value("max_queued_handlers", DEFAULT_MAX_QUEUED_HANDLERS)) {}
+
+    // Work already queued still runs before the threads exit.
+    ~HandlerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    HandlerPool(const HandlerPool&) = delete;
+    HandlerPool& operator=(const HandlerPool&) = delete;
+
+    // Queue a task for a worker thread. False, without queueing it, when
+    // max_queued tasks are already waiting.
+    bool post(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (tasks_.size() >= max_queued_) {
+                return false;
+            }
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+        return true;
+    }
+};
+
+#endif // HANDLER_POOL_HPP
@@ -0,0 +1,99 @@
+#ifndef HASH_RING_HPP
+#define HASH_RING_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "channel_pool.hpp"
+#include "routing_hash.hpp"
+
+using json = nlohmann::json;
+
+// Default number of ring points placed per unit of weight.
+const int DEFAULT_VIRTUAL_NODES = 64;
+
+// A node that owns part of a hash ring.
+struct RingMember {
+    std::string id;
+    int weight;
+};
+
+// Consistent-hash ring with virtual nodes.
+// Each member is placed at weight * virtual_nodes points, so adding or removing
+// a member only moves the keys on the arcs it gains or loses (about 1/N of them).
+// Point positions depend only on the member ids, so every process that builds
+// a ring from the same members agrees on ownership.
+class HashRing {
+private:
+    std::vector<std::pair<uint64_t, size_t>> points_;   // sorted (position, member index)
+    std::vector<std::string> members_;
+    uint64_t salt_;
+
+    // splitmix64 finalizer; spreads a salted key over the ring.
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    }
+
+public:
+    // `ring_id` salts every lookup. Nodes further down a routing path build their
+    // own rings over the keys they were handed; salting with a different id keeps
+    // those rings independent of the upstream one, so keys still split by weight.
+    HashRing(const std::string& ring_id, const std::vector<RingMember>& members, int virtual_nodes) {
+        if (members.empty()) {
+            throw std::runtime_error("Hash ring " + ring_id + " has no members");
+        }
+        if (virtual_nodes < 1) {
+            virtual_nodes = 1;
+        }
+        FastRoutingHash position;
+        salt_ = position.hash(ring_id);
+        for (size_t m = 0; m < members.size(); ++m) {
+            members_.push_back(members[m].id);
+            int points = std::max(members[m].weight, 0) * virtual_nodes;
+            for (int i = 0; i < points; ++i) {
+                points_.emplace_back(position.hash(members[m].id + "#" + std::to_string(i)), m);
+            }
+        }
+        if (points_.empty()) {
+            throw std::runtime_error("Hash ring " + ring_id + " has no weighted members");
+        }
+        std::sort(points_.begin(), points_.end());
+    }
+
+    // Id of the member owning a key hash: the first point at or after the key, wrapping around.
+    const std::string& owner(uint64_t key_hash) const {
+        uint64_t key = mix(key_hash ^ salt_);
+        auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(key, size_t{0}));
+        if (it == points_.end()) {
+            it = points_.begin();
+        }
+        return members_[it->second];
+    }
+
+    const std::vector<std::string>& members() const {
+        return members_;
+    }
+};
+
+// Build a node's ring from its config.json: the node itself ("id", "weight")
+// plus every downstream edge, each with its own optional "weight".
+inline HashRing buildHashRing(const json& config, const std::string& default_id) {
+    std::string self_id = config.value("id", default_id);
+    std::vector<RingMember> members;
+    members.push_back({self_id, config.value("weight", 1)});
+    for (const auto& edge : loadEdges(config)) {
+        members.push_back({edge.id, edge.weight});
+    }
+    return HashRing(self_id, members, config.value("virtual_nodes", DEFAULT_VIRTUAL_NODES));
+}
+
+#endif // HASH_RING_HPP
@@ -0,0 +1,361 @@
+#ifndef INDEX_RUN_HPP
+#define INDEX_RUN_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "column_store.hpp"
+#include "crc32c.hpp"
+#include "row_segment.hpp"
+#include "table_writer.hpp"
+
+// Index run: an immutable, sorted part of a row index (see row_index.hpp),
+// mapping row_index -> RowLocation.
+//
+//   file    := header entry* bloom fence* footer
+//   header  := "NRUN" u16 version u16 reserved u64 entry_count        (16 bytes)
+//   entry   := i32 row_index u32 segment u64 offset u32 length        (20 bytes)
+//   bloom   := u32 hash_count u32 bit_count u8 bits[bit_count / 8]
+//   fence   := i32 first_row_index u32 crc32c(block)                  (8 bytes)
+//   footer  := u64 bloom_offset u64 fence_offset u32 crc32c(bloom fence*) "NRUN"
+//
+// Entries are sorted by row_index, one per row_index, and grouped into blocks
+// of RUN_BLOCK_ENTRIES; each block has a fence holding its first row_index and
+// checksum. A lookup asks the Bloom filter first (about 1% false positives at
+// RUN_BLOOM_BITS_PER_ENTRY), then binary-searches the fences and reads a single
+// block, so it touches one block of the file whatever the run's size. The
+// filter and fences are checked when the run is opened, a block when it is read.
+
+const char RUN_MAGIC[4] = {'N', 'R', 'U', 'N'};
+const uint16_t RUN_VERSION = 1;
+const size_t RUN_HEADER_SIZE = 16;
+const size_t RUN_ENTRY_SIZE = 20;
+const size_t RUN_FENCE_SIZE = 8;
+const size_t RUN_FOOTER_SIZE = 24;
+const size_t RUN_BLOCK_ENTRIES = 256;
+const uint32_t RUN_BLOOM_BITS_PER_ENTRY = 10;
+const uint32_t RUN_BLOOM_HASHES = 7;
+
+// Bloom filter hash of a row_index (splitmix64 finaliser); the two halves
+// seed the filter's probes by double hashing.
+inline uint64_t runHash(int32_t row_index) {
+    uint64_t x = static_cast<uint32_t>(row_index) + 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Writes a run from entries given in increasing row_index order. The file
+// only counts once finish() has returned; until then (or if the writer is
+// dropped) it is incomplete and is removed.
+class IndexRunWriter {
+private:
+    std::string path_;
+    int fd_ = -1;
+    std::string out_;                 // entries not yet written
+    uint64_t entries_ = 0;
+    uint64_t offset_ = 0;             // bytes written to the file
+    uint32_t bloom_bits_;
+    std::vector<uint8_t> bloom_;
+    std::string fences_;
+    uint32_t block_crc_ = 0;          // crc32c of the current block so far
+    bool finished_ = false;
+
+    void writeOut(const std::string& data) {
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = ::write(fd_, data.data() + done, data.size() - done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                throw std::runtime_error("Failed to write index run " + path_ + ": " + std::strerror(errno));
+            }
+            done += static_cast<size_t>(n);
+        }
+        offset_ += data.size();
+    }
+
+    void endBlock() {
+        putU32(&fences_, block_crc_);
+        block_crc_ = 0;
+    }
+
+public:
+    // Create run `path`, sizing its Bloom filter for up to `expected_entries`.
+    IndexRunWriter(const std::string& path, size_t expected_entries) : path_(path) {
+        uint64_t bits = std::max<uint64_t>(64, expected_entries * RUN_BLOOM_BITS_PER_ENTRY);
+        bloom_bits_ = static_cast<uint32_t>(std::min<uint64_t>((bits + 7) / 8 * 8, UINT32_MAX - 7));
+        bloom_.assign(bloom_bits_ / 8, 0);
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Failed to create index run " + path_ + ": " + std::strerror(errno));
+        }
+        std::string header(RUN_MAGIC, sizeof(RUN_MAGIC));
+        putU16(&header, RUN_VERSION);
+        putU16(&header, 0);
+        putU64(&header, 0);   // entry count, patched by finish()
+        writeOut(header);
+    }
+
+    ~IndexRunWriter() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        if (!finished_) {
+            ::unlink(path_.c_str());
+        }
+    }
+
+    IndexRunWriter(const IndexRunWriter&) = delete;
+    IndexRunWriter& operator=(const IndexRunWriter&) = delete;
+
+    void add(int32_t row_index, const RowLocation& location) {
+        if (entries_ % RUN_BLOCK_ENTRIES == 0) {
+            if (entries_ > 0) {
+                endBlock();
+            }
+            putU32(&fences_, static_cast<uint32_t>(row_index));
+        }
+        size_t start = out_.size();
+        putU32(&out_, static_cast<uint32_t>(row_index));
+        putU32(&out_, location.segment);
+        putU64(&out_, location.offset);
+        putU32(&out_, location.length);
+        block_crc_ = crc32c(out_.data() + start, RUN_ENTRY_SIZE, block_crc_);
+        uint64_t hash = runHash(row_index);
+        uint32_t h1 = static_cast<uint32_t>(hash);
+        uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+        for (uint32_t i = 0; i < RUN_BLOOM_HASHES; i++) {
+            uint32_t bit = (h1 + i * h2) % bloom_bits_;
+            bloom_[bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+        }
+        entries_++;
+        if (out_.size() >= (1 << 20)) {
+            writeOut(out_);
+            out_.clear();
+        }
+    }
+
+    uint64_t entries() const {
+        return entries_;
+    }
+
+    // Write the filter, fences and footer and sync the file.
+    void finish() {
+        if (entries_ > 0) {
+            endBlock();
+        }
+        uint64_t bloom_offset = offset_ + out_.size();
+        putU32(&out_, RUN_BLOOM_HASHES);
+        putU32(&out_, bloom_bits_);
+        out_.append(reinterpret_cast<const char*>(bloom_.data()), bloom_.size());
+        uint64_t fence_offset = offset_ + out_.size();
+        out_ += fences_;
+        uint32_t crc = crc32c(out_.data() + (bloom_offset - offset_), out_.size() - (bloom_offset - offset_));
+        putU64(&out_, bloom_offset);
+        putU64(&out_, fence_offset);
+        putU32(&out_, crc);
+        out_.append(RUN_MAGIC, sizeof(RUN_MAGIC));
+        writeOut(out_);
+        out_.clear();
+        std::string count;
+        putU64(&count, entries_);
+        if (::pwrite(fd_, count.data(), count.size(), 8) != static_cast<ssize_t>(count.size()) ||
+            ::fdatasync(fd_) != 0) {
+            throw std::runtime_error("Failed to write index run " + path_ + ": " + std::strerror(errno));
+        }
+        ::close(fd_);
+        fd_ = -1;
+        finished_ = true;
+    }
+};
+
+// Read-only, memory-mapped run. Only the Bloom filter and fences are touched
+// on open; entry blocks are paged in as lookups reach them.
+class IndexRun {
+private:
+    std::string path_;
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    uint64_t entries_ = 0;
+    const uint8_t* bloom_ = nullptr;
+    uint32_t bloom_bits_ = 0;
+    uint32_t bloom_hashes_ = 0;
+    const uint8_t* fences_ = nullptr;
+    size_t blocks_ = 0;
+
+    const uint8_t* entry(size_t i) const {
+        return data_ + RUN_HEADER_SIZE + i * RUN_ENTRY_SIZE;
+    }
+
+    int32_t fenceKey(size_t block) const {
+        return static_cast<int32_t>(getU32(fences_ + block * RUN_FENCE_SIZE));
+    }
+
+    bool checkBlock(size_t block) const {
+        size_t first = block * RUN_BLOCK_ENTRIES;
+        size_t count = std::min<size_t>(RUN_BLOCK_ENTRIES, entries_ - first);
+        return crc32c(entry(first), count * RUN_ENTRY_SIZE) == getU32(fences_ + block * RUN_FENCE_SIZE + 4);
+    }
+
+    void fail(const std::string& what) {
+        if (data_) {
+            ::munmap(const_cast<uint8_t*>(data_), size_);
+        }
+        throw std::runtime_error(what + ": " + path_);
+    }
+
+public:
+    explicit IndexRun(const std::string& path) : path_(path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open index run " + path + ": " + std::strerror(errno));
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to stat index run " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Failed to map index run " + path + ": " + std::strerror(errno));
+            }
+            data_ = static_cast<const uint8_t*>(mapped);
+            // Lookups read one block each; don't read ahead into the next.
+            ::madvise(mapped, size_, MADV_RANDOM);
+        }
+        ::close(fd);
+        if (size_ < RUN_HEADER_SIZE + RUN_FOOTER_SIZE || std::memcmp(data_, RUN_MAGIC, sizeof(RUN_MAGIC)) != 0 ||
+            getU16(data_ + 4) != RUN_VERSION ||
+            std::memcmp(data_ + size_ - sizeof(RUN_MAGIC), RUN_MAGIC, sizeof(RUN_MAGIC)) != 0) {
+            fail("Not a complete index run");
+        }
+        entries_ = getU64(data_ + 8);
+        const uint8_t* footer = data_ + size_ - RUN_FOOTER_SIZE;
+        uint64_t bloom_offset = getU64(footer);
+        uint64_t fence_offset = getU64(footer + 8);
+        blocks_ = static_cast<size_t>((entries_ + RUN_BLOCK_ENTRIES - 1) / RUN_BLOCK_ENTRIES);
+        if (entries_ > (size_ - RUN_HEADER_SIZE) / RUN_ENTRY_SIZE ||
+            bloom_offset != RUN_HEADER_SIZE + entries_ * RUN_ENTRY_SIZE || fence_offset < bloom_offset + 8 ||
+            fence_offset + blocks_ * RUN_FENCE_SIZE != size_ - RUN_FOOTER_SIZE ||
+            crc32c(data_ + bloom_offset, fence_offset + blocks_ * RUN_FENCE_SIZE - bloom_offset) != getU32(footer + 16)) {
+            fail("Damaged index run");
+        }
+        bloom_hashes_ = getU32(data_ + bloom_offset);
+        bloom_bits_ = getU32(data_ + bloom_offset + 4);
+        bloom_ = data_ + bloom_offset + 8;
+        fences_ = data_ + fence_offset;
+        if (bloom_bits_ == 0 || bloom_bits_ % 8 != 0 || bloom_offset + 8 + bloom_bits_ / 8 != fence_offset) {
+            fail("Damaged index run");
+        }
+    }
+
+    ~IndexRun() {
+        if (data_) {
+            ::munmap(const_cast<uint8_t*>(data_), size_);
+        }
+    }
+
+    IndexRun(const IndexRun&) = delete;
+    IndexRun& operator=(const IndexRun&) = delete;
+
+    const std::string& path() const {
+        return path_;
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(entries_);
+    }
+
+    size_t bytes() const {
+        return size_;
+    }
+
+    bool mayContain(int32_t row_index) const {
+        uint64_t hash = runHash(row_index);
+        uint32_t h1 = static_cast<uint32_t>(hash);
+        uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+        for (uint32_t i = 0; i < bloom_hashes_; i++) {
+            uint32_t bit = (h1 + i * h2) % bloom_bits_;
+            if (!(bloom_[bit / 8] & (1u << (bit % 8)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Look up row_index; throws if the block holding it is damaged.
+    bool find(int32_t row_index, RowLocation* location) const {
+        if (entries_ == 0 || !mayContain(row_index)) {
+            return false;
+        }
+        // Last block starting at or before row_index.
+        size_t low = 0;
+        size_t high = blocks_;
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (fenceKey(mid) <= row_index) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (low == 0) {
+            return false;
+        }
+        size_t block = low - 1;
+        if (!checkBlock(block)) {
+            throw std::runtime_error("Damaged block in index run " + path_);
+        }
+        low = block * RUN_BLOCK_ENTRIES;
+        high = std::min<size_t>(low + RUN_BLOCK_ENTRIES, entries_);
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            int32_t key = rowIndex(mid);
+            if (key == row_index) {
+                *location = this->location(mid);
+                return true;
+            }
+            if (key < row_index) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return false;
+    }
+
+    // Entry i, in row_index order, e.g. for merging runs.
+    int32_t rowIndex(size_t i) const {
+        return static_cast<int32_t>(getU32(entry(i)));
+    }
+
+    RowLocation location(size_t i) const {
+        const uint8_t* p = entry(i);
+        return RowLocation{getU32(p + 4), getU64(p + 8), getU32(p + 16)};
+    }
+
+    // Check every block, e.g. before the entries are read in order.
+    bool verify() const {
+        for (size_t block = 0; block < blocks_; block++) {
+            if (!checkBlock(block)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif // INDEX_RUN_HPP
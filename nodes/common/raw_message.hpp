@@ -0,0 +1,85 @@
+#ifndef RAW_MESSAGE_HPP
+#define RAW_MESSAGE_HPP
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/support/proto_buffer_reader.h>
+#include "data.grpc.pb.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Full method names used when forwarding serialized messages through a GenericStub.
+const char* const PUSH_DATA_METHOD = "/data.DataService/PushData";
+const char* const PUSH_BATCH_METHOD = "/data.DataService/PushBatch";
+
+// Routing fields of a serialized DataMessage.
+struct RouteHeader {
+    int32_t id = 0;
+    bool has_route_hash = false;
+    uint64_t route_hash = 0;
+    uint32_t hop_count = 0;
+};
+
+// Read the routing fields of a serialized DataMessage without parsing it.
+// The payload and any unknown fields are skipped in place, never copied.
+// Returns false when the bytes are not a well-formed message.
+inline bool scanRouteHeader(const grpc::ByteBuffer& buffer, RouteHeader* header) {
+    using google::protobuf::internal::WireFormatLite;
+    // Copying a ByteBuffer only takes references to its slices.
+    grpc::ByteBuffer view(buffer);
+    grpc::ProtoBufferReader reader(&view);
+    google::protobuf::io::CodedInputStream input(&reader);
+    while (uint32_t tag = input.ReadTag()) {
+        switch (WireFormatLite::GetTagFieldNumber(tag)) {
+            case data::DataMessage::kIdFieldNumber: {
+                uint32_t id;
+                if (!input.ReadVarint32(&id)) {
+                    return false;
+                }
+                header->id = static_cast<int32_t>(id);
+                break;
+            }
+            case data::DataMessage::kRouteHashFieldNumber:
+                if (!input.ReadLittleEndian64(&header->route_hash)) {
+                    return false;
+                }
+                header->has_route_hash = true;
+                break;
+            case data::DataMessage::kHopCountFieldNumber:
+                if (!input.ReadVarint32(&header->hop_count)) {
+                    return false;
+                }
+                break;
+            default:
+                if (!WireFormatLite::SkipField(&input, tag)) {
+                    return false;
+                }
+                break;
+        }
+    }
+    return input.ConsumedEntireMessage();
+}
+
+// Serialized message with hop_count replaced by `hop_count`.
+// The original slices are shared and the new value is appended as one more
+// field; for a singular field protobuf keeps the last value on the wire.
+inline grpc::ByteBuffer withHopCount(const grpc::ByteBuffer& buffer, uint32_t hop_count) {
+    using google::protobuf::internal::WireFormatLite;
+    std::vector<grpc::Slice> slices;
+    buffer.Dump(&slices);
+    uint8_t field[1 + 5];
+    uint8_t* end = WireFormatLite::WriteUInt32ToArray(data::DataMessage::kHopCountFieldNumber, hop_count, field);
+    slices.emplace_back(field, static_cast<size_t>(end - field));
+    return grpc::ByteBuffer(slices.data(), slices.size());
+}
+
+// Parse a serialized DataMessage, for rows that are handled locally.
+inline bool parseMessage(const grpc::ByteBuffer& buffer, data::DataMessage* message) {
+    grpc::ByteBuffer view(buffer);
+    grpc::ProtoBufferReader reader(&view);
+    return message->ParseFromZeroCopyStream(&reader);
+}
+
+#endif // RAW_MESSAGE_HPP
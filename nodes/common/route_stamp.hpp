@@ -0,0 +1,134 @@
+#ifndef ROUTE_STAMP_HPP
+#define ROUTE_STAMP_HPP
+
+#include <grpcpp/grpcpp.h>
+#include "data.grpc.pb.h"
+#include "routing_hash.hpp"
+#include <charconv>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Default number of routing hops after which a message is treated as looping.
+const int DEFAULT_MAX_HOPS = 8;
+
+// What a row is routed by: its whole payload, or the row_index in its first column.
+enum class RoutingKey {
+    Payload,
+    RowIndex
+};
+
+inline RoutingKey parseRoutingKey(const std::string& key) {
+    if (key == "payload") {
+        return RoutingKey::Payload;
+    }
+    if (key == "row_index") {
+        return RoutingKey::RowIndex;
+    }
+    throw std::runtime_error("Unknown routing_key: " + key);
+}
+
+// Parse a row_index field the way std::stoi does (leading blanks, optional sign,
+// trailing text ignored). Returns false when the field does not start with a number.
+inline bool parseRowIndex(std::string_view field, int32_t* row_index) {
+    size_t at = field.find_first_not_of(" \t\n\r\f\v");
+    if (at == std::string_view::npos) {
+        return false;
+    }
+    if (field[at] == '+') {
+        at++;
+    }
+    const char* end = field.data() + field.size();
+    return std::from_chars(field.data() + at, end, *row_index).ec == std::errc();
+}
+
+// Reuse of the routing hash carried in DataMessage.route_hash.
+// The first routing node hashes the payload and stamps the result into every
+// message it forwards; later nodes trust the stamp instead of hashing again,
+// unless "verify_route_hash" asks them to check it. With "routing_key":
+// "row_index" the hash covers only the row index, so a GetRow can be routed
+// to the same node as the row.
+class RouteStamp {
+private:
+    const RoutingHash& hash_;
+    std::string node_name_;
+    bool verify_;
+    uint32_t max_hops_;
+    RoutingKey key_;
+
+public:
+    RouteStamp(const RoutingHash& hash, const std::string& node_name, const json& config)
+        : hash_(hash),
+          node_name_(node_name),
+          verify_(config.value("verify_route_hash", false)),
+          max_hops_(config.value("max_hops", DEFAULT_MAX_HOPS)),
+          key_(parseRoutingKey(config.value("routing_key", "payload"))) {}
+
+    // Reject messages that have already been forwarded max_hops times.
+    grpc::Status checkHops(int message_id, uint32_t hop_count) const {
+        if (hop_count >= max_hops_) {
+            std::cerr << node_name_ << ": Dropping message " << message_id << " after "
+                      << hop_count << " hops (routing loop?)" << std::endl;
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Message exceeded max_hops");
+        }
+        return grpc::Status::OK;
+    }
+
+    grpc::Status checkHops(const data::DataMessage& message) const {
+        return checkHops(message.id(), message.hop_count());
+    }
+
+    // Whether carried hashes are checked against the payload rather than trusted.
+    bool verifies() const {
+        return verify_;
+    }
+
+    bool routesByRowIndex() const {
+        return key_ == RoutingKey::RowIndex;
+    }
+
+    // Routing hash of a row index, as used for rows and GetRow under "row_index".
+    uint64_t rowHash(int32_t row_index) const {
+        return hash_.hash(std::to_string(row_index));
+    }
+
+    // Routing hash of a payload under the configured key. Rows without a
+    // numeric first column are routed by their payload.
+    uint64_t keyHash(const std::string& payload) const {
+        int32_t row_index;
+        if (key_ == RoutingKey::RowIndex &&
+            parseRowIndex(std::string_view(payload).substr(0, payload.find(',')), &row_index)) {
+            return rowHash(row_index);
+        }
+        return hash_.hash(payload);
+    }
+
+    // Routing hash of a message: the carried one when present, otherwise computed.
+    uint64_t routeHash(const data::DataMessage& message) const {
+        if (!message.has_route_hash()) {
+            return keyHash(message.payload());
+        }
+        if (verify_) {
+            uint64_t computed = keyHash(message.payload());
+            if (computed != message.route_hash()) {
+                std::cerr << node_name_ << ": Carried route hash of message " << message.id()
+                          << " does not match the payload; using the recomputed hash" << std::endl;
+                return computed;
+            }
+        }
+        return message.route_hash();
+    }
+
+    // Record the routing decision on a message about to be forwarded.
+    static void stamp(data::DataMessage* message, uint64_t route_hash) {
+        message->set_route_hash(route_hash);
+        message->set_hop_count(message->hop_count() + 1);
+    }
+};
+
+#endif // ROUTE_STAMP_HPP
@@ -0,0 +1,231 @@
+#ifndef ROUTING_CLIENT_HPP
+#define ROUTING_CLIENT_HPP
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <grpcpp/grpcpp.h>
+#include <nlohmann/json.hpp>
+#include "data.grpc.pb.h"
+#include "data_client.hpp"
+#include "hash_ring.hpp"
+#include "route_stamp.hpp"
+#include "routing_hash.hpp"
+
+using json = nlohmann::json;
+
+// Load a routing table, e.g. nodes/routing_table.json.
+inline json loadRoutingTable(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open routing table " + path);
+    }
+    json table;
+    file >> table;
+    return table;
+}
+
+// Producer-side router that sends each row straight to the node that stores it.
+// The routing table lists every node with the same keys as its config.json
+// ("id", "weight", "edges", "virtual_nodes") plus its "address", so the client
+// builds the same hash rings as the servers and walks them from the "entry"
+// node (B) to the owner. Rows are stamped with their route hash, so the owner
+// stores them without forwarding. When the owner cannot be reached, the row
+// goes to the entry node, which routes it as before. GetRow lookups are sent
+// to the owner of the row index when the table routes by "routing_key":
+// "row_index", and to the entry node otherwise. Scans go to every node.
+class RoutingClient {
+private:
+    struct Node {
+        std::string address;
+        std::unique_ptr<HashRing> ring;   // null for nodes that only store
+        std::unique_ptr<DataClient> client;
+    };
+
+    std::unique_ptr<RoutingHash> routing_hash_;
+    std::unique_ptr<RouteStamp> route_stamp_;
+    std::unordered_map<std::string, Node> nodes_;
+    std::string entry_;
+    uint32_t max_hops_;
+
+    Node& node(const std::string& id) {
+        auto it = nodes_.find(id);
+        if (it == nodes_.end()) {
+            throw std::runtime_error("Routing table has no node " + id);
+        }
+        return it->second;
+    }
+
+    // Whether a failed direct send should be retried through the entry node.
+    // Backpressure is reported to the producer rather than moved onto B.
+    static bool shouldFallBack(const grpc::Status& status) {
+        return status.error_code() != grpc::StatusCode::RESOURCE_EXHAUSTED &&
+               status.error_code() != grpc::StatusCode::INVALID_ARGUMENT;
+    }
+
+public:
+    explicit RoutingClient(const json& table)
+        : routing_hash_(makeRoutingHash(table.value("hash_policy", "fast"))),
+          entry_(table.value("entry", "B")),
+          max_hops_(table.value("max_hops", DEFAULT_MAX_HOPS)) {
+        route_stamp_ = std::make_unique<RouteStamp>(*routing_hash_, "RoutingClient", table);
+        for (const auto& entry : table.at("nodes")) {
+            std::string id = entry.at("id").get<std::string>();
+            Node node;
+            node.address = entry.at("address").get<std::string>();
+            if (entry.contains("edges") && !entry["edges"].empty()) {
+                node.ring = std::make_unique<HashRing>(buildHashRing(entry, id));
+            }
+            node.client = std::make_unique<DataClient>(
+                grpc::CreateChannel(node.address, grpc::InsecureChannelCredentials()));
+            nodes_[id] = std::move(node);
+        }
+        node(entry_);
+    }
+
+    // Node that stores a payload; *route_hash and *hops receive what the routing
+    // nodes would have stamped on the way there.
+    std::string ownerOf(const std::string& payload, uint64_t* route_hash, uint32_t* hops) {
+        *route_hash = route_stamp_->keyHash(payload);
+        return ownerOfHash(*route_hash, hops);
+    }
+
+    // Node a routing hash ends up on, walking the rings from the entry node.
+    std::string ownerOfHash(uint64_t hash, uint32_t* hops) {
+        std::string current = entry_;
+        uint32_t depth = 0;
+        while (depth < max_hops_) {
+            Node& n = node(current);
+            if (!n.ring) {
+                break;
+            }
+            const std::string& owner = n.ring->owner(hash);
+            if (owner == current) {
+                break;
+            }
+            current = owner;
+            depth++;
+        }
+        *hops = depth;
+        return current;
+    }
+
+    // Send one row to its owner, falling back to the entry node.
+    grpc::Status push(const data::DataMessage& message) {
+        uint64_t route_hash;
+        uint32_t hops;
+        std::string owner = ownerOf(message.payload(), &route_hash, &hops);
+        if (owner == entry_) {
+            return node(entry_).client->Send(message);
+        }
+        data::DataMessage routed = message;
+        routed.set_route_hash(route_hash);
+        routed.set_hop_count(hops);
+        grpc::Status status = node(owner).client->Send(routed);
+        if (status.ok() || !shouldFallBack(status)) {
+            return status;
+        }
+        std::cerr << "RoutingClient: Node " << owner << " unreachable (" << status.error_message()
+                  << "), sending message " << message.id() << " through Node " << entry_ << std::endl;
+        return node(entry_).client->Send(message);
+    }
+
+    // Look up a row by row_index, asking its owner directly when the table routes by row index.
+    grpc::Status getRow(int32_t row_index, data::Row* row) {
+        if (!route_stamp_->routesByRowIndex()) {
+            return node(entry_).client->GetRow(row_index, row);
+        }
+        uint32_t hops;
+        std::string owner = ownerOfHash(route_stamp_->rowHash(row_index), &hops);
+        grpc::Status status = node(owner).client->GetRow(row_index, row, hops);
+        if (status.ok() || owner == entry_ || status.error_code() == grpc::StatusCode::NOT_FOUND ||
+            !shouldFallBack(status)) {
+            return status;
+        }
+        std::cerr << "RoutingClient: Node " << owner << " unreachable (" << status.error_message()
+                  << "), looking up row " << row_index << " through Node " << entry_ << std::endl;
+        row->Clear();
+        return node(entry_).client->GetRow(row_index, row);
+    }
+
+    // Scan the table of node `only`, or of every node in turn, calling
+    // fn(const data::Row&, const std::string& node) for each matching row;
+    // request.limit() caps the total. Routing nodes also store the rows they
+    // pass on, so a row may come back from more than one node. A node that
+    // fails is reported and skipped, and its status returned.
+    template <typename Fn>
+    grpc::Status scan(const data::ScanRequest& request, Fn fn, const std::string& only = "") {
+        std::vector<std::string> ids;
+        for (const auto& entry : nodes_) {
+            if (only.empty() || entry.first == only) {
+                ids.push_back(entry.first);
+            }
+        }
+        if (ids.empty()) {
+            node(only);
+        }
+        std::sort(ids.begin(), ids.end());
+        grpc::Status result = grpc::Status::OK;
+        uint64_t rows = 0;
+        for (const auto& id : ids) {
+            if (request.limit() > 0 && rows >= request.limit()) {
+                break;
+            }
+            data::ScanRequest remaining = request;
+            if (request.limit() > 0) {
+                remaining.set_limit(request.limit() - rows);
+            }
+            grpc::Status status = node(id).client->Scan(remaining, [&](const data::Row& row, const std::string& by) {
+                rows++;
+                fn(row, by);
+            });
+            if (!status.ok()) {
+                std::cerr << "RoutingClient: Scan of Node " << id << " failed: " << status.error_message()
+                          << std::endl;
+                if (result.ok()) {
+                    result = status;
+                }
+            }
+        }
+        return result;
+    }
+
+    // Send rows grouped into one PushBatch per owner, falling back to the entry node per group.
+    grpc::Status pushBatch(const std::vector<data::DataMessage>& messages) {
+        std::unordered_map<std::string, data::DataBatch> batches;
+        std::unordered_map<std::string, data::DataBatch> originals;
+        for (const auto& message : messages) {
+            uint64_t route_hash;
+            uint32_t hops;
+            std::string owner = ownerOf(message.payload(), &route_hash, &hops);
+            data::DataMessage* routed = batches[owner].add_messages();
+            *routed = message;
+            if (owner != entry_) {
+                routed->set_route_hash(route_hash);
+                routed->set_hop_count(hops);
+                *originals[owner].add_messages() = message;
+            }
+        }
+        grpc::Status result = grpc::Status::OK;
+        for (const auto& entry : batches) {
+            grpc::Status status = node(entry.first).client->SendBatch(entry.second);
+            if (!status.ok() && entry.first != entry_ && shouldFallBack(status)) {
+                std::cerr << "RoutingClient: Node " << entry.first << " unreachable (" << status.error_message()
+                          << "), sending " << entry.second.messages_size() << " messages through Node "
+                          << entry_ << std::endl;
+                status = node(entry_).client->SendBatch(originals[entry.first]);
+            }
+            if (!status.ok() && result.ok()) {
+                result = status;
+            }
+        }
+        return result;
+    }
+};
+
+#endif // ROUTING_CLIENT_HPP
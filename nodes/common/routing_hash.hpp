@@ -0,0 +1,147 @@
+#ifndef ROUTING_HASH_HPP
+#define ROUTING_HASH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <openssl/sha.h>
+
+// Hash used to pick the node that owns a row. Every node on a routing path
+// must be configured with the same policy ("hash_policy" in config.json),
+// otherwise they disagree on ownership.
+class RoutingHash {
+public:
+    virtual ~RoutingHash() = default;
+    virtual uint64_t hash(const char* data, size_t size) const = 0;
+    virtual const char* name() const = 0;
+
+    uint64_t hash(const std::string& data) const {
+        return hash(data.data(), data.size());
+    }
+};
+
+// Fast non-cryptographic hash (wyhash, final version 4; public domain).
+// Long inputs are consumed in three independent 16-byte lanes so the
+// multiplies overlap; short rows cost a few nanoseconds.
+class FastRoutingHash final : public RoutingHash {
+private:
+    static constexpr uint64_t kSecret[4] = {
+        0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+    };
+
+    uint64_t seed_;
+
+    static void mum(uint64_t* a, uint64_t* b) {
+        __uint128_t r = *a;
+        r *= *b;
+        *a = static_cast<uint64_t>(r);
+        *b = static_cast<uint64_t>(r >> 64);
+    }
+
+    static uint64_t mix(uint64_t a, uint64_t b) {
+        mum(&a, &b);
+        return a ^ b;
+    }
+
+    static uint64_t read8(const uint8_t* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static uint64_t read4(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static uint64_t read3(const uint8_t* p, size_t k) {
+        return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+    }
+
+public:
+    using RoutingHash::hash;
+
+    explicit FastRoutingHash(uint64_t seed = 0) : seed_(seed) {}
+
+    uint64_t hash(const char* data, size_t size) const override {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        uint64_t seed = seed_ ^ mix(seed_ ^ kSecret[0], kSecret[1]);
+        uint64_t a;
+        uint64_t b;
+        if (size <= 16) {
+            if (size >= 4) {
+                a = (read4(p) << 32) | read4(p + ((size >> 3) << 2));
+                b = (read4(p + size - 4) << 32) | read4(p + size - 4 - ((size >> 3) << 2));
+            } else if (size > 0) {
+                a = read3(p, size);
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            size_t i = size;
+            if (i > 48) {
+                uint64_t see1 = seed;
+                uint64_t see2 = seed;
+                do {
+                    seed = mix(read8(p) ^ kSecret[1], read8(p + 8) ^ seed);
+                    see1 = mix(read8(p + 16) ^ kSecret[2], read8(p + 24) ^ see1);
+                    see2 = mix(read8(p + 32) ^ kSecret[3], read8(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16) {
+                seed = mix(read8(p) ^ kSecret[1], read8(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = read8(p + i - 16);
+            b = read8(p + i - 8);
+        }
+        a ^= kSecret[1];
+        b ^= seed;
+        mum(&a, &b);
+        return mix(a ^ kSecret[0] ^ size, b ^ kSecret[1]);
+    }
+
+    const char* name() const override {
+        return "fast";
+    }
+};
+
+// SHA-256 over the payload, as the nodes originally routed. The low 32 bits
+// equal the old "first 4 bytes of the digest" value, so hash % 4 is unchanged.
+class Sha256RoutingHash final : public RoutingHash {
+public:
+    using RoutingHash::hash;
+
+    uint64_t hash(const char* data, size_t size) const override {
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256(reinterpret_cast<const unsigned char*>(data), size, digest);
+        uint64_t value;
+        std::memcpy(&value, digest, sizeof(value));
+        return value;
+    }
+
+    const char* name() const override {
+        return "sha256";
+    }
+};
+
+// Build the routing hash named by a "hash_policy" value.
+inline std::unique_ptr<RoutingHash> makeRoutingHash(const std::string& policy) {
+    if (policy == "fast") {
+        return std::make_unique<FastRoutingHash>();
+    }
+    if (policy == "sha256") {
+        return std::make_unique<Sha256RoutingHash>();
+    }
+    throw std::runtime_error("Unknown hash_policy: " + policy);
+}
+
+#endif // ROUTING_HASH_HPP
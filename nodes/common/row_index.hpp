@@ -0,0 +1,655 @@
+#ifndef ROW_INDEX_HPP
+#define ROW_INDEX_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <grpcpp/grpcpp.h>
+#include <nlohmann/json.hpp>
+#include "data.grpc.pb.h"
+#include "async_forwarder.hpp"
+#include "channel_pool.hpp"
+#include "hash_ring.hpp"
+#include "index_run.hpp"
+#include "route_stamp.hpp"
+#include "table_manifest.hpp"
+#include "table_writer.hpp"
+
+using json = nlohmann::json;
+
+// Default deadline for a GetRow passed on to another node.
+const int DEFAULT_GET_ROW_TIMEOUT_MS = 1000;
+// Default number of row indices the memtable collects before a checkpoint writes it out as a run.
+const int DEFAULT_MEMTABLE_ROWS = 1 << 18;
+// Default number of index runs above which the newest are merged.
+const int DEFAULT_INDEX_MAX_RUNS = 8;
+
+// Primary index of a node's local table: row_index -> location of the latest
+// row stored under it, kept as a log-structured merge tree whose values are
+// the rows' places in the table. add() upserts into a sorted in-memory
+// memtable. At a checkpoint (see wal.hpp) a full memtable is written out as an
+// immutable sorted run (index_run.hpp) and "<name>.index" lists the runs and
+// the table position they cover:
+//   {"next_run": 7, "runs": [3, 6], "covered": {"segment": 4, "offset": 1048576}, "epoch": 2}
+// Once there are more than index_max_runs runs, the newest ones are merged in
+// the background, the latest entry for each row_index winning. A lookup tries
+// the memtable, then the runs newest first; each run answers from its Bloom
+// filter or a single block, so lookups stay cheap and memory stays bounded
+// however many rows the table holds.
+//
+// On startup the runs are kept if the table still holds the position they
+// cover and has not moved rows since they were written ("epoch", see
+// table_manifest.hpp), and only the rows after that position are scanned.
+// Otherwise the index is rebuilt from the whole table.
+class RowIndex {
+private:
+    using Memtable = std::map<int32_t, RowLocation>;
+
+    struct Run {
+        uint32_t id;
+        std::shared_ptr<const IndexRun> data;
+    };
+
+    TableWriter& table_;
+    std::string node_name_;
+    size_t memtable_rows_;
+    size_t max_runs_;
+
+    // Guards everything up to manifest_mutex_.
+    mutable std::shared_mutex mutex_;
+    Memtable memtable_;                          // entries added since the last freeze()
+    std::shared_ptr<const Memtable> frozen_;     // set aside by freeze() until flush() has written it
+    TablePosition frozen_position_;
+    uint64_t frozen_epoch_ = 0;
+    std::shared_ptr<const std::vector<Run>> runs_ = std::make_shared<std::vector<Run>>();   // oldest first
+    TablePosition covered_;                      // what "<name>.index" says the runs cover
+    uint64_t epoch_ = 0;                         // table epoch "<name>.index" was written in
+    bool stored_ = false;                        // "<name>.index" lists runs_
+
+    // Held by flush() and merges while they write runs and "<name>.index".
+    std::mutex manifest_mutex_;
+    uint32_t next_run_ = 1;
+
+    std::mutex merge_mutex_;
+    std::condition_variable merge_cv_;           // more runs to merge, or stopping
+    std::atomic<bool> stopping_{false};
+    std::thread merger_;
+
+    std::string manifestPath() const {
+        return table_.name() + ".index";
+    }
+
+    std::string runPath(uint32_t id) const {
+        return table_.name() + ".run." + std::to_string(id);
+    }
+
+    // Look row_index up in the memtables. Called with mutex_ held.
+    bool findInMemory(int32_t row_index, RowLocation* location) const {
+        auto it = memtable_.find(row_index);
+        if (it != memtable_.end()) {
+            *location = it->second;
+            return true;
+        }
+        if (frozen_) {
+            it = frozen_->find(row_index);
+            if (it != frozen_->end()) {
+                *location = it->second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool findInRuns(const std::vector<Run>& runs, int32_t row_index, RowLocation* location) {
+        for (auto it = runs.rbegin(); it != runs.rend(); ++it) {
+            if (it->data->find(row_index, location)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool lookup(int32_t row_index, RowLocation* location) const {
+        std::shared_ptr<const std::vector<Run>> runs;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            if (findInMemory(row_index, location)) {
+                return true;
+            }
+            runs = runs_;
+        }
+        return findInRuns(*runs, row_index, location);
+    }
+
+    std::shared_ptr<const IndexRun> writeRun(uint32_t id, const Memtable& entries) const {
+        IndexRunWriter writer(runPath(id), entries.size());
+        for (const auto& entry : entries) {
+            writer.add(entry.first, entry.second);
+        }
+        writer.finish();
+        return std::make_shared<const IndexRun>(runPath(id));
+    }
+
+    // Rewrite "<name>.index". Called with manifest_mutex_ held.
+    void storeManifest(const std::vector<Run>& runs, const TablePosition& covered, uint64_t epoch) const {
+        json index;
+        index["next_run"] = next_run_;
+        index["runs"] = json::array();
+        for (const auto& run : runs) {
+            index["runs"].push_back(run.id);
+        }
+        index["covered"] = {{"segment", covered.segment}, {"offset", covered.offset}};
+        index["epoch"] = epoch;
+        replaceFile(manifestPath(), index.dump(2) + "\n");
+    }
+
+    // Open the runs "<name>.index" lists if they still match the table and
+    // remove any others. Returns where the table must be scanned from.
+    TablePosition load() {
+        std::vector<uint32_t> listed;
+        TablePosition covered;
+        uint64_t epoch = 0;
+        bool valid = false;
+        std::ifstream file(manifestPath());
+        if (file.is_open()) {
+            try {
+                json index;
+                file >> index;
+                next_run_ = index.at("next_run").get<uint32_t>();
+                listed = index.at("runs").get<std::vector<uint32_t>>();
+                covered.segment = index.at("covered").at("segment").get<uint32_t>();
+                covered.offset = index.at("covered").at("offset").get<uint64_t>();
+                epoch = index.at("epoch").get<uint64_t>();
+                valid = epoch == table_.epoch() && table_.contains(covered);
+                if (!valid) {
+                    std::cout << node_name_ << ": " << table_.name() << " changed since its index runs were "
+                              << "written; rebuilding the row index" << std::endl;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << node_name_ << ": Ignoring bad row index " << manifestPath() << ": " << e.what()
+                          << std::endl;
+            }
+        }
+        auto runs = std::make_shared<std::vector<Run>>();
+        if (valid) {
+            try {
+                for (uint32_t id : listed) {
+                    runs->push_back({id, std::make_shared<const IndexRun>(runPath(id))});
+                }
+            } catch (const std::exception& e) {
+                std::cerr << node_name_ << ": " << e.what() << "; rebuilding the row index" << std::endl;
+                runs->clear();
+                valid = false;
+            }
+        }
+        // Runs not listed were being written or merged away when the node stopped.
+        for (const auto& path : filesWithPrefix(table_.name() + ".run.")) {
+            bool keep = false;
+            for (const auto& run : *runs) {
+                keep = keep || run.data->path() == path;
+            }
+            if (!keep) {
+                ::unlink(path.c_str());
+            }
+        }
+        if (!valid) {
+            ::unlink(manifestPath().c_str());
+            return TablePosition();
+        }
+        runs_ = runs;
+        covered_ = covered;
+        epoch_ = epoch;
+        stored_ = true;
+        return covered;
+    }
+
+    // Write the memtable out as a run while the index is rebuilt, so memory
+    // stays bounded; "<name>.index" lists it from the first checkpoint on.
+    void spill() {
+        auto runs = std::make_shared<std::vector<Run>>(*runs_);
+        uint32_t id = next_run_++;
+        runs->push_back({id, writeRun(id, memtable_)});
+        runs_ = runs;
+        memtable_.clear();
+        stored_ = false;
+    }
+
+    // Merge the newest runs into one: at least two, reaching back while the
+    // next older run is no larger than those taken so far, so each entry is
+    // rewritten a logarithmic number of times.
+    void mergeRuns() {
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<const std::vector<Run>> snapshot;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            snapshot = runs_;
+        }
+        size_t first = snapshot->size() - 2;
+        size_t total = (*snapshot)[first].data->size() + snapshot->back().data->size();
+        while (first > 0 && (*snapshot)[first - 1].data->size() <= total) {
+            first--;
+            total += (*snapshot)[first].data->size();
+        }
+        std::vector<Run> inputs(snapshot->begin() + first, snapshot->end());
+        for (const auto& input : inputs) {
+            if (!input.data->verify()) {
+                throw std::runtime_error("Damaged index run " + input.data->path());
+            }
+        }
+        uint32_t id;
+        {
+            std::lock_guard<std::mutex> manifest(manifest_mutex_);
+            id = next_run_++;
+        }
+        IndexRunWriter writer(runPath(id), total);
+        // Cursor per input; the smallest row_index comes first and, among
+        // equal ones, the newest input, whose entry is the one kept.
+        std::vector<size_t> next(inputs.size(), 0);
+        auto later = [&](size_t a, size_t b) {
+            int32_t key_a = inputs[a].data->rowIndex(next[a]);
+            int32_t key_b = inputs[b].data->rowIndex(next[b]);
+            return key_a != key_b ? key_a > key_b : a < b;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (inputs[i].data->size() > 0) {
+                heap.push(i);
+            }
+        }
+        auto advance = [&](size_t i) {
+            if (++next[i] < inputs[i].data->size()) {
+                heap.push(i);
+            }
+        };
+        while (!heap.empty()) {
+            if (stopping_) {
+                return;
+            }
+            size_t newest = heap.top();
+            heap.pop();
+            int32_t row_index = inputs[newest].data->rowIndex(next[newest]);
+            writer.add(row_index, inputs[newest].data->location(next[newest]));
+            while (!heap.empty() && inputs[heap.top()].data->rowIndex(next[heap.top()]) == row_index) {
+                size_t older = heap.top();
+                heap.pop();
+                table_.superseded(inputs[older].data->location(next[older]));
+                advance(older);
+            }
+            advance(newest);
+        }
+        writer.finish();
+        Run merged{id, std::make_shared<const IndexRun>(runPath(id))};
+        {
+            std::lock_guard<std::mutex> manifest(manifest_mutex_);
+            // Only merges drop runs, so the inputs are still where they were.
+            auto runs = std::make_shared<std::vector<Run>>();
+            TablePosition covered;
+            uint64_t epoch;
+            bool stored;
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex_);
+                runs->assign(runs_->begin(), runs_->begin() + first);
+                runs->push_back(merged);
+                runs->insert(runs->end(), runs_->begin() + first + inputs.size(), runs_->end());
+                covered = covered_;
+                epoch = epoch_;
+                stored = stored_;
+            }
+            if (stored) {
+                storeManifest(*runs, covered, epoch);
+            }
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            runs_ = runs;
+        }
+        for (const auto& input : inputs) {
+            ::unlink(input.data->path().c_str());
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << node_name_ << ": Merged " << inputs.size() << " index runs (" << total << " entries) into "
+                  << runPath(id) << " (" << merged.data->size() << " entries) in " << elapsed.count() << " ms"
+                  << std::endl;
+    }
+
+    size_t runCount() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return runs_->size();
+    }
+
+    void mergeLoop() {
+        std::unique_lock<std::mutex> lock(merge_mutex_);
+        while (!stopping_) {
+            merge_cv_.wait(lock, [this] { return stopping_ || runCount() > max_runs_; });
+            if (stopping_) {
+                break;
+            }
+            lock.unlock();
+            bool ok = true;
+            try {
+                mergeRuns();
+            } catch (const std::exception& e) {
+                std::cerr << node_name_ << ": Merging index runs failed: " << e.what() << std::endl;
+                ok = false;
+            }
+            lock.lock();
+            if (!ok) {
+                merge_cv_.wait_for(lock, std::chrono::seconds(10), [this] { return stopping_.load(); });
+            }
+        }
+    }
+
+    void wakeMerger() {
+        {
+            std::lock_guard<std::mutex> lock(merge_mutex_);
+        }
+        merge_cv_.notify_all();
+    }
+
+public:
+    // Open the index of `table` (files "<name>.index" and "<name>.run.<id>"),
+    // bringing it up to date with the rows the table holds.
+    RowIndex(TableWriter& table, const std::string& node_name, int memtable_rows = DEFAULT_MEMTABLE_ROWS,
+             int max_runs = DEFAULT_INDEX_MAX_RUNS)
+        : table_(table),
+          node_name_(node_name),
+          memtable_rows_(memtable_rows < 1 ? 1 : static_cast<size_t>(memtable_rows)),
+          max_runs_(max_runs < 1 ? 1 : static_cast<size_t>(max_runs)) {
+        auto start = std::chrono::steady_clock::now();
+        TablePosition from = load();
+        bool reused = stored_;
+        size_t stored_runs = runs_->size();
+        size_t scanned = table_.forEachRow([this](const RowLocation& location, std::string_view first_column) {
+            int32_t row_index;
+            if (parseRowIndex(first_column, &row_index)) {
+                add(row_index, location);
+                if (memtable_.size() >= memtable_rows_) {
+                    spill();
+                }
+            }
+        }, from);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << node_name << ": Indexed " << scanned << " rows of " << table_.name();
+        if (reused) {
+            std::cout << " past its " << stored_runs << " stored index runs";
+        } else {
+            std::cout << " (" << table_.segmentCount() << " segments, " << runs_->size() << " index runs)";
+        }
+        std::cout << " in " << elapsed.count() << " ms" << std::endl;
+        // Compaction keeps a row only while it is the latest under its row_index
+        // (or has none) and repoints the index when it moves one.
+        table_.setRowIndexHooks(
+            [this](std::string_view first_column, const RowLocation& location) {
+                int32_t row_index;
+                if (!parseRowIndex(first_column, &row_index)) {
+                    return true;
+                }
+                RowLocation current;
+                return lookup(row_index, &current) && current == location;
+            },
+            [this](std::string_view first_column, const RowLocation& from, const RowLocation& to) {
+                int32_t row_index;
+                if (!parseRowIndex(first_column, &row_index)) {
+                    return true;
+                }
+                std::unique_lock<std::shared_mutex> lock(mutex_);
+                RowLocation current;
+                if (!(findInMemory(row_index, &current) || findInRuns(*runs_, row_index, &current)) ||
+                    !(current == from)) {
+                    return false;
+                }
+                memtable_[row_index] = to;
+                return true;
+            });
+        merger_ = std::thread(&RowIndex::mergeLoop, this);
+    }
+
+    RowIndex(TableWriter& table, const std::string& node_name, const json& config)
+        : RowIndex(table, node_name,
+                   config.value("memtable_rows", DEFAULT_MEMTABLE_ROWS),
+                   config.value("index_max_runs", DEFAULT_INDEX_MAX_RUNS)) {}
+
+    ~RowIndex() {
+        stopping_ = true;
+        wakeMerger();
+        if (merger_.joinable()) {
+            merger_.join();
+        }
+        table_.stopCompaction();
+        table_.setRowIndexHooks(nullptr, nullptr);
+    }
+
+    RowIndex(const RowIndex&) = delete;
+    RowIndex& operator=(const RowIndex&) = delete;
+
+    // Record a row just appended to the table.
+    void add(int32_t row_index, const RowLocation& location) {
+        RowLocation previous;
+        bool replaced = false;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            auto inserted = memtable_.emplace(row_index, location);
+            if (!inserted.second) {
+                previous = inserted.first->second;
+                replaced = true;
+                inserted.first->second = location;
+            }
+        }
+        // A version in a run is counted once the runs are merged.
+        if (replaced) {
+            table_.superseded(previous);
+        }
+    }
+
+    // Checkpoint, first half: with no add() running and the table sealed at
+    // `position`, set the memtable aside to be written out as a run if it is
+    // full, the stored runs are out of date, or `force`. Returns whether
+    // flush() has work to do.
+    bool freeze(const TablePosition& position, bool force) {
+        uint64_t epoch = table_.epoch();
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (frozen_) {
+            // The last flush() failed; it is tried again.
+            return true;
+        }
+        if (!force && stored_ && epoch == epoch_ && memtable_.size() < memtable_rows_) {
+            return false;
+        }
+        frozen_ = std::make_shared<const Memtable>(std::move(memtable_));
+        memtable_.clear();
+        frozen_position_ = position;
+        frozen_epoch_ = epoch;
+        return true;
+    }
+
+    // Checkpoint, second half: once the table is synced past the frozen
+    // position, write the frozen memtable out as a run and list it.
+    void flush() {
+        std::lock_guard<std::mutex> manifest(manifest_mutex_);
+        std::shared_ptr<const Memtable> frozen;
+        TablePosition position;
+        uint64_t epoch;
+        auto runs = std::make_shared<std::vector<Run>>();
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            frozen = frozen_;
+            position = frozen_position_;
+            epoch = frozen_epoch_;
+            *runs = *runs_;
+        }
+        if (!frozen) {
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (!frozen->empty()) {
+            uint32_t id = next_run_++;
+            runs->push_back({id, writeRun(id, *frozen)});
+        }
+        storeManifest(*runs, position, epoch);
+        size_t count = runs->size();
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            runs_ = runs;
+            frozen_.reset();
+            covered_ = position;
+            epoch_ = epoch;
+            stored_ = true;
+        }
+        if (!frozen->empty()) {
+            auto elapsed =
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            std::cout << node_name_ << ": Wrote index run " << runs->back().data->path() << " (" << frozen->size()
+                      << " entries) in " << elapsed.count() << " ms" << std::endl;
+        }
+        if (count > max_runs_) {
+            wakeMerger();
+        }
+    }
+
+    // Fill reply->columns with the row stored under row_index; false if there is none.
+    bool get(int32_t row_index, data::Row* reply) const {
+        std::vector<std::string> columns;
+        RowLocation location;
+        // A read can miss because compaction moved the row meanwhile; then look it up again.
+        for (int attempt = 0; attempt < 2; attempt++) {
+            RowLocation previous = location;
+            if (!lookup(row_index, &location)) {
+                return false;
+            }
+            if (attempt > 0 && location == previous) {
+                return false;
+            }
+            if (table_.read(location, &columns)) {
+                for (auto& column : columns) {
+                    reply->add_columns(std::move(column));
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// GetRow handling for a routing node: answer from the local index, otherwise
+// pass the lookup on. Under "routing_key": "row_index" it goes to the ring
+// owner of the row index, the same node PushData sent the row to. Under
+// "payload" the row index does not determine the owner, so every edge is
+// asked at once through the forwarder and the first to find the row answers.
+class RowLookup {
+private:
+    const RowIndex& index_;
+    const RouteStamp& route_stamp_;
+    const HashRing& ring_;
+    const ChannelPool& channels_;
+    AsyncForwarder& forwarder_;
+    std::string node_id_;
+    std::chrono::milliseconds timeout_;
+
+    // Replies of a lookup sent to every edge; shared with the callbacks, which
+    // may still run after get() has returned with the first row found.
+    struct FanOut {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<data::Row> replies;
+        size_t pending = 0;
+        int found = -1;                // index of the edge whose reply answers the lookup
+        grpc::Status result;
+    };
+
+    grpc::Status fetch(const std::string& edge_id, const data::RowRequest& request, data::Row* reply) const {
+        grpc::ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + timeout_);
+        return channels_.stub(edge_id)->GetRow(&context, request, reply);
+    }
+
+    // Ask every edge at once; the first reply with the row wins. Otherwise the
+    // result is NOT_FOUND unless an edge failed for another reason.
+    grpc::Status fetchFromAll(const data::RowRequest& request, const grpc::Status& not_found, data::Row* reply) const {
+        std::vector<std::string> edge_ids = channels_.edgeIds();
+        auto fan_out = std::make_shared<FanOut>();
+        fan_out->replies.resize(edge_ids.size());
+        fan_out->pending = edge_ids.size();
+        fan_out->result = not_found;
+        for (size_t i = 0; i < edge_ids.size(); i++) {
+            forwarder_.fetchRow(edge_ids[i], request, timeout_, &fan_out->replies[i],
+                                [fan_out, i](const grpc::Status& status) {
+                {
+                    std::lock_guard<std::mutex> lock(fan_out->mutex);
+                    fan_out->pending--;
+                    if (fan_out->found < 0) {
+                        if (status.ok()) {
+                            fan_out->found = static_cast<int>(i);
+                        } else if (status.error_code() != grpc::StatusCode::NOT_FOUND) {
+                            fan_out->result = status;
+                        }
+                    }
+                }
+                fan_out->cv.notify_all();
+            });
+        }
+        std::unique_lock<std::mutex> lock(fan_out->mutex);
+        fan_out->cv.wait(lock, [&] { return fan_out->found >= 0 || fan_out->pending == 0; });
+        if (fan_out->found >= 0) {
+            reply->Swap(&fan_out->replies[fan_out->found]);
+            return grpc::Status::OK;
+        }
+        reply->Clear();
+        return fan_out->result;
+    }
+
+public:
+    RowLookup(const RowIndex& index, const RouteStamp& route_stamp, const HashRing& ring,
+              const ChannelPool& channels, AsyncForwarder& forwarder, const std::string& node_id, int timeout_ms)
+        : index_(index),
+          route_stamp_(route_stamp),
+          ring_(ring),
+          channels_(channels),
+          forwarder_(forwarder),
+          node_id_(node_id),
+          timeout_(timeout_ms < 1 ? 1 : timeout_ms) {
+        if (!route_stamp_.routesByRowIndex() && !channels_.edgeIds().empty()) {
+            std::cerr << "Node" << node_id_ << ": Warning: routing_key \"payload\" does not say which node owns "
+                      << "a row, so a GetRow this node cannot answer is broadcast to all its edges; "
+                      << "use \"row_index\" to send it to the owner" << std::endl;
+        }
+    }
+
+    RowLookup(const RowIndex& index, const RouteStamp& route_stamp, const HashRing& ring,
+              const ChannelPool& channels, AsyncForwarder& forwarder, const std::string& node_id, const json& config)
+        : RowLookup(index, route_stamp, ring, channels, forwarder, node_id,
+                    config.value("get_row_timeout_ms", DEFAULT_GET_ROW_TIMEOUT_MS)) {}
+
+    grpc::Status get(const data::RowRequest& request, data::Row* reply) const {
+        grpc::Status hops = route_stamp_.checkHops(request.row_index(), request.hop_count());
+        if (!hops.ok()) {
+            return hops;
+        }
+        if (index_.get(request.row_index(), reply)) {
+            reply->set_node(node_id_);
+            return grpc::Status::OK;
+        }
+        grpc::Status not_found(grpc::StatusCode::NOT_FOUND, "No row with index " + std::to_string(request.row_index()));
+        data::RowRequest forwarded = request;
+        forwarded.set_hop_count(request.hop_count() + 1);
+        if (route_stamp_.routesByRowIndex()) {
+            const std::string& owner = ring_.owner(route_stamp_.rowHash(request.row_index()));
+            if (owner == node_id_ || !channels_.hasEdge(owner)) {
+                return not_found;
+            }
+            return fetch(owner, forwarded, reply);
+        }
+        return fetchFromAll(forwarded, not_found, reply);
+    }
+};
+
+#endif // ROW_INDEX_HPP
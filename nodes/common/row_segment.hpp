@@ -0,0 +1,283 @@
+#ifndef ROW_SEGMENT_HPP
+#define ROW_SEGMENT_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "crc32c.hpp"
+
+// Binary row segment: the on-disk form of a node table.
+//
+//   file    := header record*
+//   header  := "NSEG" u16 version u16 reserved                    (8 bytes)
+//   record  := u32 body_length u32 crc32c(body) body
+//   body    := u16 column_count u16 flags column_end[column_count] field_bytes
+//
+// Field i occupies field_bytes[column_end[i - 1], column_end[i]) with
+// column_end[-1] = 0, so any column is reachable without scanning the row.
+// column_end entries are u16, or u32 when flags has SEGMENT_WIDE_OFFSETS set
+// (rows with more than 64 KiB of field bytes). Integers are little-endian.
+// A record whose length or CRC does not check out (e.g. a torn write at the
+// tail after a crash) ends the readable part of the segment.
+
+const char SEGMENT_MAGIC[4] = {'N', 'S', 'E', 'G'};
+const uint16_t SEGMENT_VERSION = 1;
+const size_t SEGMENT_HEADER_SIZE = 8;
+const size_t SEGMENT_RECORD_PREFIX = 8;
+// Upper bound on a record body; anything larger is treated as corruption.
+const uint32_t SEGMENT_MAX_BODY = 64u << 20;
+// Row flag: column_end entries are u32 instead of u16.
+const uint16_t SEGMENT_WIDE_OFFSETS = 1;
+
+inline void putU16(std::string* out, uint16_t value) {
+    char bytes[2];
+    std::memcpy(bytes, &value, sizeof(value));
+    out->append(bytes, sizeof(bytes));
+}
+
+inline void putU32(std::string* out, uint32_t value) {
+    char bytes[4];
+    std::memcpy(bytes, &value, sizeof(value));
+    out->append(bytes, sizeof(bytes));
+}
+
+inline uint16_t getU16(const uint8_t* p) {
+    uint16_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t getU32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline std::string segmentHeader() {
+    std::string header(SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    putU16(&header, SEGMENT_VERSION);
+    putU16(&header, 0);
+    return header;
+}
+
+inline bool isSegmentHeader(const uint8_t* p, size_t size) {
+    return size >= SEGMENT_HEADER_SIZE && std::memcmp(p, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) == 0 &&
+           getU16(p + 4) == SEGMENT_VERSION;
+}
+
+// Append the body of a segment record for one row (no length or CRC prefix).
+template <typename Columns>
+void encodeRowBody(const Columns& columns, std::string* out) {
+    size_t field_bytes = 0;
+    for (const auto& column : columns) {
+        field_bytes += column.size();
+    }
+    bool wide = field_bytes > UINT16_MAX;
+    putU16(out, static_cast<uint16_t>(columns.size()));
+    putU16(out, wide ? SEGMENT_WIDE_OFFSETS : 0);
+    uint32_t end = 0;
+    for (const auto& column : columns) {
+        end += static_cast<uint32_t>(column.size());
+        if (wide) {
+            putU32(out, end);
+        } else {
+            putU16(out, static_cast<uint16_t>(end));
+        }
+    }
+    for (const auto& column : columns) {
+        out->append(column.data(), column.size());
+    }
+}
+
+// Append one row as a segment record.
+template <typename Columns>
+void encodeRow(const Columns& columns, std::string* out) {
+    size_t start = out->size();
+    putU32(out, 0);   // body length, patched below
+    putU32(out, 0);   // crc, patched below
+    size_t body = out->size();
+    encodeRowBody(columns, out);
+    uint32_t body_length = static_cast<uint32_t>(out->size() - body);
+    uint32_t crc = crc32c(out->data() + body, body_length);
+    std::memcpy(&(*out)[start], &body_length, sizeof(body_length));
+    std::memcpy(&(*out)[start + 4], &crc, sizeof(crc));
+}
+
+// A row inside segment bytes; valid while those bytes are (e.g. while the reader is alive).
+class RowView {
+private:
+    const uint8_t* body_ = nullptr;
+    uint16_t columns_ = 0;
+    bool wide_ = false;
+
+    uint32_t end(size_t i) const {
+        return wide_ ? getU32(body_ + 4 + 4 * i) : getU16(body_ + 4 + 2 * i);
+    }
+
+public:
+    RowView() = default;
+    explicit RowView(const uint8_t* body)
+        : body_(body), columns_(getU16(body)), wide_((getU16(body + 2) & SEGMENT_WIDE_OFFSETS) != 0) {}
+
+    size_t columnCount() const {
+        return columns_;
+    }
+
+    std::string_view column(size_t i) const {
+        if (i >= columns_) {
+            return std::string_view();
+        }
+        const char* fields = reinterpret_cast<const char*>(body_ + 4 + (wide_ ? 4 : 2) * columns_);
+        uint32_t begin = i == 0 ? 0 : end(i - 1);
+        return std::string_view(fields + begin, end(i) - begin);
+    }
+};
+
+// Whether `length` bytes at `body` form a well-formed record body: column ends
+// in order and adding up to exactly the body's size.
+inline bool isRowBody(const uint8_t* body, size_t length) {
+    if (length < 4) {
+        return false;
+    }
+    uint16_t columns = getU16(body);
+    bool wide = (getU16(body + 2) & SEGMENT_WIDE_OFFSETS) != 0;
+    uint64_t header = 4 + (wide ? 4ull : 2ull) * columns;
+    if (header > length) {
+        return false;
+    }
+    uint32_t previous = 0;
+    for (uint16_t i = 0; i < columns; ++i) {
+        uint32_t end = wide ? getU32(body + 4 + 4 * i) : getU16(body + 4 + 2 * i);
+        if (end < previous) {
+            return false;
+        }
+        previous = end;
+    }
+    return header + previous == length;
+}
+
+// Check the record at the start of `data` (at most `size` bytes) and point
+// *row at it; *record_size receives its total size. Returns false for a
+// truncated or damaged record.
+inline bool decodeRecord(const uint8_t* data, size_t size, bool verify_crc, RowView* row, size_t* record_size) {
+    if (size < SEGMENT_RECORD_PREFIX) {
+        return false;
+    }
+    uint32_t body_length = getU32(data);
+    uint32_t crc = getU32(data + 4);
+    const uint8_t* body = data + SEGMENT_RECORD_PREFIX;
+    if (body_length > SEGMENT_MAX_BODY || body_length > size - SEGMENT_RECORD_PREFIX ||
+        !isRowBody(body, body_length)) {
+        return false;
+    }
+    if (verify_crc && crc32c(body, body_length) != crc) {
+        return false;
+    }
+    *row = RowView(body);
+    *record_size = SEGMENT_RECORD_PREFIX + body_length;
+    return true;
+}
+
+// Read-only, memory-mapped view of a segment file. Rows are returned as views
+// into the mapping, so reading never copies or parses field text.
+class SegmentReader {
+public:
+    enum class Result { Row, End, Corrupt };
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool verify_crc_;
+
+public:
+    explicit SegmentReader(const std::string& path, bool verify_crc = true) : verify_crc_(verify_crc) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open segment " + path + ": " + std::strerror(errno));
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to stat segment " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Failed to map segment " + path + ": " + std::strerror(errno));
+            }
+            data_ = static_cast<const uint8_t*>(mapped);
+            ::madvise(mapped, size_, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+        if (!isSegmentHeader(data_, size_)) {
+            if (data_) {
+                ::munmap(const_cast<uint8_t*>(data_), size_);
+            }
+            throw std::runtime_error("Not a row segment: " + path);
+        }
+    }
+
+    ~SegmentReader() {
+        if (data_) {
+            ::munmap(const_cast<uint8_t*>(data_), size_);
+        }
+    }
+
+    SegmentReader(const SegmentReader&) = delete;
+    SegmentReader& operator=(const SegmentReader&) = delete;
+
+    // Offset of the first record.
+    size_t begin() const {
+        return SEGMENT_HEADER_SIZE;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    // Read the record at *offset and advance past it.
+    Result read(size_t* offset, RowView* row) const {
+        size_t at = *offset;
+        if (at >= size_) {
+            return Result::End;
+        }
+        size_t record_size;
+        if (!decodeRecord(data_ + at, size_ - at, verify_crc_, row, &record_size)) {
+            return Result::Corrupt;
+        }
+        *offset = at + record_size;
+        return Result::Row;
+    }
+
+    // Call fn(const RowView&) for every intact row; returns the number of rows.
+    // Stops at the first damaged record and reports where.
+    template <typename Fn>
+    size_t forEach(Fn fn) const {
+        size_t offset = begin();
+        size_t rows = 0;
+        RowView row;
+        Result result;
+        while ((result = read(&offset, &row)) == Result::Row) {
+            fn(row);
+            rows++;
+        }
+        if (result == Result::Corrupt) {
+            std::cerr << "Segment: damaged record at offset " << offset << " after " << rows
+                      << " rows; ignoring the remaining " << (size_ - offset) << " bytes" << std::endl;
+        }
+        return rows;
+    }
+};
+
+#endif // ROW_SEGMENT_HPP
@@ -0,0 +1,373 @@
+#ifndef STORAGE_RING_HPP
+#define STORAGE_RING_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// How table and write-ahead log appends are handed to the kernel.
+enum class StorageBackend {
+    Posix,      // write(2) until done, then fdatasync(2) if syncing
+    IoUring     // one io_uring submission: the write, linked to an fdatasync if syncing
+};
+
+inline StorageBackend parseStorageBackend(const std::string& backend) {
+    if (backend == "posix") {
+        return StorageBackend::Posix;
+    }
+    if (backend == "io_uring") {
+        return StorageBackend::IoUring;
+    }
+    throw std::runtime_error("Unknown storage_backend: " + backend);
+}
+
+// Storage backend selected by "storage_backend" in a node's config.
+inline StorageBackend storageBackend(const json& config) {
+    return parseStorageBackend(config.value("storage_backend", "posix"));
+}
+
+// A small io_uring set up with the raw system calls, used to append to files
+// opened with O_APPEND. Each append() submits the write and, when syncing, an
+// fdatasync linked behind it in a single io_uring_enter that also waits for
+// both completions, instead of one system call per write(2) chunk plus one
+// for the sync. Data inside a registered buffer goes out as a fixed write, so
+// the kernel skips pinning its pages on every call.
+//
+// Not thread-safe: one append at a time, which the group commits using it
+// already guarantee.
+//
+// append() waits for its completions itself; they are not handed back to the
+// gRPC reactors. Callers apply a row only once its group is in the log (see
+// wal.hpp), so a completion would have to resume that apply, the table write
+// and any downstream forward as continuations. Instead Nodes C and D run
+// PushData's blocking part on a HandlerPool thread (handler_pool.hpp), so the
+// wait holds one of those threads and never a gRPC callback thread; the
+// synchronous handlers of Nodes B and E and the batch and stream RPCs wait on
+// their own handler thread.
+class StorageRing {
+private:
+    static constexpr unsigned ENTRIES = 4;
+    static constexpr uint64_t WRITE = 1;
+    static constexpr uint64_t SYNC = 2;
+
+    int fd_ = -1;
+    void* sq_ring_ = MAP_FAILED;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = MAP_FAILED;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size_ = 0;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    std::vector<iovec> buffers_;          // registered with the kernel, by index
+
+    static unsigned* at(void* ring, uint32_t offset) {
+        return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+    }
+
+    void release() {
+        if (sqes_ != MAP_FAILED) {
+            ::munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+            ::munmap(cq_ring_, cq_ring_size_);
+        }
+        if (sq_ring_ != MAP_FAILED) {
+            ::munmap(sq_ring_, sq_ring_size_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    void fail(const char* what) {
+        int error = errno;
+        release();
+        throw std::runtime_error(std::string(what) + ": " + std::strerror(error));
+    }
+
+    io_uring_sqe* nextSqe(unsigned* tail) {
+        unsigned index = *tail & *sq_mask_;
+        sq_array_[index] = index;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++*tail;
+        return sqe;
+    }
+
+    // Submit `count` queued entries and collect their results by user_data.
+    bool submitAndWait(unsigned count, int* write_result, int* sync_result) {
+        unsigned submitted = 0;
+        unsigned reaped = 0;
+        while (reaped < count) {
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            for (; head != tail && reaped < count; head++, reaped++) {
+                const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+                (cqe.user_data == WRITE ? *write_result : *sync_result) = cqe.res;
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+            if (reaped == count) {
+                break;
+            }
+            long n = ::syscall(__NR_io_uring_enter, fd_, count - submitted, count - reaped,
+                               IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (submitted == 0) {
+                    return false;
+                }
+                // Entries already in flight still complete; wait them out.
+                continue;
+            }
+            submitted += static_cast<unsigned>(n);
+        }
+        return true;
+    }
+
+public:
+    StorageRing() {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, ENTRIES, &params));
+        if (fd_ < 0) {
+            fail("io_uring_setup");
+        }
+        if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+            errno = ENOTSUP;
+            fail("io_uring without appends at the file position");
+        }
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          fd_, IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) {
+            fail("mmap io_uring submission ring");
+        }
+        cq_ring_ = single ? sq_ring_
+                          : ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                   fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            fail("mmap io_uring completion ring");
+        }
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+        if (sqes_ == MAP_FAILED) {
+            fail("mmap io_uring submission entries");
+        }
+        sq_tail_ = at(sq_ring_, params.sq_off.tail);
+        sq_mask_ = at(sq_ring_, params.sq_off.ring_mask);
+        sq_array_ = at(sq_ring_, params.sq_off.array);
+        cq_head_ = at(cq_ring_, params.cq_off.head);
+        cq_tail_ = at(cq_ring_, params.cq_off.tail);
+        cq_mask_ = at(cq_ring_, params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(cq_ring_) + params.cq_off.cqes);
+    }
+
+    ~StorageRing() {
+        release();
+    }
+
+    StorageRing(const StorageRing&) = delete;
+    StorageRing& operator=(const StorageRing&) = delete;
+
+    // Register the given buffers for fixed writes, replacing any registered
+    // before. False (with errno set) if the kernel refuses, e.g. over
+    // RLIMIT_MEMLOCK; appends then use plain writes.
+    bool registerBuffers(const std::vector<iovec>& buffers) {
+        if (!buffers_.empty()) {
+            ::syscall(__NR_io_uring_register, fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+            buffers_.clear();
+        }
+        if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, buffers.data(),
+                      static_cast<unsigned>(buffers.size())) != 0) {
+            return false;
+        }
+        buffers_ = buffers;
+        return true;
+    }
+
+    size_t bufferCount() const {
+        return buffers_.size();
+    }
+
+    const iovec& buffer(size_t index) const {
+        return buffers_[index];
+    }
+
+    // Append `size` bytes to `fd` (opened O_APPEND) and fdatasync it if
+    // `sync`. `buffer` is the index of the registered buffer holding the data,
+    // or -1 if it is not in one. False with errno set on failure.
+    bool append(int fd, const char* data, size_t size, bool sync, int buffer = -1) {
+        while (size > 0 || sync) {
+            unsigned start = *sq_tail_;
+            unsigned tail = start;
+            unsigned count = 0;
+            if (size > 0) {
+                io_uring_sqe* write = nextSqe(&tail);
+                count++;
+                write->opcode = buffer >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+                write->buf_index = buffer >= 0 ? static_cast<uint16_t>(buffer) : 0;
+                write->fd = fd;
+                write->addr = reinterpret_cast<uint64_t>(data);
+                write->len = static_cast<uint32_t>(std::min<size_t>(size, 1u << 30));
+                write->off = static_cast<uint64_t>(-1);   // at the file position, i.e. the end
+                write->user_data = WRITE;
+                if (sync) {
+                    write->flags = IOSQE_IO_LINK;
+                }
+            }
+            if (sync) {
+                io_uring_sqe* fsync = nextSqe(&tail);
+                count++;
+                fsync->opcode = IORING_OP_FSYNC;
+                fsync->fd = fd;
+                fsync->fsync_flags = IORING_FSYNC_DATASYNC;
+                fsync->user_data = SYNC;
+            }
+            __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+            int written = 0;
+            int synced = 0;
+            if (!submitAndWait(count, &written, &synced)) {
+                // Nothing was submitted; take the entries back.
+                __atomic_store_n(sq_tail_, start, __ATOMIC_RELEASE);
+                return false;
+            }
+            if (size > 0) {
+                if (written == -EINTR || written == -EAGAIN) {
+                    continue;
+                }
+                if (written < 0) {
+                    errno = -written;
+                    return false;
+                }
+                if (written == 0) {
+                    errno = EIO;
+                    return false;
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+                if (size > 0) {
+                    // A short write cancels the linked sync; go again with the rest.
+                    continue;
+                }
+            }
+            if (sync && synced < 0) {
+                errno = -synced;
+                return false;
+            }
+            return true;
+        }
+        return true;
+    }
+};
+
+// Appends of one table or log, through the configured backend. With io_uring
+// the write and its fdatasync are one submission, and the double buffer of the
+// owner's group commit is registered for fixed writes. If the ring cannot be
+// set up the appender says so and falls back to write(2) and fdatasync(2).
+class Appender {
+private:
+    std::string node_name_;
+    std::string what_;
+    std::unique_ptr<StorageRing> ring_;
+
+    static bool writeAll(int fd, const char* data, size_t size) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::write(fd, data + done, size - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+public:
+    // `what` names the files appended to in log lines, e.g. "table appends".
+    Appender(StorageBackend backend, const std::string& node_name, const std::string& what)
+        : node_name_(node_name), what_(what) {
+        if (backend != StorageBackend::IoUring) {
+            return;
+        }
+        try {
+            ring_ = std::make_unique<StorageRing>();
+            std::cout << node_name_ << ": Using io_uring for " << what_ << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << node_name_ << ": io_uring unavailable (" << e.what() << "), " << what_
+                      << " use write(2)" << std::endl;
+        }
+    }
+
+    // Register the group commit buffers at their current capacity. A buffer
+    // that has since grown (and so moved) is written the plain way: only
+    // data at the start of an allocation still matching a registration goes
+    // out as a fixed write, so freed and reused memory never does.
+    void registerBuffers(std::initializer_list<const std::string*> buffers) {
+        if (!ring_) {
+            return;
+        }
+        std::vector<iovec> iovecs;
+        for (const std::string* buffer : buffers) {
+            iovecs.push_back(iovec{const_cast<char*>(buffer->data()), buffer->capacity()});
+        }
+        if (!ring_->registerBuffers(iovecs)) {
+            std::cerr << node_name_ << ": Could not register io_uring buffers for " << what_ << " ("
+                      << std::strerror(errno) << "), using plain writes" << std::endl;
+        }
+    }
+
+    // Append `data` to `fd` (opened O_APPEND), then fdatasync it if `sync`.
+    // False with errno set on failure.
+    bool append(int fd, const std::string& data, bool sync) {
+        if (ring_) {
+            int buffer = -1;
+            for (size_t i = 0; i < ring_->bufferCount(); i++) {
+                const iovec& registered = ring_->buffer(i);
+                if (registered.iov_base == data.data() && registered.iov_len == data.capacity()) {
+                    buffer = static_cast<int>(i);
+                    break;
+                }
+            }
+            return ring_->append(fd, data.data(), data.size(), sync, buffer);
+        }
+        if (!writeAll(fd, data.data(), data.size())) {
+            return false;
+        }
+        return !sync || ::fdatasync(fd) == 0;
+    }
+};
+
+#endif // STORAGE_RING_HPP
@@ -0,0 +1,299 @@
+#ifndef TABLE_MANIFEST_HPP
+#define TABLE_MANIFEST_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Default size at which the segment being written is sealed and a new one started.
+const int DEFAULT_SEGMENT_BYTES = 64 << 20;
+
+// On-disk layout of a node table.
+enum class TableFormat {
+    Csv,       // comma-joined text, one row per line
+    Segment,   // binary row segment, see row_segment.hpp
+    Columnar   // row groups of per-column chunks, see column_store.hpp
+};
+
+inline TableFormat parseTableFormat(const std::string& format) {
+    if (format == "csv") {
+        return TableFormat::Csv;
+    }
+    if (format == "segment") {
+        return TableFormat::Segment;
+    }
+    if (format == "columnar") {
+        return TableFormat::Columnar;
+    }
+    throw std::runtime_error("Unknown table_format: " + format);
+}
+
+inline const char* tableFormatName(TableFormat format) {
+    switch (format) {
+        case TableFormat::Csv: return "csv";
+        case TableFormat::Segment: return "segment";
+        default: return "columnar";
+    }
+}
+
+// Table format selected by "table_format" in a node's config.
+inline TableFormat tableFormat(const json& config) {
+    return parseTableFormat(config.value("table_format", "segment"));
+}
+
+// File holding table `name` in the given format, e.g. nodeB_table.seg. Tables
+// written before they were split into segments consist of just this file.
+inline std::string tablePath(const std::string& name, TableFormat format) {
+    switch (format) {
+        case TableFormat::Csv: return name + ".csv";
+        case TableFormat::Segment: return name + ".seg";
+        default: return name + ".col";
+    }
+}
+
+// End of a table's data: a segment and the offset just past its last row.
+struct TablePosition {
+    uint32_t segment = 0;
+    uint64_t offset = 0;
+};
+
+// fsync the directory holding `path`, so a file created or renamed in it survives a crash.
+inline void syncParentDirectory(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+// Replace `path` with `data` atomically: write a temporary file, sync it, rename it over.
+inline void replaceFile(const std::string& path, const std::string& data) {
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0;
+    size_t done = 0;
+    while (ok && done < data.size()) {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        ok = n > 0;
+        done += ok ? static_cast<size_t>(n) : 0;
+    }
+    ok = ok && ::fsync(fd) == 0;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Failed to write " + path + ": " + std::strerror(errno));
+    }
+    syncParentDirectory(path);
+}
+
+// Paths of the files whose path starts with `prefix` (e.g. "nodeB_table.run."),
+// looking only in the directory `prefix` names.
+inline std::vector<std::string> filesWithPrefix(const std::string& prefix) {
+    size_t slash = prefix.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : prefix.substr(0, slash);
+    std::string start = slash == std::string::npos ? prefix : prefix.substr(slash + 1);
+    std::vector<std::string> files;
+    DIR* handle = ::opendir(dir.c_str());
+    if (!handle) {
+        return files;
+    }
+    while (struct dirent* entry = ::readdir(handle)) {
+        std::string file = entry->d_name;
+        if (file.compare(0, start.size(), start) == 0) {
+            files.push_back(slash == std::string::npos ? file : dir + "/" + file);
+        }
+    }
+    ::closedir(handle);
+    return files;
+}
+
+// The segment files that make up a node table, in row order, kept in
+// "<name>.manifest":
+//   {"format": "segment", "next_segment": 5, "epoch": 2,
+//    "segments": [{"id": 1, "file": "nodeB_table.seg", "rows": 81234},
+//                 {"id": 4, "file": "nodeB_table.000004.seg"}]}
+// The last segment is the one rows are appended to; the others are sealed and
+// never change, and record how many rows they hold. The manifest is rewritten
+// whole whenever a segment is added, merged or dropped. "epoch" counts the
+// rewrites that moved rows, so an index saved against the table can tell
+// whether it still matches. A table without a manifest adopts its single
+// pre-segment file (see tablePath) as segment 1.
+class TableManifest {
+public:
+    struct Entry {
+        uint32_t id;
+        std::string file;
+        uint64_t rows = 0;   // sealed segments only; 0 if not known
+    };
+
+private:
+    std::string name_;
+    TableFormat format_;
+    std::vector<Entry> segments_;
+    uint32_t next_id_ = 1;
+    uint64_t epoch_ = 0;
+
+public:
+    // Load the manifest of table `name`, or start one.
+    TableManifest(const std::string& name, TableFormat format) : name_(name), format_(format) {
+        std::ifstream file(path());
+        if (!file.is_open()) {
+            struct stat st;
+            uint32_t id = allocate();
+            std::string legacy = tablePath(name_, format_);
+            segments_.push_back({id, ::stat(legacy.c_str(), &st) == 0 ? legacy : segmentFile(id)});
+            store();
+            return;
+        }
+        json manifest;
+        try {
+            file >> manifest;
+            if (manifest.at("format").get<std::string>() != tableFormatName(format_)) {
+                throw std::runtime_error("table " + name_ + " is stored as " +
+                                         manifest.at("format").get<std::string>() + ", table_format is " +
+                                         tableFormatName(format_));
+            }
+            next_id_ = manifest.at("next_segment").get<uint32_t>();
+            epoch_ = manifest.value("epoch", static_cast<uint64_t>(0));
+            for (const auto& entry : manifest.at("segments")) {
+                segments_.push_back({entry.at("id").get<uint32_t>(), entry.at("file").get<std::string>(),
+                                     entry.value("rows", static_cast<uint64_t>(0))});
+            }
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Bad table manifest " + path() + ": " + e.what());
+        }
+        if (segments_.empty()) {
+            throw std::runtime_error("Table manifest " + path() + " lists no segments");
+        }
+    }
+
+    std::string path() const {
+        return name_ + ".manifest";
+    }
+
+    const std::vector<Entry>& segments() const {
+        return segments_;
+    }
+
+    // File for a new segment, e.g. nodeB_table.000004.seg.
+    std::string segmentFile(uint32_t id) const {
+        std::ostringstream file;
+        file << name_ << '.' << std::setw(6) << std::setfill('0') << id
+             << tablePath("", format_);
+        return file.str();
+    }
+
+    uint32_t allocate() {
+        return next_id_++;
+    }
+
+    uint32_t nextId() const {
+        return next_id_;
+    }
+
+    uint64_t epoch() const {
+        return epoch_;
+    }
+
+    // Index of segment `id` in table order, or -1.
+    int indexOf(uint32_t id) const {
+        for (size_t i = 0; i < segments_.size(); i++) {
+            if (segments_[i].id == id) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    void append(const Entry& entry) {
+        segments_.push_back(entry);
+    }
+
+    // Note the row count of segment `id` as it is sealed.
+    void setRows(uint32_t id, uint64_t rows) {
+        int index = indexOf(id);
+        if (index >= 0) {
+            segments_[index].rows = rows;
+        }
+    }
+
+    // Replace `count` consecutive segments starting at `first` by `entries`
+    // (possibly none). Starts a new epoch.
+    void replace(size_t first, size_t count, const std::vector<Entry>& entries) {
+        epoch_++;
+        segments_.erase(segments_.begin() + first, segments_.begin() + first + count);
+        segments_.insert(segments_.begin() + first, entries.begin(), entries.end());
+    }
+
+    // Drop every segment after the one at `index`; returns the dropped entries.
+    std::vector<Entry> dropAfter(size_t index) {
+        std::vector<Entry> dropped(segments_.begin() + index + 1, segments_.end());
+        segments_.resize(index + 1);
+        return dropped;
+    }
+
+    // Files in the table's directory that look like its segments (including
+    // the pre-segment file) but are not listed.
+    std::vector<std::string> unlistedFiles() const {
+        std::string extension = tablePath("", format_);
+        std::vector<std::string> files;
+        for (const auto& path : filesWithPrefix(name_)) {
+            // nodeB_table.seg or nodeB_table.000004.seg
+            if (path.size() < name_.size() + extension.size() ||
+                path.compare(path.size() - extension.size(), extension.size(), extension) != 0) {
+                continue;
+            }
+            std::string middle = path.substr(name_.size(), path.size() - name_.size() - extension.size());
+            if (!middle.empty() && (middle[0] != '.' || middle.size() < 2 ||
+                                    middle.find_first_not_of("0123456789", 1) != std::string::npos)) {
+                continue;
+            }
+            bool listed = false;
+            for (const auto& segment : segments_) {
+                listed = listed || segment.file == path;
+            }
+            if (!listed) {
+                files.push_back(path);
+            }
+        }
+        return files;
+    }
+
+    void store() const {
+        json manifest;
+        manifest["format"] = tableFormatName(format_);
+        manifest["next_segment"] = next_id_;
+        manifest["epoch"] = epoch_;
+        manifest["segments"] = json::array();
+        for (const auto& entry : segments_) {
+            json segment = {{"id", entry.id}, {"file", entry.file}};
+            if (entry.rows > 0) {
+                segment["rows"] = entry.rows;
+            }
+            manifest["segments"].push_back(segment);
+        }
+        replaceFile(path(), manifest.dump(2) + "\n");
+    }
+};
+
+#endif // TABLE_MANIFEST_HPP
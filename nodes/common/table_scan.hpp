@@ -0,0 +1,425 @@
+#ifndef TABLE_SCAN_HPP
+#define TABLE_SCAN_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <grpcpp/grpcpp.h>
+#include <nlohmann/json.hpp>
+#include "data.grpc.pb.h"
+#include "column_store.hpp"
+#include "row_segment.hpp"
+#include "table_writer.hpp"
+
+using json = nlohmann::json;
+
+// Default number of rows per RowBatch a Scan streams back.
+const int DEFAULT_SCAN_BATCH_ROWS = 1024;
+// A RowBatch is also sent once its column bytes reach this, well below gRPC's message limit.
+const size_t SCAN_BATCH_BYTES = 1 << 20;
+// Highest column a Scan may name; rows have 16.
+const uint32_t SCAN_MAX_COLUMN = UINT16_MAX;
+
+// One Predicate of a ScanRequest. A value and a range bound compare as
+// integers when both are integers written the way the columnar format stores
+// them (see parseCanonicalInt), and bytewise otherwise; equality and prefix
+// are always bytewise. A row without the column has an empty value there.
+class ScanCondition {
+public:
+    enum class Kind { Equals, Range, Prefix };
+
+private:
+    struct Bound {
+        bool set = false;
+        std::string text;
+        bool is_integer = false;
+        int64_t integer = 0;
+    };
+
+    uint32_t column_;
+    Kind kind_;
+    std::string value_;   // Equals and Prefix
+    Bound min_;           // Range, inclusive
+    Bound max_;
+
+    static Bound bound(bool set, const std::string& text) {
+        Bound b;
+        b.set = set;
+        if (set) {
+            b.text = text;
+            b.is_integer = parseCanonicalInt(text, &b.integer);
+        }
+        return b;
+    }
+
+    // Negative, zero or positive as `value` is below, at or above `bound`.
+    static int compare(std::string_view value, const Bound& bound) {
+        int64_t integer;
+        if (bound.is_integer && parseCanonicalInt(value, &integer)) {
+            return integer < bound.integer ? -1 : (integer > bound.integer ? 1 : 0);
+        }
+        return value.compare(bound.text);
+    }
+
+public:
+    explicit ScanCondition(const data::Predicate& predicate) : column_(predicate.column()) {
+        if (column_ > SCAN_MAX_COLUMN) {
+            throw std::invalid_argument("Predicate column " + std::to_string(column_) + " out of range");
+        }
+        switch (predicate.condition_case()) {
+            case data::Predicate::kEquals:
+                kind_ = Kind::Equals;
+                value_ = predicate.equals();
+                break;
+            case data::Predicate::kRange:
+                kind_ = Kind::Range;
+                min_ = bound(predicate.range().has_min(), predicate.range().min());
+                max_ = bound(predicate.range().has_max(), predicate.range().max());
+                break;
+            case data::Predicate::kPrefix:
+                kind_ = Kind::Prefix;
+                value_ = predicate.prefix();
+                break;
+            default:
+                throw std::invalid_argument("Predicate on column " + std::to_string(column_) + " has no condition");
+        }
+    }
+
+    uint32_t column() const {
+        return column_;
+    }
+
+    bool matches(std::string_view value) const {
+        switch (kind_) {
+            case Kind::Equals:
+                return value == value_;
+            case Kind::Prefix:
+                return value.substr(0, value_.size()) == value_;
+            default:
+                return (!min_.set || compare(value, min_) >= 0) && (!max_.set || compare(value, max_) <= 0);
+        }
+    }
+
+    // Whether a column chunk with these stats may hold a matching value;
+    // false lets a scan skip its row group without decoding it.
+    bool mayMatch(const ColumnMeta& meta) const {
+        if (meta.stats == COLUMN_STATS_INTEGER) {
+            // Every value is an integer.
+            int64_t integer;
+            switch (kind_) {
+                case Kind::Equals:
+                    return parseCanonicalInt(value_, &integer) && integer >= meta.min_integer &&
+                           integer <= meta.max_integer;
+                case Kind::Range:
+                    return !(min_.set && min_.is_integer && meta.max_integer < min_.integer) &&
+                           !(max_.set && max_.is_integer && meta.min_integer > max_.integer);
+                default:
+                    return true;
+            }
+        }
+        if (meta.stats == COLUMN_STATS_TEXT) {
+            // Bytewise bounds; an integer range bound may compare numerically, so only text ones prune.
+            switch (kind_) {
+                case Kind::Equals:
+                    return value_ >= meta.min_text && value_ <= meta.max_text;
+                case Kind::Range:
+                    return !(min_.set && !min_.is_integer && meta.max_text < min_.text) &&
+                           !(max_.set && !max_.is_integer && meta.min_text > max_.text);
+                default:
+                    // Values with the prefix sort from the prefix up to just past it.
+                    return meta.max_text >= value_ &&
+                           (meta.min_text <= value_ || meta.min_text.compare(0, value_.size(), value_) == 0);
+            }
+        }
+        return true;
+    }
+};
+
+// Scan handling for a node: evaluate a ScanRequest's predicates next to the
+// local table and stream the matching rows back, cut down to the requested
+// columns, in RowBatches of up to scan_batch_rows rows. Columnar tables skip
+// row groups whose column min/max rule out a match, decode the predicate
+// columns first and the projected ones only for groups with matches; row
+// tables test each row's columns in place. The scan covers every row written
+// when it starts and is not forwarded to other nodes. A row stored again under
+// the same row_index is returned once per stored version until compaction
+// drops the older ones.
+class TableScanner {
+private:
+    // State of one Scan call.
+    struct Call {
+        std::vector<ScanCondition> conditions;
+        std::vector<uint32_t> columns;    // projection; empty for every column
+        uint64_t limit = 0;               // 0 for no limit
+        size_t batch_rows = 0;
+        grpc::ServerContext* context = nullptr;
+        grpc::ServerWriterInterface<data::RowBatch>* writer = nullptr;
+        data::RowBatch batch;
+        size_t batch_bytes = 0;
+        uint64_t scanned = 0;
+        uint64_t matched = 0;
+        uint64_t groups = 0;
+        uint64_t skipped_groups = 0;
+        bool stopped = false;             // the client went away
+
+        bool done() const {
+            return stopped || (limit > 0 && matched >= limit);
+        }
+    };
+
+    TableWriter& table_;
+    std::string node_name_;
+    std::string node_id_;
+    size_t batch_rows_;
+
+    // Send the rows collected so far; stops the scan if the client has gone.
+    static void send(Call& call) {
+        if (call.batch.rows_size() == 0) {
+            return;
+        }
+        if (!call.writer->Write(call.batch)) {
+            call.stopped = true;
+        }
+        call.batch.clear_rows();
+        call.batch_bytes = 0;
+    }
+
+    // Add a matching row; column(c) gives its value in column c.
+    template <typename Column>
+    static void emit(Call& call, size_t column_count, Column column) {
+        data::Row* row = call.batch.add_rows();
+        auto add = [&](size_t c) {
+            std::string_view value = c < column_count ? column(c) : std::string_view();
+            row->add_columns(value.data(), value.size());
+            call.batch_bytes += value.size();
+        };
+        if (call.columns.empty()) {
+            for (size_t c = 0; c < column_count; c++) {
+                add(c);
+            }
+        } else {
+            for (uint32_t c : call.columns) {
+                add(c);
+            }
+        }
+        call.matched++;
+        if (static_cast<size_t>(call.batch.rows_size()) >= call.batch_rows || call.batch_bytes >= SCAN_BATCH_BYTES) {
+            send(call);
+        }
+    }
+
+    template <typename Column>
+    static bool matches(const Call& call, size_t column_count, Column column) {
+        for (const auto& condition : call.conditions) {
+            if (!condition.matches(condition.column() < column_count ? column(condition.column())
+                                                                      : std::string_view())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void checkCancelled(Call& call) {
+        if (call.context && call.context->IsCancelled()) {
+            call.stopped = true;
+        }
+    }
+
+    void scanColumnar(Call& call, const std::string& path, uint64_t end) const {
+        ColumnarReader reader(path, static_cast<size_t>(end));
+        std::vector<char> selected;
+        for (const auto& group : reader.groups()) {
+            checkCancelled(call);
+            if (call.done()) {
+                return;
+            }
+            size_t rows = group.rows();
+            size_t column_count = group.columnCount();
+            call.groups++;
+            call.scanned += rows;
+            bool possible = true;
+            for (const auto& condition : call.conditions) {
+                possible = possible && (condition.column() < column_count ? condition.mayMatch(group.meta(condition.column()))
+                                                                          : condition.matches(std::string_view()));
+            }
+            if (!possible) {
+                call.skipped_groups++;
+                continue;
+            }
+            // Predicate columns first, one chunk at a time, narrowing the selection.
+            selected.assign(rows, 1);
+            size_t remaining = rows;
+            for (const auto& condition : call.conditions) {
+                if (condition.column() >= column_count || remaining == 0) {
+                    continue;
+                }
+                ChunkView chunk;
+                if (!group.chunk(condition.column(), &chunk)) {
+                    throw std::runtime_error("Damaged column chunk in " + path);
+                }
+                chunk.forEach([&](size_t i, std::string_view value) {
+                    if (selected[i] && !condition.matches(value)) {
+                        selected[i] = 0;
+                        remaining--;
+                    }
+                });
+            }
+            if (remaining == 0) {
+                continue;
+            }
+            if (call.limit > 0 && remaining > call.limit - call.matched) {
+                remaining = static_cast<size_t>(call.limit - call.matched);
+                size_t kept = 0;
+                for (auto& s : selected) {
+                    if (s) {
+                        s = kept++ < remaining;
+                    }
+                }
+            }
+            // Then only the projected columns, and only their selected values.
+            std::vector<std::vector<std::string>> values(column_count);
+            std::vector<bool> decoded(column_count);
+            auto decode = [&](size_t c) {
+                if (c >= column_count || decoded[c]) {
+                    return;
+                }
+                ChunkView chunk;
+                if (!group.chunk(c, &chunk)) {
+                    throw std::runtime_error("Damaged column chunk in " + path);
+                }
+                values[c].reserve(remaining);
+                chunk.forEach([&](size_t i, std::string_view value) {
+                    if (selected[i]) {
+                        values[c].emplace_back(value);
+                    }
+                });
+                decoded[c] = true;
+            };
+            if (call.columns.empty()) {
+                for (size_t c = 0; c < column_count; c++) {
+                    decode(c);
+                }
+            } else {
+                for (uint32_t c : call.columns) {
+                    decode(c);
+                }
+            }
+            for (size_t r = 0; r < remaining && !call.done(); r++) {
+                emit(call, column_count, [&](size_t c) { return std::string_view(values[c][r]); });
+            }
+        }
+    }
+
+    void scanRowSegment(Call& call, const std::string& path, uint64_t end) const {
+        SegmentReader reader(path);
+        size_t offset = reader.begin();
+        RowView row;
+        while (offset < end && !call.done() && reader.read(&offset, &row) == SegmentReader::Result::Row) {
+            call.scanned++;
+            auto column = [&](size_t c) { return row.column(c); };
+            if (matches(call, row.columnCount(), column)) {
+                emit(call, row.columnCount(), column);
+            }
+            if ((call.scanned & 4095) == 0) {
+                checkCancelled(call);
+            }
+        }
+    }
+
+    void scanCsv(Call& call, const std::string& path, uint64_t end) const {
+        std::ifstream file(path, std::ios::binary);
+        std::string line;
+        std::vector<std::string_view> fields;
+        uint64_t offset = 0;
+        while (offset < end && !call.done() && std::getline(file, line)) {
+            offset += line.size() + 1;
+            call.scanned++;
+            fields.clear();
+            std::string_view text(line);
+            size_t start = 0;
+            size_t comma;
+            while ((comma = text.find(',', start)) != std::string_view::npos) {
+                fields.push_back(text.substr(start, comma - start));
+                start = comma + 1;
+            }
+            fields.push_back(text.substr(start));
+            auto column = [&](size_t c) { return fields[c]; };
+            if (matches(call, fields.size(), column)) {
+                emit(call, fields.size(), column);
+            }
+            if ((call.scanned & 4095) == 0) {
+                checkCancelled(call);
+            }
+        }
+    }
+
+public:
+    TableScanner(TableWriter& table, const std::string& node_name, const std::string& node_id, int batch_rows)
+        : table_(table),
+          node_name_(node_name),
+          node_id_(node_id),
+          batch_rows_(batch_rows < 1 ? 1 : static_cast<size_t>(batch_rows)) {}
+
+    TableScanner(TableWriter& table, const std::string& node_name, const std::string& node_id, const json& config)
+        : TableScanner(table, node_name, node_id, config.value("scan_batch_rows", DEFAULT_SCAN_BATCH_ROWS)) {}
+
+    grpc::Status scan(grpc::ServerContext* context, const data::ScanRequest& request,
+                      grpc::ServerWriterInterface<data::RowBatch>* writer) const {
+        auto start = std::chrono::steady_clock::now();
+        Call call;
+        try {
+            for (const auto& predicate : request.predicates()) {
+                call.conditions.emplace_back(predicate);
+            }
+        } catch (const std::invalid_argument& e) {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, e.what());
+        }
+        for (uint32_t column : request.columns()) {
+            if (column > SCAN_MAX_COLUMN) {
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                    "Column " + std::to_string(column) + " out of range");
+            }
+            call.columns.push_back(column);
+        }
+        call.limit = request.limit();
+        call.batch_rows = request.batch_rows() > 0 ? request.batch_rows() : batch_rows_;
+        call.context = context;
+        call.writer = writer;
+        call.batch.set_node(node_id_);
+
+        TableFormat format = table_.format();
+        table_.forEachSegment([&](const std::string& path, uint64_t end) {
+            if (call.done()) {
+                return;
+            }
+            if (format == TableFormat::Columnar) {
+                scanColumnar(call, path, end);
+            } else if (format == TableFormat::Segment) {
+                scanRowSegment(call, path, end);
+            } else {
+                scanCsv(call, path, end);
+            }
+        });
+        if (!call.stopped) {
+            send(call);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << node_name_ << ": Scan matched " << call.matched << " of " << call.scanned << " rows";
+        if (call.groups > 0) {
+            std::cout << " (" << call.skipped_groups << " of " << call.groups << " row groups skipped by min/max)";
+        }
+        std::cout << " in " << elapsed.count() << " ms" << std::endl;
+        if (context && context->IsCancelled()) {
+            return grpc::Status(grpc::StatusCode::CANCELLED, "Scan cancelled");
+        }
+        return grpc::Status::OK;
+    }
+};
+
+#endif // TABLE_SCAN_HPP
@@ -0,0 +1,1219 @@
+#ifndef TABLE_WRITER_HPP
+#define TABLE_WRITER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <sys/stat.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "column_store.hpp"
+#include "csv_row.hpp"
+#include "row_segment.hpp"
+#include "storage_ring.hpp"
+#include "table_manifest.hpp"
+
+using json = nlohmann::json;
+
+// Default size of the userspace buffer in front of the table file.
+const int DEFAULT_TABLE_BUFFER_BYTES = 1 << 20;
+// Default interval at which buffered rows are written out (and synced for "periodic").
+const int DEFAULT_TABLE_FLUSH_INTERVAL_MS = 200;
+// Default age at which a partly filled columnar row group is written out anyway.
+const int DEFAULT_ROW_GROUP_MAX_AGE_MS = 1000;
+// Default interval between looks for segments worth compacting; 0 turns compaction off.
+const int DEFAULT_COMPACTION_INTERVAL_MS = 30000;
+// Default cap on the bytes compaction reads plus writes per second; 0 for no cap.
+const int DEFAULT_COMPACTION_BYTES_PER_SEC = 16 << 20;
+
+// Where a row sits in the table: its segment, its first byte and its encoded
+// length. Columnar segments have no per-row bytes; there offset is the row's
+// ordinal in the segment and length is 0.
+struct RowLocation {
+    uint32_t segment = 0;
+    uint64_t offset = 0;
+    uint32_t length = 0;
+
+    bool operator==(const RowLocation& other) const {
+        return segment == other.segment && offset == other.offset && length == other.length;
+    }
+};
+
+// How far a row must get before append() returns.
+enum class Durability {
+    None,       // buffered; written out when the buffer fills or every flush interval, never synced
+    Periodic,   // as None, plus fdatasync on every flush interval
+    Batch       // written and fdatasync'ed before append() returns, shared by concurrent rows
+};
+
+inline Durability parseDurability(const std::string& policy, const std::string& key = "table_durability") {
+    if (policy == "none") {
+        return Durability::None;
+    }
+    if (policy == "periodic") {
+        return Durability::Periodic;
+    }
+    if (policy == "batch") {
+        return Durability::Batch;
+    }
+    throw std::runtime_error("Unknown " + key + ": " + policy);
+}
+
+// Append-only table (CSV, row segment or columnar) kept open for the life of the node.
+// Rows are formatted into a userspace buffer and handed to the kernel in
+// groups. Under "batch" durability the first thread to find no commit in
+// progress becomes the leader: it writes and syncs every row queued so far
+// while later arrivals queue up behind it for the next group, so one
+// fdatasync covers all concurrently arriving rows.
+//
+// The table is a list of segment files kept in a manifest (table_manifest.hpp).
+// Rows go to the last one; once it reaches segment_bytes it is synced and
+// sealed and a new one is started. A background compactor merges runs of
+// small sealed segments into one and drops rows whose row_index was stored
+// again later, at no more than compaction_bytes_per_sec, so startup and scans
+// cost follows the live rows rather than everything the node ever stored.
+//
+// A columnar table collects rows in memory until a row group of
+// row_group_rows is full, or its first row is row_group_max_age_ms old, then
+// encodes it into the buffer as one unit. A crash loses the open group unless
+// the write-ahead log (wal.hpp) covers it, so "batch" durability is not
+// available for this format.
+class TableWriter {
+private:
+    // Columnar format only.
+    struct SealedGroup {
+        uint64_t first_row;       // ordinal of the group's first row in its segment
+        RowLocation bytes;        // where the encoded group is
+    };
+
+    // One segment file. Readers hold a reference while they use it, so a
+    // segment dropped by compaction stays readable until they are done: its
+    // file is only removed with the last reference.
+    struct Segment {
+        uint32_t id = 0;
+        std::string path;
+        int fd = -1;
+        uint64_t size = 0;                   // bytes, once sealed
+        uint64_t rows = 0;                   // rows, from the manifest once sealed; 0 if not known
+        uint64_t dead_rows = 0;              // rows whose row_index was stored again later
+        std::vector<SealedGroup> groups;     // columnar only: encoded groups in file order
+        bool dropped = false;                // no longer in the manifest; remove the file when done
+
+        ~Segment() {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            if (dropped) {
+                ::unlink(path.c_str());
+            }
+        }
+    };
+
+    std::string name_;
+    std::string node_name_;
+    TableFormat format_;
+    Durability durability_;
+    size_t buffer_bytes_;
+    std::chrono::milliseconds flush_interval_;
+    size_t row_group_rows_;
+    std::chrono::milliseconds row_group_max_age_;
+    uint64_t segment_bytes_;
+    std::chrono::milliseconds compaction_interval_;
+    uint64_t compaction_rate_;
+    Appender appender_;                   // how groups reach the active segment
+
+    std::mutex mutex_;
+    std::condition_variable cv_;          // a group commit or rollover finished
+    std::condition_variable flush_cv_;    // wakes the flusher and compactor early on shutdown
+    TableManifest manifest_;
+    std::shared_ptr<Segment> active_;     // the segment rows are appended to
+    std::map<uint32_t, std::shared_ptr<Segment>> sealed_segments_;
+    uint64_t epoch_ = 0;        // manifest epoch whose row moves have all reached the index
+    std::string buffer_;        // rows not yet handed to the kernel
+    std::string spare_;         // second buffer, reused to avoid reallocating per group
+    uint64_t written_ = 0;      // offset in active_ up to which rows have been handed to the kernel
+    uint64_t end_ = 0;          // offset in active_ just past the last appended row
+    // The rows in buffer_, written out together by one commit(); appends under
+    // "batch" wait on the one their row went into.
+    struct Batch {
+        bool done = false;
+        bool ok = false;
+    };
+    std::shared_ptr<Batch> batch_ = std::make_shared<Batch>();
+    bool failed_ = false;       // a failed write could not be cut off active_
+    bool committing_ = false;   // a group is being written with mutex_ released
+    bool rolling_ = false;      // active_ is being sealed; appends wait
+    bool unsynced_ = false;     // data written since the last fdatasync
+    bool stopping_ = false;
+    std::thread flusher_;
+
+    // Columnar format only, for active_.
+    RowGroupBuilder group_;               // rows of the group being filled
+    std::chrono::steady_clock::time_point group_started_;   // first append to group_
+    uint64_t sealed_rows_ = 0;            // rows in active_->groups
+
+    // Compaction.
+    std::thread compactor_;
+    std::atomic<bool> stop_compaction_{false};
+    bool compaction_allowed_ = false;     // set by compactBefore()
+    uint32_t compact_before_ = 0;         // only segments listed before this one may be rewritten
+    std::mutex hooks_mutex_;              // held while a compaction uses the hooks
+    std::function<bool(std::string_view, const RowLocation&)> keep_row_;
+    std::function<bool(std::string_view, const RowLocation&, const RowLocation&)> move_row_;
+
+    static bool writeAll(int fd, const char* data, size_t size) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::write(fd, data + done, size - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static uint64_t fileSize(int fd, const std::string& path) {
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            throw std::runtime_error("Failed to stat local table " + path);
+        }
+        return static_cast<uint64_t>(st.st_size);
+    }
+
+    // Header every new segment file of this format starts with.
+    std::string fileHeader() const {
+        switch (format_) {
+            case TableFormat::Segment: return segmentHeader();
+            case TableFormat::Columnar: return columnarHeader();
+            default: return std::string();
+        }
+    }
+
+    // Write out every buffered row, syncing if asked. Called with `lock` held;
+    // releases it during the I/O so new rows keep arriving into the other buffer.
+    // Returns false if the write or sync failed. The rows then stay buffered
+    // in front of the newer ones, whose locations already count them, and
+    // go out with the next commit; "batch" appends waiting on them fail.
+    bool commit(std::unique_lock<std::mutex>& lock, bool sync) {
+        committing_ = true;
+        std::string group;
+        group.swap(buffer_);
+        buffer_.swap(spare_);
+        std::shared_ptr<Batch> batch = std::move(batch_);
+        batch_ = std::make_shared<Batch>();
+        uint64_t group_bytes = group.size();
+        bool wrote = !group.empty();
+        std::shared_ptr<Segment> segment = active_;
+        lock.unlock();
+
+        bool ok = appender_.append(segment->fd, group, sync);
+        if (!ok) {
+            std::cerr << node_name_ << ": Error writing local table " << segment->path << ": "
+                      << std::strerror(errno) << std::endl;
+        }
+
+        lock.lock();
+        if (ok) {
+            written_ += group_bytes;
+            group.clear();
+        } else {
+            // Cut off whatever part reached the file, so the retry lands at written_.
+            if (::ftruncate(segment->fd, static_cast<off_t>(written_)) != 0) {
+                std::cerr << node_name_ << ": Could not cut back local table " << segment->path << ": "
+                          << std::strerror(errno) << "; no longer accepting rows" << std::endl;
+                failed_ = true;
+            }
+            group.append(buffer_);
+            buffer_.swap(group);
+            group.clear();
+        }
+        spare_.swap(group);
+        batch->done = true;
+        batch->ok = ok;
+        if (ok && sync) {
+            unsynced_ = false;
+        } else if (wrote) {
+            unsynced_ = true;
+        }
+        committing_ = false;
+        cv_.notify_all();
+        return ok;
+    }
+
+    // Write the header of a new row segment, or check the one already there
+    // and cut off a damaged tail so new rows are not appended behind it.
+    void openRowSegment(Segment* segment) {
+        uint64_t size = fileSize(segment->fd, segment->path);
+        if (size == 0) {
+            std::string header = segmentHeader();
+            if (!writeAll(segment->fd, header.data(), header.size())) {
+                throw std::runtime_error("Failed to write segment header to " + segment->path);
+            }
+            return;
+        }
+        uint8_t header[SEGMENT_HEADER_SIZE];
+        if (::pread(segment->fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            !isSegmentHeader(header, sizeof(header))) {
+            throw std::runtime_error("Local table " + segment->path + " is not a row segment");
+        }
+        SegmentReader reader(segment->path);
+        size_t offset = reader.begin();
+        RowView row;
+        while (reader.read(&offset, &row) == SegmentReader::Result::Row) {
+            segment->rows++;
+        }
+        if (offset < size) {
+            std::cerr << node_name_ << ": Dropping " << (size - offset) << " damaged bytes at the end of "
+                      << segment->path << std::endl;
+            if (::ftruncate(segment->fd, static_cast<off_t>(offset)) != 0) {
+                throw std::runtime_error("Failed to truncate local table " + segment->path);
+            }
+        }
+    }
+
+    // Check the header of a columnar segment and note where each row group is.
+    // A writable (active) segment is created if empty and has a damaged tail cut off.
+    void openColumnar(Segment* segment, bool writable) {
+        uint64_t size = fileSize(segment->fd, segment->path);
+        if (size == 0 && writable) {
+            std::string header = columnarHeader();
+            if (!writeAll(segment->fd, header.data(), header.size())) {
+                throw std::runtime_error("Failed to write columnar header to " + segment->path);
+            }
+            return;
+        }
+        uint8_t header[COLUMNAR_HEADER_SIZE];
+        if (::pread(segment->fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            !isColumnarHeader(header, sizeof(header))) {
+            throw std::runtime_error("Local table " + segment->path + " is not a columnar table");
+        }
+        ColumnarReader reader(segment->path);
+        for (size_t i = 0; i < reader.groups().size(); i++) {
+            size_t end = i + 1 < reader.groups().size() ? reader.offset(i + 1) : reader.validEnd();
+            segment->groups.push_back(
+                {segment->rows,
+                 RowLocation{segment->id, reader.offset(i), static_cast<uint32_t>(end - reader.offset(i))}});
+            segment->rows += reader.groups()[i].rows();
+        }
+        if (writable && reader.validEnd() < size) {
+            std::cerr << node_name_ << ": Dropping " << (size - reader.validEnd()) << " damaged bytes at the end of "
+                      << segment->path << std::endl;
+            if (::ftruncate(segment->fd, static_cast<off_t>(reader.validEnd())) != 0) {
+                throw std::runtime_error("Failed to truncate local table " + segment->path);
+            }
+        }
+    }
+
+    // Count the lines of the CSV segment being appended to.
+    void openCsv(Segment* segment) {
+        char chunk[1 << 16];
+        off_t offset = 0;
+        ssize_t n;
+        while ((n = ::pread(segment->fd, chunk, sizeof(chunk), offset)) > 0) {
+            segment->rows += static_cast<uint64_t>(std::count(chunk, chunk + n, '\n'));
+            offset += n;
+        }
+    }
+
+    std::shared_ptr<Segment> openSegment(const TableManifest::Entry& entry, bool writable) {
+        auto segment = std::make_shared<Segment>();
+        segment->id = entry.id;
+        segment->path = entry.file;
+        segment->rows = writable ? 0 : entry.rows;
+        segment->fd = writable ? ::open(entry.file.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644)
+                               : ::open(entry.file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (segment->fd < 0) {
+            throw std::runtime_error("Failed to open local table " + entry.file + ": " + std::strerror(errno));
+        }
+        if (format_ == TableFormat::Columnar) {
+            segment->rows = 0;
+            openColumnar(segment.get(), writable);
+        } else if (format_ == TableFormat::Segment && writable) {
+            openRowSegment(segment.get());
+        } else if (writable) {
+            openCsv(segment.get());
+        }
+        segment->size = fileSize(segment->fd, segment->path);
+        return segment;
+    }
+
+    // Segment `id`, sealed or active; null once compaction has dropped it. Called with mutex_ held.
+    std::shared_ptr<Segment> findSegment(uint32_t id) const {
+        if (active_->id == id) {
+            return active_;
+        }
+        auto it = sealed_segments_.find(id);
+        return it == sealed_segments_.end() ? nullptr : it->second;
+    }
+
+    // Encode the open row group into buffer_. Called with mutex_ held.
+    void sealGroup() {
+        size_t rows = group_.rows();
+        size_t before = buffer_.size();
+        group_.encode(&buffer_);
+        uint32_t length = static_cast<uint32_t>(buffer_.size() - before);
+        active_->groups.push_back({sealed_rows_, RowLocation{active_->id, end_, length}});
+        sealed_rows_ += rows;
+        end_ += length;
+    }
+
+    // Once the active segment has reached segment_bytes_, sync and seal it and
+    // start a new one. Called with `lock` held and no open row group; appends
+    // wait until the new segment is in place.
+    void rollOver(std::unique_lock<std::mutex>& lock) {
+        if (rolling_ || end_ < segment_bytes_) {
+            return;
+        }
+        rolling_ = true;
+        cv_.wait(lock, [this] { return !committing_; });
+        // A sealed segment never changes again, so it is made durable before it
+        // leaves the tail. If that fails, rolling over waits for a later try.
+        if ((!buffer_.empty() || unsynced_) && !commit(lock, true)) {
+            std::cerr << node_name_ << ": Not sealing table segment " << active_->path
+                      << " until its rows are written" << std::endl;
+            rolling_ = false;
+            cv_.notify_all();
+            return;
+        }
+        uint32_t id = manifest_.allocate();
+        std::string path = manifest_.segmentFile(id);
+        std::string header = fileHeader();
+        int fd = ::open(path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool ok = fd >= 0 && writeAll(fd, header.data(), header.size());
+        if (ok) {
+            manifest_.setRows(active_->id, active_->rows);
+            manifest_.append({id, path});
+            try {
+                manifest_.store();
+            } catch (const std::exception& e) {
+                std::cerr << node_name_ << ": " << e.what() << std::endl;
+                manifest_.dropAfter(manifest_.segments().size() - 2);
+                ok = false;
+            }
+        }
+        if (!ok) {
+            // Keep appending to the current segment rather than fail rows.
+            std::cerr << node_name_ << ": Failed to start table segment " << path << "; staying on "
+                      << active_->path << std::endl;
+            if (fd >= 0) {
+                ::close(fd);
+                ::unlink(path.c_str());
+            }
+            segment_bytes_ = UINT64_MAX;
+        } else {
+            active_->size = end_;
+            sealed_segments_[active_->id] = active_;
+            std::cout << node_name_ << ": Sealed table segment " << active_->path << " (" << end_ << " bytes, "
+                      << active_->rows << " rows); now writing " << path << std::endl;
+            auto segment = std::make_shared<Segment>();
+            segment->id = id;
+            segment->path = path;
+            segment->fd = fd;
+            active_ = segment;
+            written_ = end_ = header.size();
+            sealed_rows_ = 0;
+            unsynced_ = false;
+        }
+        rolling_ = false;
+        cv_.notify_all();
+    }
+
+    // Row `ordinal` of columnar segment `segment_id`, from the open group or a sealed one.
+    bool readColumnar(uint32_t segment_id, uint64_t ordinal, std::vector<std::string>* columns) {
+        RowLocation group_bytes;
+        uint64_t first_row;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::shared_ptr<Segment> segment = findSegment(segment_id);
+            if (!segment) {
+                return false;
+            }
+            if (segment == active_ && ordinal >= sealed_rows_) {
+                if (ordinal - sealed_rows_ >= group_.rows()) {
+                    return false;
+                }
+                group_.row(static_cast<size_t>(ordinal - sealed_rows_), columns);
+                return true;
+            }
+            if (segment->groups.empty() || ordinal >= segment->rows) {
+                return false;
+            }
+            auto it = std::upper_bound(segment->groups.begin(), segment->groups.end(), ordinal,
+                                       [](uint64_t row, const SealedGroup& group) { return row < group.first_row; });
+            --it;
+            group_bytes = it->bytes;
+            first_row = it->first_row;
+        }
+        std::string bytes;
+        if (!readBytes(group_bytes, &bytes)) {
+            return false;
+        }
+        RowGroupView group;
+        size_t group_size;
+        return RowGroupView::parse(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), &group,
+                                   &group_size) &&
+               group.row(static_cast<size_t>(ordinal - first_row), columns);
+    }
+
+    // Bytes at `location`, from its segment file or from the rows not yet written out.
+    bool readBytes(const RowLocation& location, std::string* bytes) {
+        std::shared_ptr<Segment> segment;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // Rows past written_ are in buffer_, or in a group being written while committing_.
+            cv_.wait(lock, [&] {
+                return location.segment != active_->id || location.offset < written_ || !committing_;
+            });
+            segment = findSegment(location.segment);
+            if (!segment) {
+                return false;
+            }
+            if (segment == active_) {
+                if (location.offset + location.length > end_) {
+                    return false;
+                }
+                if (location.offset >= written_) {
+                    bytes->assign(buffer_, location.offset - written_, location.length);
+                    return true;
+                }
+            }
+        }
+        bytes->resize(location.length);
+        size_t done = 0;
+        while (done < location.length) {
+            ssize_t n = ::pread(segment->fd, &(*bytes)[done], location.length - done,
+                                static_cast<off_t>(location.offset + done));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void flushLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            flush_cv_.wait_for(lock, flush_interval_, [this] { return stopping_; });
+            if (stopping_ || committing_ || rolling_) {
+                continue;
+            }
+            if (!group_.empty() && std::chrono::steady_clock::now() - group_started_ >= row_group_max_age_) {
+                sealGroup();
+            }
+            if (group_.empty() && end_ >= segment_bytes_) {
+                rollOver(lock);
+                continue;
+            }
+            bool sync = durability_ == Durability::Periodic;
+            if (!buffer_.empty() || (sync && unsynced_)) {
+                commit(lock, sync);
+            }
+        }
+    }
+
+    // Call fn(const RowLocation&, const std::vector<std::string>& columns) for
+    // every row of a sealed segment; returns the segment's size in bytes.
+    template <typename Fn>
+    uint64_t scanSegment(const Segment& segment, Fn fn) {
+        std::vector<std::string> columns;
+        if (format_ == TableFormat::Columnar) {
+            ColumnarReader reader(segment.path);
+            uint64_t first_row = 0;
+            for (const auto& group : reader.groups()) {
+                // Decode each chunk once rather than once per row.
+                std::vector<std::vector<std::string>> values(group.columnCount());
+                for (size_t c = 0; c < group.columnCount(); c++) {
+                    ChunkView chunk;
+                    if (!group.chunk(c, &chunk)) {
+                        throw std::runtime_error("Damaged column chunk in " + segment.path);
+                    }
+                    values[c].reserve(group.rows());
+                    chunk.forEach([&](size_t, std::string_view value) { values[c].emplace_back(value); });
+                }
+                for (size_t i = 0; i < group.rows(); i++) {
+                    columns.clear();
+                    for (auto& column : values) {
+                        columns.push_back(std::move(column[i]));
+                    }
+                    fn(RowLocation{segment.id, first_row + i, 0}, columns);
+                }
+                first_row += group.rows();
+            }
+            return reader.size();
+        }
+        if (format_ == TableFormat::Segment) {
+            SegmentReader reader(segment.path);
+            size_t offset = reader.begin();
+            size_t start = offset;
+            RowView row;
+            while (reader.read(&offset, &row) == SegmentReader::Result::Row) {
+                columns.clear();
+                for (size_t i = 0; i < row.columnCount(); i++) {
+                    columns.emplace_back(row.column(i));
+                }
+                fn(RowLocation{segment.id, start, static_cast<uint32_t>(offset - start)}, columns);
+                start = offset;
+            }
+            return reader.size();
+        }
+        std::ifstream file(segment.path, std::ios::binary);
+        std::string line;
+        uint64_t offset = 0;
+        while (std::getline(file, line)) {
+            uint32_t length = static_cast<uint32_t>(line.size() + 1);
+            columns.clear();
+            size_t start = 0;
+            size_t comma;
+            while ((comma = line.find(',', start)) != std::string::npos) {
+                columns.push_back(line.substr(start, comma - start));
+                start = comma + 1;
+            }
+            columns.push_back(line.substr(start));
+            fn(RowLocation{segment.id, offset, length}, columns);
+            offset += length;
+        }
+        return offset;
+    }
+
+    // Next run of sealed segments worth rewriting: adjacent segments whose live
+    // rows fit in one, starting at one that is small or at least half dead; or
+    // such a half-dead segment on its own. Called with mutex_ held.
+    std::vector<std::shared_ptr<Segment>> pickCompaction() const {
+        std::vector<std::shared_ptr<Segment>> candidates;
+        for (const auto& entry : manifest_.segments()) {
+            if (entry.id == compact_before_ || entry.id == active_->id) {
+                break;
+            }
+            candidates.push_back(sealed_segments_.at(entry.id));
+        }
+        auto liveBytes = [](const Segment& segment) {
+            if (segment.rows == 0) {
+                return segment.size;
+            }
+            return segment.size * (segment.rows - std::min(segment.dead_rows, segment.rows)) / segment.rows;
+        };
+        auto mostlyDead = [](const Segment& segment) {
+            return segment.rows > 0 && segment.dead_rows > 0 && segment.dead_rows * 2 >= segment.rows;
+        };
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (liveBytes(*candidates[i]) >= segment_bytes_ / 2 && !mostlyDead(*candidates[i])) {
+                continue;
+            }
+            uint64_t total = liveBytes(*candidates[i]);
+            size_t j = i + 1;
+            while (j < candidates.size() && total + liveBytes(*candidates[j]) <= segment_bytes_) {
+                total += liveBytes(*candidates[j]);
+                j++;
+            }
+            if (j - i >= 2 || mostlyDead(*candidates[i])) {
+                return std::vector<std::shared_ptr<Segment>>(candidates.begin() + i, candidates.begin() + j);
+            }
+        }
+        return {};
+    }
+
+    // Rewrite `run` as one new segment without its dead rows, put it in the
+    // run's place in the manifest and point the index at it.
+    void compact(const std::vector<std::shared_ptr<Segment>>& run) {
+        std::lock_guard<std::mutex> hooks(hooks_mutex_);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t budget = 0;
+        // Stay under compaction_rate_ bytes per second, in slices so stopping is not held up.
+        auto throttle = [&](uint64_t bytes) {
+            budget += bytes;
+            if (compaction_rate_ == 0) {
+                return;
+            }
+            auto until = start + std::chrono::microseconds(budget * 1000000 / compaction_rate_);
+            while (!stop_compaction_ && std::chrono::steady_clock::now() < until) {
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                    until - std::chrono::steady_clock::now(), std::chrono::milliseconds(100)));
+            }
+        };
+
+        auto output = std::make_shared<Segment>();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            output->id = manifest_.allocate();
+        }
+        output->path = manifest_.segmentFile(output->id);
+        output->fd = ::open(output->path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (output->fd < 0) {
+            throw std::runtime_error("Failed to create table segment " + output->path + ": " + std::strerror(errno));
+        }
+        struct Move {
+            std::string first_column;
+            RowLocation from;
+            RowLocation to;
+        };
+        std::vector<Move> moves;
+        std::string out = fileHeader();
+        uint64_t offset = 0;        // file offset of out[0]
+        RowGroupBuilder group;
+        uint64_t rows_in = 0;
+
+        // Encode a full (or, at the end, any) row group and write out what has piled up.
+        auto flush = [&](bool last) {
+            if (format_ == TableFormat::Columnar && (last ? !group.empty() : group.rows() >= row_group_rows_)) {
+                uint64_t first_row = output->rows - group.rows();
+                size_t before = out.size();
+                group.encode(&out);
+                output->groups.push_back(
+                    {first_row, RowLocation{output->id, offset + before, static_cast<uint32_t>(out.size() - before)}});
+            }
+            if (last || out.size() >= buffer_bytes_) {
+                if (!writeAll(output->fd, out.data(), out.size())) {
+                    throw std::runtime_error("Failed to write table segment " + output->path + ": " +
+                                             std::strerror(errno));
+                }
+                offset += out.size();
+                throttle(out.size());
+                out.clear();
+            }
+        };
+
+        try {
+            for (const auto& segment : run) {
+                throttle(scanSegment(*segment, [&](const RowLocation& from, const std::vector<std::string>& row) {
+                    rows_in++;
+                    if (stop_compaction_) {
+                        return;
+                    }
+                    std::string_view first_column = row.empty() ? std::string_view() : std::string_view(row[0]);
+                    if (keep_row_ && !keep_row_(first_column, from)) {
+                        return;
+                    }
+                    RowLocation to{output->id, output->rows, 0};
+                    if (format_ == TableFormat::Columnar) {
+                        group.add(row);
+                    } else {
+                        size_t before = out.size();
+                        if (format_ == TableFormat::Segment) {
+                            encodeRow(row, &out);
+                        } else {
+                            appendCsvLine(row, &out);
+                        }
+                        to.offset = offset + before;
+                        to.length = static_cast<uint32_t>(out.size() - before);
+                    }
+                    output->rows++;
+                    moves.push_back({std::string(first_column), from, to});
+                    flush(false);
+                }));
+                if (stop_compaction_) {
+                    ::unlink(output->path.c_str());
+                    return;
+                }
+            }
+            flush(true);
+            if (::fdatasync(output->fd) != 0) {
+                throw std::runtime_error("Failed to sync table segment " + output->path);
+            }
+            output->size = offset;
+            // The rows that made the dropped ones dead must be on disk before those go.
+            sync();
+            std::lock_guard<std::mutex> lock(mutex_);
+            TableManifest manifest = manifest_;
+            int first = manifest.indexOf(run.front()->id);
+            std::vector<TableManifest::Entry> replacement;
+            if (output->rows > 0) {
+                replacement.push_back({output->id, output->path, output->rows});
+            }
+            manifest.replace(static_cast<size_t>(first), run.size(), replacement);
+            manifest.store();
+            manifest_ = manifest;
+            if (output->rows > 0) {
+                sealed_segments_[output->id] = output;
+            }
+        } catch (...) {
+            ::unlink(output->path.c_str());
+            throw;
+        }
+        if (output->rows == 0) {
+            ::unlink(output->path.c_str());
+        }
+
+        // Rows stored again while they were being copied are dead in the new segment too.
+        uint64_t stale = 0;
+        for (const auto& move : moves) {
+            if (move_row_ && !move_row_(move.first_column, move.from, move.to)) {
+                stale++;
+            }
+        }
+        uint64_t bytes_in = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // The index now points at the new segment only.
+            epoch_ = manifest_.epoch();
+            output->dead_rows += stale;
+            for (const auto& segment : run) {
+                sealed_segments_.erase(segment->id);
+                segment->dropped = true;
+                bytes_in += segment->size;
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << node_name_ << ": Compacted " << run.size() << " table segments (" << rows_in << " rows, "
+                  << bytes_in << " bytes) into ";
+        if (output->rows > 0) {
+            std::cout << output->path << " (" << output->rows << " rows, " << output->size << " bytes)";
+        } else {
+            std::cout << "nothing, every row was dead";
+        }
+        std::cout << " in " << elapsed.count() << " ms" << std::endl;
+    }
+
+    void compactLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_compaction_) {
+            flush_cv_.wait_for(lock, compaction_interval_, [this] { return stop_compaction_.load(); });
+            if (stop_compaction_ || !compaction_allowed_) {
+                continue;
+            }
+            std::vector<std::shared_ptr<Segment>> run = pickCompaction();
+            if (run.empty()) {
+                continue;
+            }
+            lock.unlock();
+            try {
+                compact(run);
+            } catch (const std::exception& e) {
+                std::cerr << node_name_ << ": Compaction failed: " << e.what() << std::endl;
+            }
+            lock.lock();
+        }
+    }
+
+public:
+    // Open (or create) table `name`: the manifest "<name>.manifest" and the
+    // segment files it lists, whose extension follows the format.
+    TableWriter(const std::string& name, const std::string& node_name, TableFormat format,
+                Durability durability, int buffer_bytes, int flush_interval_ms,
+                int row_group_rows = DEFAULT_ROW_GROUP_ROWS,
+                int row_group_max_age_ms = DEFAULT_ROW_GROUP_MAX_AGE_MS,
+                int segment_bytes = DEFAULT_SEGMENT_BYTES,
+                int compaction_interval_ms = DEFAULT_COMPACTION_INTERVAL_MS,
+                int compaction_bytes_per_sec = DEFAULT_COMPACTION_BYTES_PER_SEC,
+                StorageBackend storage_backend = StorageBackend::Posix)
+        : name_(name),
+          node_name_(node_name),
+          format_(format),
+          durability_(durability),
+          buffer_bytes_(buffer_bytes < 1 ? 1 : static_cast<size_t>(buffer_bytes)),
+          flush_interval_(flush_interval_ms < 1 ? 1 : flush_interval_ms),
+          row_group_rows_(row_group_rows < 1 ? 1 : static_cast<size_t>(row_group_rows)),
+          row_group_max_age_(row_group_max_age_ms < 1 ? 1 : row_group_max_age_ms),
+          segment_bytes_(segment_bytes < 1 ? 1 : static_cast<uint64_t>(segment_bytes)),
+          compaction_interval_(compaction_interval_ms),
+          compaction_rate_(compaction_bytes_per_sec < 0 ? 0 : static_cast<uint64_t>(compaction_bytes_per_sec)),
+          appender_(storage_backend, node_name, "table appends"),
+          manifest_(name, format) {
+        if (format_ == TableFormat::Columnar && durability_ == Durability::Batch) {
+            throw std::runtime_error("table_durability \"batch\" needs a row table_format (csv or segment)");
+        }
+        // Segment files the manifest does not list were being written, or were
+        // already replaced, when the node stopped.
+        for (const auto& file : manifest_.unlistedFiles()) {
+            std::cout << node_name_ << ": Removing leftover table segment " << file << std::endl;
+            ::unlink(file.c_str());
+        }
+        const auto& segments = manifest_.segments();
+        for (size_t i = 0; i + 1 < segments.size(); i++) {
+            sealed_segments_[segments[i].id] = openSegment(segments[i], false);
+        }
+        active_ = openSegment(segments.back(), true);
+        sealed_rows_ = active_->rows;
+        epoch_ = manifest_.epoch();
+        written_ = end_ = active_->size;
+        buffer_.reserve(buffer_bytes_);
+        spare_.reserve(buffer_bytes_);
+        appender_.registerBuffers({&buffer_, &spare_});
+        if (durability_ != Durability::Batch) {
+            flusher_ = std::thread(&TableWriter::flushLoop, this);
+        }
+        if (compaction_interval_ms > 0) {
+            compactor_ = std::thread(&TableWriter::compactLoop, this);
+        }
+    }
+
+    TableWriter(const std::string& name, const std::string& node_name, const json& config)
+        : TableWriter(name, node_name,
+                      tableFormat(config),
+                      parseDurability(config.value("table_durability", "periodic")),
+                      config.value("table_buffer_bytes", DEFAULT_TABLE_BUFFER_BYTES),
+                      config.value("table_flush_interval_ms", DEFAULT_TABLE_FLUSH_INTERVAL_MS),
+                      config.value("row_group_rows", DEFAULT_ROW_GROUP_ROWS),
+                      config.value("row_group_max_age_ms", DEFAULT_ROW_GROUP_MAX_AGE_MS),
+                      config.value("segment_bytes", DEFAULT_SEGMENT_BYTES),
+                      config.value("compaction_interval_ms", DEFAULT_COMPACTION_INTERVAL_MS),
+                      config.value("compaction_bytes_per_sec", DEFAULT_COMPACTION_BYTES_PER_SEC),
+                      storageBackend(config)) {}
+
+    ~TableWriter() {
+        stopCompaction();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        flush_cv_.notify_all();
+        if (flusher_.joinable()) {
+            flusher_.join();
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return !committing_; });
+            if (!group_.empty()) {
+                sealGroup();
+            }
+            if (!buffer_.empty() || unsynced_) {
+                commit(lock, durability_ != Durability::None);
+            }
+        }
+    }
+
+    TableWriter(const TableWriter&) = delete;
+    TableWriter& operator=(const TableWriter&) = delete;
+
+    const std::string& name() const {
+        return name_;
+    }
+
+    TableFormat format() const {
+        return format_;
+    }
+
+    size_t segmentCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return manifest_.segments().size();
+    }
+
+    // Let compaction rewrite the sealed segments listed before segment `id`,
+    // or all of them if `id` is not in the table. Nothing is compacted before
+    // the first call: the write-ahead log moves the limit up to each new
+    // checkpoint, so it never rewrites what recovery may still cut back.
+    void compactBefore(uint32_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        compaction_allowed_ = true;
+        compact_before_ = id;
+    }
+
+    // Abandon any compaction in progress and take no more.
+    void stopCompaction() {
+        stop_compaction_ = true;
+        flush_cv_.notify_all();
+        if (compactor_.joinable()) {
+            compactor_.join();
+        }
+    }
+
+    // Hooks into the table's index for compaction, both given a row's first
+    // column and location: keep_row says whether the row is still the current
+    // one; move_row repoints the index from the row's old location to its new
+    // one and says whether it did. Without them every row is kept. Waits for a
+    // compaction in progress.
+    void setRowIndexHooks(std::function<bool(std::string_view, const RowLocation&)> keep_row,
+                          std::function<bool(std::string_view, const RowLocation&, const RowLocation&)> move_row) {
+        std::lock_guard<std::mutex> hooks(hooks_mutex_);
+        keep_row_ = std::move(keep_row);
+        move_row_ = std::move(move_row);
+    }
+
+    // Note that the row at `location` was replaced by a later row with the same row_index.
+    void superseded(const RowLocation& location) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<Segment> segment = findSegment(location.segment);
+        if (segment) {
+            segment->dead_rows++;
+        }
+    }
+
+    // Encode any open row group (starting a new segment if that fills this
+    // one) and return the position just past the last appended row. The rows
+    // up to it reach the file with the next commit.
+    TablePosition seal() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !rolling_; });
+        if (!group_.empty()) {
+            sealGroup();
+            rollOver(lock);
+        }
+        return TablePosition{active_->id, end_};
+    }
+
+    // Write out and fdatasync every row appended so far. Throws if that
+    // fails, so a checkpoint is not taken over rows that are not durable.
+    void sync() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !committing_ && !rolling_; });
+        if ((!buffer_.empty() || unsynced_) && !commit(lock, true)) {
+            throw std::runtime_error("Failed to sync local table " + active_->path);
+        }
+    }
+
+    // Manifest epoch (see table_manifest.hpp) whose row moves the index has
+    // been told about.
+    uint64_t epoch() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return epoch_;
+    }
+
+    // Whether `position` (as returned by seal()) still lies within the table.
+    bool contains(const TablePosition& position) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<Segment> segment = findSegment(position.segment);
+        return segment && position.offset <= (segment == active_ ? end_ : segment->size);
+    }
+
+    // Call fn(const RowLocation&, std::string_view first_column) for every row
+    // already in the table from `from` (as returned by seal()) on, or from the
+    // start, segment by segment in row order, e.g. to rebuild an index. Call
+    // before the first append(). Returns the number of rows visited.
+    template <typename Fn>
+    size_t forEachRow(Fn fn, const TablePosition& from = TablePosition()) {
+        std::vector<std::shared_ptr<Segment>> segments;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& entry : manifest_.segments()) {
+                if (entry.id == from.segment) {
+                    segments.clear();
+                }
+                segments.push_back(findSegment(entry.id));
+            }
+        }
+        size_t total = 0;
+        for (const auto& segment : segments) {
+            uint64_t skip = segment->id == from.segment ? from.offset : 0;
+            if (format_ == TableFormat::Columnar) {
+                // Only the first column's chunks are read; `skip` falls on a group boundary.
+                ColumnarReader reader(segment->path);
+                uint64_t first_row = 0;
+                for (size_t g = 0; g < reader.groups().size(); g++) {
+                    const auto& group = reader.groups()[g];
+                    ChunkView chunk;
+                    if (reader.offset(g) >= skip && group.columnCount() > 0 && group.chunk(0, &chunk)) {
+                        chunk.forEach([&](size_t i, std::string_view value) {
+                            fn(RowLocation{segment->id, first_row + i, 0}, value);
+                        });
+                        total += group.rows();
+                    }
+                    first_row += group.rows();
+                }
+            } else if (format_ == TableFormat::Segment) {
+                SegmentReader reader(segment->path);
+                size_t offset = std::max<size_t>(reader.begin(), skip);
+                RowView row;
+                size_t start = offset;
+                while (reader.read(&offset, &row) == SegmentReader::Result::Row) {
+                    fn(RowLocation{segment->id, start, static_cast<uint32_t>(offset - start)}, row.column(0));
+                    start = offset;
+                    total++;
+                }
+            } else {
+                std::ifstream file(segment->path, std::ios::binary);
+                file.seekg(static_cast<std::streamoff>(skip));
+                std::string line;
+                uint64_t offset = skip;
+                while (std::getline(file, line)) {
+                    uint32_t length = static_cast<uint32_t>(line.size() + 1);
+                    std::string_view text(line);
+                    fn(RowLocation{segment->id, offset, length}, text.substr(0, text.find(',')));
+                    offset += length;
+                    total++;
+                }
+            }
+        }
+        return total;
+    }
+
+    // Write out every row appended so far, encoding any open row group, then
+    // call fn(const std::string& path, uint64_t end) for each segment file in
+    // row order, where `end` is the offset just past its last row. Segments
+    // compaction drops in the meantime stay on disk until fn is done.
+    template <typename Fn>
+    void forEachSegment(Fn fn) {
+        std::vector<std::pair<std::shared_ptr<Segment>, uint64_t>> segments;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return !committing_ && !rolling_; });
+            if (!group_.empty()) {
+                sealGroup();
+                rollOver(lock);
+            }
+            if (!buffer_.empty()) {
+                commit(lock, false);
+            }
+            for (const auto& entry : manifest_.segments()) {
+                std::shared_ptr<Segment> segment = findSegment(entry.id);
+                segments.emplace_back(segment, segment == active_ ? written_ : segment->size);
+            }
+        }
+        for (const auto& segment : segments) {
+            fn(segment.first->path, segment.second);
+        }
+    }
+
+    // Read back the row at `location` (as returned by append()). Fails if
+    // compaction has since moved the row; look its location up again.
+    bool read(const RowLocation& location, std::vector<std::string>* columns) {
+        if (format_ == TableFormat::Columnar) {
+            return readColumnar(location.segment, location.offset, columns);
+        }
+        std::string bytes;
+        if (!readBytes(location, &bytes)) {
+            return false;
+        }
+        columns->clear();
+        if (format_ == TableFormat::Segment) {
+            RowView row;
+            size_t record_size;
+            if (!decodeRecord(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), true, &row,
+                              &record_size)) {
+                return false;
+            }
+            for (size_t i = 0; i < row.columnCount(); i++) {
+                columns->emplace_back(row.column(i));
+            }
+            return true;
+        }
+        if (bytes.empty() || bytes.back() != '\n') {
+            return false;
+        }
+        bytes.pop_back();
+        size_t start = 0;
+        size_t comma;
+        while ((comma = bytes.find(',', start)) != std::string::npos) {
+            columns->push_back(bytes.substr(start, comma - start));
+            start = comma + 1;
+        }
+        columns->push_back(bytes.substr(start));
+        return true;
+    }
+
+    // Append one row (a vector of strings or string_views): a comma-joined
+    // line, a segment record or a row of the open group. Its columns are
+    // copied straight into the write buffer. Returns where it was put, or
+    // nothing if it could not be stored: under "batch" the write or sync of
+    // its group failed (the row stays buffered and may still reach the file
+    // later), or an earlier failure left the file unusable.
+    template <typename Columns>
+    std::optional<RowLocation> append(const Columns& row) {
+        if (format_ == TableFormat::Columnar) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return !rolling_; });
+            if (failed_) {
+                return std::nullopt;
+            }
+            RowLocation location{active_->id, sealed_rows_ + group_.rows(), 0};
+            if (group_.empty()) {
+                group_started_ = std::chrono::steady_clock::now();
+            }
+            group_.add(row);
+            active_->rows++;
+            if (group_.rows() >= row_group_rows_) {
+                sealGroup();
+                if (end_ >= segment_bytes_) {
+                    rollOver(lock);
+                } else if (buffer_.size() >= buffer_bytes_ && !committing_) {
+                    commit(lock, false);
+                }
+            }
+            return location;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !rolling_; });
+        if (failed_) {
+            return std::nullopt;
+        }
+        size_t before = buffer_.size();
+        if (format_ == TableFormat::Segment) {
+            encodeRow(row, &buffer_);
+        } else {
+            appendCsvLine(row, &buffer_);
+        }
+        RowLocation location{active_->id, end_, static_cast<uint32_t>(buffer_.size() - before)};
+        end_ += location.length;
+        active_->rows++;
+        if (durability_ == Durability::Batch) {
+            std::shared_ptr<Batch> batch = batch_;
+            while (!batch->done) {
+                if (committing_) {
+                    cv_.wait(lock);
+                } else {
+                    commit(lock, true);
+                }
+            }
+            if (!batch->ok) {
+                return std::nullopt;
+            }
+        }
+        if (end_ >= segment_bytes_) {
+            rollOver(lock);
+        } else if (buffer_.size() >= buffer_bytes_ && !committing_) {
+            commit(lock, false);
+        }
+        return location;
+    }
+};
+
+// Cut table `name` back to `position`, e.g. to the last checkpoint of a
+// write-ahead log that appends every later row again: segments after the one
+// holding `position` are dropped and that one is truncated there. Call before
+// the table is opened.
+inline void rollBackTable(const std::string& name, const std::string& node_name, TableFormat format,
+                          const TablePosition& position) {
+    TableManifest manifest(name, format);
+    int index = manifest.indexOf(position.segment);
+    if (index < 0) {
+        std::cerr << node_name << ": Table segment " << position.segment << " of the last checkpoint is missing from "
+                  << manifest.path() << std::endl;
+        return;
+    }
+    std::vector<TableManifest::Entry> dropped = manifest.dropAfter(static_cast<size_t>(index));
+    if (!dropped.empty()) {
+        manifest.store();
+        for (const auto& entry : dropped) {
+            std::cout << node_name << ": Dropping table segment " << entry.file << " started after the "
+                      << "last checkpoint; its rows are replayed from the log" << std::endl;
+            ::unlink(entry.file.c_str());
+        }
+    }
+    const std::string& path = manifest.segments()[index].file;
+    struct stat st;
+    uint64_t size = ::stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+    if (size < position.offset) {
+        std::cerr << node_name << ": Local table " << path << " is shorter (" << size
+                  << " bytes) than at the last checkpoint (" << position.offset << " bytes)" << std::endl;
+    } else if (size > position.offset) {
+        std::cout << node_name << ": Cutting " << (size - position.offset) << " bytes written after the "
+                  << "last checkpoint off " << path << "; they are replayed from the log" << std::endl;
+        if (::truncate(path.c_str(), static_cast<off_t>(position.offset)) != 0) {
+            throw std::runtime_error("Failed to truncate local table " + path);
+        }
+    }
+}
+
+#endif // TABLE_WRITER_HPP
@@ -0,0 +1,628 @@
+#ifndef WAL_HPP
+#define WAL_HPP
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "column_store.hpp"
+#include "crc32c.hpp"
+#include "row_index.hpp"
+#include "row_segment.hpp"
+#include "storage_ring.hpp"
+#include "table_writer.hpp"
+
+using json = nlohmann::json;
+
+// Write-ahead log of the rows a node accepts.
+//
+// Every stored row is logged once, before it touches anything else; the local
+// table, the row index and the shared memory counters are all applied from
+// that record. A checkpoint makes the table and shared memory durable, notes
+// the last row they contain and starts a new log file, so a restart replays
+// only what was logged since.
+//
+//   <name>.wal.<generation>
+//     file    := header record*
+//     header  := "NWAL" u16 version u16 reserved u64 generation     (16 bytes)
+//     record  := u32 body_length u32 crc32c(body) body
+//     body    := u64 lsn i32 row_index u32 position i8 slot u8 flags u16 reserved
+//                row_body                                           (see row_segment.hpp)
+//
+//   <name>.checkpoint
+//     "NCKP" u16 version u16 reserved u64 generation u64 lsn u32 table_segment
+//     u64 table_end u32 crc32c
+//
+// The checkpoint names the first log file still needed and the table position
+// (segment and offset, see table_manifest.hpp) that covers every row up to
+// `lsn`. Recovery cuts the table back to that position and appends the logged
+// rows again, so the table comes out exactly as logged. Shared memory updates are made idempotent instead: a row's place in
+// its node's array (`position`) is fixed when it is logged, and a row whose
+// own entry is already filled was applied before the crash. Rows are applied
+// concurrently and so not in position order; the size of the array only says
+// which positions were handed out, not which were written.
+//
+// Checkpoints also write the row index's memtable out as a run once it is
+// full (see row_index.hpp), after the checkpoint itself is stored, so the
+// runs never cover more of the table than recovery keeps. They are taken with
+// the log off too, for the index alone, and once more on stop() so a restart
+// has nothing to replay or scan.
+//
+// Rows are written to the kernel before write() applies them, so a crashed
+// process loses nothing it acknowledged. "wal_durability" says how far they
+// must get beyond that: "none" (synced at checkpoints only), "periodic"
+// (fdatasync every wal_sync_interval_ms) or "batch" (fdatasync before the row
+// is applied, one sync per group of concurrent rows). "off" disables the log.
+// A group whose write (or sync) fails is cut off the log again and fails as a
+// whole: write() throws for each of its rows, so none is acknowledged.
+
+const char WAL_MAGIC[4] = {'N', 'W', 'A', 'L'};
+const char CHECKPOINT_MAGIC[4] = {'N', 'C', 'K', 'P'};
+const uint16_t WAL_VERSION = 1;
+const size_t WAL_HEADER_SIZE = 16;
+const size_t WAL_RECORD_HEADER = 20;
+const uint16_t CHECKPOINT_VERSION = 2;
+const size_t CHECKPOINT_SIZE = 40;
+// Version 1 checkpoints predate table segments and have no table_segment.
+const size_t CHECKPOINT_V1_SIZE = 36;
+
+// Record flags: what the row does besides being stored.
+const uint8_t WAL_INDEXED = 1;       // row_index was parsed from the first column
+const uint8_t WAL_COUNTED = 2;       // increments the shared memory counter
+const uint8_t WAL_LAST_TARGET = 4;   // sets the shared memory last_target to slot
+
+// Default interval for "periodic" log syncs.
+const int DEFAULT_WAL_SYNC_INTERVAL_MS = 200;
+// Default interval between checkpoints.
+const int DEFAULT_CHECKPOINT_INTERVAL_MS = 10000;
+// Default log size after which a checkpoint is taken early.
+const int DEFAULT_CHECKPOINT_WAL_BYTES = 64 << 20;
+// Capacity reserved up front for each of the two group commit buffers.
+const size_t WAL_BUFFER_BYTES = 1 << 20;
+
+inline bool walEnabled(const json& config) {
+    return config.value("wal_durability", "periodic") != "off";
+}
+
+inline Durability walDurability(const json& config) {
+    return walEnabled(config) ? parseDurability(config.value("wal_durability", "periodic"), "wal_durability")
+                              : Durability::None;
+}
+
+// One accepted row and its effect on shared memory.
+struct WalRecord {
+    uint64_t lsn = 0;                   // assigned by write()
+    int32_t row_index = 0;
+    int8_t slot = -1;                   // shared memory array the row index goes to, -1 for none
+    uint8_t flags = 0;
+    uint32_t position = 0;              // place in the slot's array, assigned by write()
+    // The row's columns, viewing the payload they were split from (or, on
+    // replay, the log); only valid until write() or the replay callback returns.
+    std::vector<std::string_view> columns;
+};
+
+class WriteAheadLog {
+private:
+    struct Checkpoint {
+        uint64_t generation = 1;
+        uint64_t lsn = 0;
+        TablePosition table_end;
+    };
+
+    std::string name_;
+    std::string node_name_;
+    bool enabled_;
+    Durability durability_;
+    std::chrono::milliseconds sync_interval_;
+    std::chrono::milliseconds checkpoint_interval_;
+    uint64_t checkpoint_bytes_;
+    Appender appender_;                   // how groups reach the log file
+
+    Checkpoint checkpoint_;
+    TableWriter* table_ = nullptr;
+    RowIndex* index_ = nullptr;
+    std::function<void()> sync_shared_;
+
+    // Held shared by write() from logging to applying a row, and exclusively by
+    // a checkpoint while it cuts the table and switches log files.
+    std::shared_mutex apply_mutex_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;          // a group commit finished
+    std::condition_variable flush_cv_;    // wakes the checkpointer on shutdown
+    int fd_ = -1;
+    uint64_t generation_ = 0;             // generation of the file behind fd_
+    uint64_t log_bytes_ = 0;              // bytes in the current log file
+    std::string buffer_;                  // records not yet written
+    std::string spare_;
+    uint64_t lsn_ = 0;                    // last assigned lsn
+    // The records in buffer_, written out together by one commit(); each
+    // write() waits on the group its record went into.
+    struct Group {
+        bool done = false;
+        bool ok = false;
+    };
+    std::shared_ptr<Group> group_ = std::make_shared<Group>();
+    bool committing_ = false;
+    bool unsynced_ = false;
+    bool stopping_ = false;
+    bool failed_ = false;                 // a failed group could not be cut off the log
+    std::vector<uint32_t> positions_;     // next free position per shared memory slot
+    std::chrono::steady_clock::time_point last_checkpoint_;
+    std::thread checkpointer_;
+
+    std::string logPath(uint64_t generation) const {
+        return name_ + ".wal." + std::to_string(generation);
+    }
+
+    std::string checkpointPath() const {
+        return name_ + ".checkpoint";
+    }
+
+    static bool writeAll(int fd, const char* data, size_t size) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::write(fd, data + done, size - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static bool readFile(const std::string& path, std::string* data) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        data->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    bool loadCheckpoint(Checkpoint* checkpoint) const {
+        std::string data;
+        if (!readFile(checkpointPath(), &data)) {
+            return false;
+        }
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+        uint16_t version = data.size() >= 6 ? getU16(p + 4) : 0;
+        size_t size = version == 1 ? CHECKPOINT_V1_SIZE : CHECKPOINT_SIZE;
+        if (data.size() != size || std::memcmp(p, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+            (version != 1 && version != CHECKPOINT_VERSION) || crc32c(p, size - 4) != getU32(p + size - 4)) {
+            throw std::runtime_error("Damaged checkpoint " + checkpointPath());
+        }
+        checkpoint->generation = getU64(p + 8);
+        checkpoint->lsn = getU64(p + 16);
+        if (version == 1) {
+            // The single table file is adopted as segment 1.
+            checkpoint->table_end = TablePosition{1, getU64(p + 24)};
+        } else {
+            checkpoint->table_end = TablePosition{getU32(p + 24), getU64(p + 28)};
+        }
+        return true;
+    }
+
+    void storeCheckpoint(const Checkpoint& checkpoint) const {
+        std::string data(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        putU16(&data, CHECKPOINT_VERSION);
+        putU16(&data, 0);
+        putU64(&data, checkpoint.generation);
+        putU64(&data, checkpoint.lsn);
+        putU32(&data, checkpoint.table_end.segment);
+        putU64(&data, checkpoint.table_end.offset);
+        putU32(&data, crc32c(data.data(), data.size()));
+        replaceFile(checkpointPath(), data);
+    }
+
+    // Create log file `generation` and make it the one records go to. Called
+    // with mutex_ held and no other commit writing.
+    void openLog(uint64_t generation) {
+        std::string path = logPath(generation);
+        int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open write-ahead log " + path + ": " + std::strerror(errno));
+        }
+        std::string header(WAL_MAGIC, sizeof(WAL_MAGIC));
+        putU16(&header, WAL_VERSION);
+        putU16(&header, 0);
+        putU64(&header, generation);
+        if (!writeAll(fd, header.data(), header.size()) || ::fdatasync(fd) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to write write-ahead log header to " + path);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_ = fd;
+        generation_ = generation;
+        log_bytes_ = header.size();
+        unsynced_ = false;
+        failed_ = false;
+    }
+
+    void encode(const WalRecord& record, std::string* out) {
+        size_t start = out->size();
+        putU32(out, 0);   // body length, patched below
+        putU32(out, 0);   // crc, patched below
+        size_t body = out->size();
+        putU64(out, record.lsn);
+        putU32(out, static_cast<uint32_t>(record.row_index));
+        putU32(out, record.position);
+        out->push_back(static_cast<char>(record.slot));
+        out->push_back(static_cast<char>(record.flags));
+        putU16(out, 0);
+        encodeRowBody(record.columns, out);
+        uint32_t body_length = static_cast<uint32_t>(out->size() - body);
+        uint32_t crc = crc32c(out->data() + body, body_length);
+        std::memcpy(&(*out)[start], &body_length, sizeof(body_length));
+        std::memcpy(&(*out)[start + 4], &crc, sizeof(crc));
+    }
+
+    // Decode the record at the start of `data`; false for a torn or damaged one.
+    static bool decode(const uint8_t* data, size_t size, WalRecord* record, size_t* record_size) {
+        if (size < SEGMENT_RECORD_PREFIX) {
+            return false;
+        }
+        uint32_t body_length = getU32(data);
+        const uint8_t* body = data + SEGMENT_RECORD_PREFIX;
+        if (body_length < WAL_RECORD_HEADER || body_length > SEGMENT_MAX_BODY ||
+            body_length > size - SEGMENT_RECORD_PREFIX || crc32c(body, body_length) != getU32(data + 4) ||
+            !isRowBody(body + WAL_RECORD_HEADER, body_length - WAL_RECORD_HEADER)) {
+            return false;
+        }
+        record->lsn = getU64(body);
+        record->row_index = static_cast<int32_t>(getU32(body + 8));
+        record->position = getU32(body + 12);
+        record->slot = static_cast<int8_t>(body[16]);
+        record->flags = body[17];
+        RowView row(body + WAL_RECORD_HEADER);
+        record->columns.clear();
+        for (size_t i = 0; i < row.columnCount(); i++) {
+            record->columns.emplace_back(row.column(i));
+        }
+        *record_size = SEGMENT_RECORD_PREFIX + body_length;
+        return true;
+    }
+
+    // Write out every queued record, syncing if asked. Called with `lock` held.
+    // If that fails the whole group fails: its writers get an error and none
+    // of its rows are applied.
+    void commit(std::unique_lock<std::mutex>& lock, bool sync) {
+        committing_ = true;
+        std::string data;
+        data.swap(buffer_);
+        buffer_.swap(spare_);
+        std::shared_ptr<Group> group = std::move(group_);
+        group_ = std::make_shared<Group>();
+        lock.unlock();
+
+        bool ok = appender_.append(fd_, data, sync);
+        if (!ok) {
+            std::cerr << node_name_ << ": Error writing write-ahead log " << logPath(generation_) << ": "
+                      << std::strerror(errno) << std::endl;
+        }
+
+        lock.lock();
+        if (ok) {
+            log_bytes_ += data.size();
+        } else {
+            dropFailedGroup();
+        }
+        data.clear();
+        spare_.swap(data);
+        group->done = true;
+        group->ok = ok;
+        unsynced_ = !(ok && sync);
+        committing_ = false;
+        cv_.notify_all();
+    }
+
+    // Cut whatever part of a failed group reached the log file off again:
+    // replay stops at the first torn record, so rows logged behind one would
+    // be lost. If the file cannot be cut back, later groups go to a new log
+    // file instead, and if even that fails the log takes no more rows.
+    // Called with mutex_ held.
+    void dropFailedGroup() {
+        if (::ftruncate(fd_, static_cast<off_t>(log_bytes_)) == 0) {
+            return;
+        }
+        std::cerr << node_name_ << ": Could not cut back write-ahead log " << logPath(generation_) << ": "
+                  << std::strerror(errno) << std::endl;
+        try {
+            openLog(generation_ + 1);
+        } catch (const std::exception& e) {
+            std::cerr << node_name_ << ": " << e.what() << "; no longer accepting rows" << std::endl;
+            failed_ = true;
+        }
+    }
+
+    // Make every applied row durable in the table and shared memory, then move
+    // the checkpoint past them and drop the log files it no longer needs.
+    // Writes the row index's memtable out if it is full, or in any case if `final`.
+    void takeCheckpoint(bool final = false) {
+        Checkpoint next;
+        uint64_t previous = 0;
+        bool flush_index;
+        {
+            std::unique_lock<std::shared_mutex> pause(apply_mutex_);
+            std::unique_lock<std::mutex> lock(mutex_);
+            // Every write() has finished, so every logged row is in the table.
+            next.lsn = lsn_;
+            next.table_end = table_->seal();
+            flush_index = index_->freeze(next.table_end, final);
+            if (enabled_) {
+                next.generation = generation_ + 1;
+                previous = generation_;
+                openLog(next.generation);
+            }
+            last_checkpoint_ = std::chrono::steady_clock::now();
+        }
+        if (!enabled_) {
+            if (flush_index) {
+                table_->sync();
+                index_->flush();
+            }
+            return;
+        }
+        table_->sync();
+        sync_shared_();
+        storeCheckpoint(next);
+        for (uint64_t generation = checkpoint_.generation; generation <= previous; generation++) {
+            ::unlink(logPath(generation).c_str());
+        }
+        checkpoint_ = next;
+        // Recovery no longer cuts back anything before the new checkpoint's segment.
+        table_->compactBefore(next.table_end.segment);
+        if (flush_index) {
+            index_->flush();
+        }
+    }
+
+    void checkpointLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            flush_cv_.wait_for(lock, sync_interval_, [this] { return stopping_; });
+            if (stopping_) {
+                break;
+            }
+            if (durability_ == Durability::Periodic && unsynced_ && !committing_) {
+                // Records are already written; syncing needs no lock.
+                int fd = fd_;
+                lock.unlock();
+                bool ok = ::fdatasync(fd) == 0;
+                lock.lock();
+                if (ok && fd == fd_) {
+                    unsynced_ = false;
+                }
+            }
+            if (log_bytes_ >= checkpoint_bytes_ ||
+                std::chrono::steady_clock::now() - last_checkpoint_ >= checkpoint_interval_) {
+                lock.unlock();
+                try {
+                    takeCheckpoint();
+                } catch (const std::exception& e) {
+                    std::cerr << node_name_ << ": Checkpoint failed: " << e.what() << std::endl;
+                }
+                lock.lock();
+                last_checkpoint_ = std::chrono::steady_clock::now();
+            }
+        }
+    }
+
+public:
+    // Open the log of table `name` (files "<name>.wal.<n>" and "<name>.checkpoint").
+    // Call before the table is opened: rows past the checkpoint are cut off it
+    // here and come back through replay().
+    WriteAheadLog(const std::string& name, TableFormat format, const std::string& node_name,
+                  bool enabled, Durability durability, int sync_interval_ms, int checkpoint_interval_ms,
+                  int checkpoint_bytes, StorageBackend storage_backend = StorageBackend::Posix)
+        : name_(name),
+          node_name_(node_name),
+          enabled_(enabled),
+          durability_(durability),
+          sync_interval_(sync_interval_ms < 1 ? 1 : sync_interval_ms),
+          checkpoint_interval_(checkpoint_interval_ms < 1 ? 1 : checkpoint_interval_ms),
+          checkpoint_bytes_(checkpoint_bytes < 1 ? 1 : static_cast<uint64_t>(checkpoint_bytes)),
+          appender_(enabled ? storage_backend : StorageBackend::Posix, node_name, "log appends") {
+        buffer_.reserve(WAL_BUFFER_BYTES);
+        spare_.reserve(WAL_BUFFER_BYTES);
+        appender_.registerBuffers({&buffer_, &spare_});
+        bool loaded = enabled_ && loadCheckpoint(&checkpoint_);
+        generation_ = checkpoint_.generation - 1;
+        if (loaded) {
+            rollBackTable(name_, node_name_, format, checkpoint_.table_end);
+        }
+    }
+
+    WriteAheadLog(const std::string& name, TableFormat format, const std::string& node_name,
+                  const json& config)
+        : WriteAheadLog(name, format, node_name, walEnabled(config), walDurability(config),
+                        config.value("wal_sync_interval_ms", DEFAULT_WAL_SYNC_INTERVAL_MS),
+                        config.value("checkpoint_interval_ms", DEFAULT_CHECKPOINT_INTERVAL_MS),
+                        config.value("checkpoint_wal_bytes", DEFAULT_CHECKPOINT_WAL_BYTES),
+                        storageBackend(config)) {}
+
+    ~WriteAheadLog() {
+        stop();
+        if (fd_ >= 0) {
+            ::fdatasync(fd_);
+            ::close(fd_);
+        }
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Take a last checkpoint and stop; call before the table, its index or
+    // shared memory go away.
+    void stop() {
+        bool first;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            first = !stopping_;
+            stopping_ = true;
+        }
+        flush_cv_.notify_all();
+        if (checkpointer_.joinable()) {
+            checkpointer_.join();
+        }
+        if (first && index_) {
+            // Let a compaction finish moving rows first, so the index written now stays valid.
+            table_->stopCompaction();
+            try {
+                takeCheckpoint(true);
+            } catch (const std::exception& e) {
+                std::cerr << node_name_ << ": Final checkpoint failed: " << e.what() << std::endl;
+            }
+        }
+    }
+
+    bool enabled() const {
+        return enabled_;
+    }
+
+    // Call fn(const WalRecord&) for every row logged after the last checkpoint,
+    // in log order. Returns the number of rows replayed.
+    template <typename Fn>
+    size_t replay(Fn fn) {
+        if (!enabled_) {
+            return 0;
+        }
+        auto start = std::chrono::steady_clock::now();
+        size_t rows = 0;
+        lsn_ = checkpoint_.lsn;
+        std::string data;
+        for (uint64_t generation = checkpoint_.generation; readFile(logPath(generation), &data); generation++) {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+            if (data.size() < WAL_HEADER_SIZE || std::memcmp(p, WAL_MAGIC, sizeof(WAL_MAGIC)) != 0 ||
+                getU16(p + 4) != WAL_VERSION || getU64(p + 8) != generation) {
+                std::cerr << node_name_ << ": Skipping damaged write-ahead log " << logPath(generation) << std::endl;
+                generation_ = generation;
+                continue;
+            }
+            generation_ = generation;
+            size_t offset = WAL_HEADER_SIZE;
+            WalRecord record;
+            size_t record_size;
+            while (decode(p + offset, data.size() - offset, &record, &record_size)) {
+                if (record.lsn > lsn_) {
+                    fn(record);
+                    lsn_ = record.lsn;
+                    rows++;
+                }
+                offset += record_size;
+            }
+            if (offset < data.size()) {
+                std::cerr << node_name_ << ": Ignoring " << (data.size() - offset) << " damaged bytes at the end of "
+                          << logPath(generation) << std::endl;
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << node_name_ << ": Replayed " << rows << " rows from the write-ahead log in " << elapsed.count()
+                  << " ms" << std::endl;
+        return rows;
+    }
+
+    // Start taking rows. positions holds the first free position of each shared
+    // memory slot; sync_shared makes the shared memory durable. Takes a first
+    // checkpoint, so the replayed log is not needed again, and lets the table
+    // compact what lies before it.
+    void start(TableWriter& table, RowIndex& index, std::vector<uint32_t> positions,
+               std::function<void()> sync_shared) {
+        table_ = &table;
+        index_ = &index;
+        positions_ = std::move(positions);
+        sync_shared_ = std::move(sync_shared);
+        if (!enabled_) {
+            table.compactBefore(UINT32_MAX);
+        }
+        takeCheckpoint();
+        checkpointer_ = std::thread(&WriteAheadLog::checkpointLoop, this);
+    }
+
+    // Log `record` and then apply it with apply(const WalRecord&). Assigns its
+    // lsn and, for a row with a shared memory slot, its position in that array.
+    // Throws, without applying the row, if it could not be logged.
+    template <typename Fn>
+    void write(WalRecord* record, Fn apply) {
+        std::shared_lock<std::shared_mutex> applying(apply_mutex_);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (failed_) {
+                throw std::runtime_error("Write-ahead log " + name_ + " is not accepting rows");
+            }
+            record->lsn = ++lsn_;
+            if (record->slot >= 0) {
+                if (static_cast<size_t>(record->slot) >= positions_.size()) {
+                    positions_.resize(record->slot + 1, 0);
+                }
+                record->position = positions_[record->slot]++;
+            }
+            if (enabled_) {
+                encode(*record, &buffer_);
+                std::shared_ptr<Group> group = group_;
+                while (!group->done) {
+                    if (committing_) {
+                        cv_.wait(lock);
+                    } else {
+                        commit(lock, durability_ == Durability::Batch);
+                    }
+                }
+                if (!group->ok) {
+                    throw std::runtime_error("Failed to log row for table " + name_);
+                }
+            }
+        }
+        apply(*record);
+    }
+};
+
+// Apply a logged row: store it in the table and its index, then update shared
+// memory (each node has its own SharedMemory class, hence the template). A
+// replayed row whose entry in shared memory is already filled got there before
+// the crash and only goes to the table. The entry is stored last, so it marks
+// the row's shared memory update as done.
+template <typename SharedMemoryT>
+void applyWalRecord(const WalRecord& record, bool replay, TableWriter& table, RowIndex& index,
+                    SharedMemoryT& shared_memory) {
+    std::optional<RowLocation> location = table.append(record.columns);
+    if (!location) {
+        throw std::runtime_error("Failed to store row in local table " + table.name());
+    }
+    if (record.flags & WAL_INDEXED) {
+        index.add(record.row_index, *location);
+    }
+    if (record.slot < 0 || (replay && shared_memory.hasMessageAt(record.slot, static_cast<int>(record.position)))) {
+        return;
+    }
+    if (record.flags & WAL_COUNTED) {
+        shared_memory.incrementCounter();
+    }
+    if (record.flags & WAL_LAST_TARGET) {
+        shared_memory.setLastTarget(record.slot);
+    }
+    shared_memory.setMessageAt(record.slot, static_cast<int>(record.position), record.row_index);
+}
+
+#endif // WAL_HPP
@@ -0,0 +1,63 @@
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "routing_hash.hpp"
+
+// Micro-benchmark for the routing hash policies.
+// Hashes every row of a node table (by default nodeB/nodeB_table.csv) repeatedly
+// and reports the average cost per row for each policy.
+
+// Keeps the compiler from discarding the hash results.
+static volatile uint64_t sink;
+
+double nsPerRow(const RoutingHash& hasher, const std::vector<std::string>& rows, int iterations) {
+    uint64_t acc = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        for (const auto& row : rows) {
+            acc += hasher.hash(row);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    sink = acc;
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / (static_cast<double>(rows.size()) * iterations);
+}
+
+int main(int argc, char* argv[]) {
+    std::string filename = argc > 1 ? argv[1] : "nodeB/nodeB_table.csv";
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 100000;
+
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open table: " << filename << std::endl;
+        return 1;
+    }
+    std::vector<std::string> rows;
+    std::string line;
+    size_t total_bytes = 0;
+    while (std::getline(file, line)) {
+        total_bytes += line.size();
+        rows.push_back(line);
+    }
+    if (rows.empty()) {
+        std::cerr << "No rows in table: " << filename << std::endl;
+        return 1;
+    }
+
+    std::cout << "Rows: " << rows.size() << ", average payload: "
+              << (total_bytes / rows.size()) << " bytes, iterations: " << iterations << std::endl;
+
+    for (const char* policy : {"fast", "sha256"}) {
+        auto hasher = makeRoutingHash(policy);
+        // Warm up caches before timing.
+        nsPerRow(*hasher, rows, 1000);
+        double ns = nsPerRow(*hasher, rows, iterations);
+        std::cout << std::left << std::setw(8) << hasher->name()
+                  << std::fixed << std::setprecision(1) << ns << " ns/row" << std::endl;
+    }
+    return 0;
+}
@@ -2,68 +2,89 @@
 #include "data.grpc.pb.h"
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <nlohmann/json.hpp>
 #include <memory>
 #include <cstdlib>
 #include "shared_memory.hpp"
-#include <openssl/sha.h>
-#include <cstring>    // For memcpy
+#include "table_writer.hpp"
+#include "channel_pool.hpp"
+#include "async_forwarder.hpp"
+#include "edge_coalescer.hpp"
+#include "routing_hash.hpp"
+#include "hash_ring.hpp"
+#include "route_stamp.hpp"
+#include "row_index.hpp"
+#include "table_scan.hpp"
+#include "wal.hpp"
+#include "csv_row.hpp"
+#include <cstring>
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <unordered_map>
 
 using grpc::Server;
 using grpc::ServerBuilder;
 using grpc::ServerContext;
+using grpc::ServerReader;
+using grpc::ServerWriter;
 using grpc::Status;
 using grpc::ClientContext;
 using grpc::CreateChannel;
 using data::DataMessage;
+using data::DataBatch;
 using data::Empty;
+using data::Row;
+using data::RowRequest;
+using data::RowBatch;
+using data::ScanRequest;
 using data::DataService;
 using json = nlohmann::json;
 
 // Number of columns expected in the local table.
 const int NUM_COLS = 16;
-// Name of the CSV file used to store rows locally for NodeB.
-const std::string LOCAL_TABLE_FILENAME = "nodeB_table.csv";
+// Name of the table used to store rows locally for NodeB (".csv" or ".seg" is appended).
+const std::string LOCAL_TABLE_NAME = "nodeB_table";
 
 // Global fallback counter for row indices.
 static int localRowCounter = 0;
 
-// Helper: Split a string by a given delimiter.
-std::vector<std::string> splitRow(const std::string& row, char delimiter) {
-    std::vector<std::string> tokens;
-    std::istringstream ss(row);
-    std::string token;
-    while (std::getline(ss, token, delimiter)) {
-        tokens.push_back(token);
-    }
-    return tokens;
-}
-
-// Helper: Append a row (vector of strings) to the CSV file.
-void appendRowToCSV(const std::vector<std::string>& row) {
-    std::ofstream outfile;
-    outfile.open(LOCAL_TABLE_FILENAME, std::ios::out | std::ios::app);
-    if (!outfile.is_open()) {
-        std::cerr << "NodeB: Error opening local table file for writing." << std::endl;
-        return;
-    }
-    for (size_t i = 0; i < row.size(); i++) {
-        outfile << row[i];
-        if (i < row.size() - 1)
-            outfile << ",";
-    }
-    outfile << "\n";
-    outfile.close();
+// Helper: Map a node id to its slot in shared memory (-1 for nodes without one).
+int sharedMemoryNode(const std::string& id) {
+    static const std::unordered_map<std::string, int> slots = {{"B", 0}, {"C", 1}, {"D", 2}, {"E", 3}};
+    auto it = slots.find(id);
+    return it == slots.end() ? -1 : it->second;
 }
 
 class DataServiceImpl final : public DataService::Service {
 private:
     SharedMemory shared_memory_;
     json config_;
+    // Local table kept open for the life of the node.
+    std::unique_ptr<TableWriter> table_;
+    // Primary index of table_ by row_index, reloaded from its stored runs on startup.
+    std::unique_ptr<RowIndex> row_index_;
+    // Log of accepted rows; table_, row_index_ and shared_memory_ are applied from it.
+    std::unique_ptr<WriteAheadLog> wal_;
+    // Long-lived channels/stubs to Nodes C and D, built once from config_["edges"].
+    std::unique_ptr<ChannelPool> channels_;
+    // Completion-queue based forwarding engine on top of channels_.
+    std::unique_ptr<AsyncForwarder> forwarder_;
+    // Groups single forwarded rows into per-edge PushBatch calls.
+    std::unique_ptr<EdgeCoalescer> coalescer_;
+    // Routing hash selected by "hash_policy"; must match the other routing nodes.
+    std::unique_ptr<RoutingHash> routing_hash_;
+    // Reuses the routing hash carried in forwarded messages and guards against loops.
+    std::unique_ptr<RouteStamp> route_stamp_;
+    // Consistent-hash ring over NodeB and its edges, built from config_.
+    std::unique_ptr<HashRing> ring_;
+    // Answers GetRow from row_index_ or passes it to the node the row routes to.
+    std::unique_ptr<RowLookup> row_lookup_;
+    // Answers Scan from table_, with the predicates and projection applied there.
+    std::unique_ptr<TableScanner> scanner_;
+    std::string node_id_;
+    // Number of streamed rows routed before the per-edge batches are forwarded.
+    int forward_batch_size_ = DEFAULT_FORWARD_BATCH_SIZE;
 
     json load_config() {
         try {
@@ -87,102 +108,225 @@ public:
         try {
             config_ = load_config();
             std::cout << "NodeB: Configuration loaded successfully" << std::endl;
+            wal_ = std::make_unique<WriteAheadLog>(LOCAL_TABLE_NAME, tableFormat(config_), "NodeB", config_);
+            table_ = std::make_unique<TableWriter>(LOCAL_TABLE_NAME, "NodeB", config_);
+            row_index_ = std::make_unique<RowIndex>(*table_, "NodeB", config_);
+            routing_hash_ = makeRoutingHash(config_.value("hash_policy", "fast"));
+            route_stamp_ = std::make_unique<RouteStamp>(*routing_hash_, "NodeB", config_);
+            node_id_ = config_.value("id", "B");
+            ring_ = std::make_unique<HashRing>(buildHashRing(config_, "B"));
+            channels_ = std::make_unique<ChannelPool>(config_);
+            forwarder_ = std::make_unique<AsyncForwarder>(*channels_, "NodeB", config_);
+            coalescer_ = std::make_unique<EdgeCoalescer>(*forwarder_, "NodeB", config_);
+            row_lookup_ = std::make_unique<RowLookup>(*row_index_, *route_stamp_, *ring_, *channels_, *forwarder_,
+                                                      node_id_, config_);
+            scanner_ = std::make_unique<TableScanner>(*table_, "NodeB", node_id_, config_);
+            forward_batch_size_ = config_.value("forward_batch_size", DEFAULT_FORWARD_BATCH_SIZE);
+            recover();
         } catch (const std::exception& e) {
             std::cerr << "NodeB: Error in constructor: " << e.what() << std::endl;
             throw;
         }
     }
 
+private:
+    // Replay the rows logged since the last checkpoint, then start logging new ones.
+    void recover() {
+        shared_memory_.setDurability(sharedMemoryDurability(config_, wal_->enabled()),
+                                     config_.value("shared_memory_sync_interval_ms",
+                                                   DEFAULT_SHARED_MEMORY_SYNC_INTERVAL_MS));
+        shared_memory_.setHugePages(config_.value("shared_memory_huge_pages", false));
+        wal_->replay([this](const WalRecord& record) {
+            applyWalRecord(record, true, *table_, *row_index_, shared_memory_);
+        });
+        std::vector<uint32_t> positions;
+        for (int slot = 0; slot < 4; slot++) {
+            positions.push_back(static_cast<uint32_t>(shared_memory_.messageCount(slot)));
+        }
+        wal_->start(*table_, *row_index_, positions, [this] { shared_memory_.sync(); });
+    }
+
+    // Ring member that owns a message, from the hash it carries or its payload,
+    // which *route_hash receives. Known before any work is done, so admission
+    // can be checked against that node alone.
+    const std::string& ownerOf(const DataMessage& message, uint64_t* route_hash) {
+        *route_hash = route_stamp_->routeHash(message);
+        return ring_->owner(*route_hash);
+    }
+
+    // Store a row locally and decide where it goes next, given its route_hash.
+    // Sets *edge_id to the edge the row must be forwarded to, or leaves it empty
+    // when the row is handled by NodeB itself.
+    Status routeMessage(const DataMessage& message, uint64_t route_hash, std::string* edge_id) {
+        std::cout << "NodeB: Received data [ID: " << message.id()
+                  << ", Size: " << message.payload().size()
+                  << " bytes, Time: " << message.timestamp() << "]" << std::endl;
+        Status hops = route_stamp_->checkHops(message);
+        if (!hops.ok()) {
+            return hops;
+        }
+
+        // Process the payload as a CSV row; the columns view the payload's own bytes.
+        WalRecord record;
+        splitColumns(message.payload(), NUM_COLS, &record.columns);
+
+        // Extract the first field as the row index.
+        if (parseRowIndex(record.columns[0], &record.row_index)) {
+            record.flags |= WAL_INDEXED;
+        } else {
+            std::cerr << "NodeB: Could not convert first field to integer. Using fallback index." << std::endl;
+            record.row_index = localRowCounter;
+            localRowCounter++;
+        }
+
+        const std::string& owner = ring_->owner(route_hash);
+
+        if (owner == node_id_) {
+            // Local branch: count the row and store its index under NodeB in shared memory.
+            record.slot = 0;
+            record.flags |= WAL_COUNTED;
+        } else {
+            std::cout << "NodeB: Ring owner is Node " << owner
+                      << ", forwarding message " << message.id() << std::endl;
+            int slot = sharedMemoryNode(owner);
+            if (slot >= 0) {
+                // Record the target and the extracted index in shared memory.
+                record.slot = static_cast<int8_t>(slot);
+                record.flags |= WAL_LAST_TARGET;
+            }
+            *edge_id = owner;
+        }
+
+        // Log the row, then save it locally and update shared memory from the log record.
+        wal_->write(&record, [this](const WalRecord& logged) {
+            applyWalRecord(logged, false, *table_, *row_index_, shared_memory_);
+        });
+        if (edge_id->empty()) {
+            std::cout << "NodeB: Handled locally. Stored row index " << record.row_index << " in shared memory." << std::endl;
+        }
+        return Status::OK;
+    }
+
+    // Route one row of a batch or stream, adding it to the outgoing batch of its edge.
+    // Rows that cannot be processed are logged and skipped.
+    void routeIntoBatches(const DataMessage& message, uint64_t route_hash,
+                          std::unordered_map<std::string, DataBatch>* outgoing) {
+        std::string edge_id;
+        Status status = routeMessage(message, route_hash, &edge_id);
+        if (!status.ok()) {
+            std::cerr << "NodeB: Skipping message " << message.id() << ": " << status.error_message() << std::endl;
+            return;
+        }
+        if (!edge_id.empty()) {
+            DataMessage* forwarded = (*outgoing)[edge_id].add_messages();
+            *forwarded = message;
+            RouteStamp::stamp(forwarded, route_hash);
+        }
+    }
+
+public:
     Status PushData(ServerContext* context, const DataMessage* request, Empty* reply) override {
         try {
-            std::cout << "NodeB: Received data [ID: " << request->id()
-                      << ", Size: " << request->payload().size()
-                      << " bytes, Time: " << request->timestamp() << "]" << std::endl;
-    
-            // Process the payload as a CSV row.
-            std::string payload_str = request->payload();
-            std::vector<std::string> columns = splitRow(payload_str, ',');
-            if (columns.size() < NUM_COLS) {
-                columns.resize(NUM_COLS, "");
-            } else if (columns.size() > NUM_COLS) {
-                columns.resize(NUM_COLS);
-            }
-    
-            // Save the row locally.
-            appendRowToCSV(columns);
-    
-            // Extract the first field as the row index.
-            int row_index = 0;
-            try {
-                row_index = std::stoi(columns[0]);
-            } catch (const std::exception& ex) {
-                std::cerr << "NodeB: Could not convert first field to integer. Using fallback index." << std::endl;
-                row_index = localRowCounter;
-                localRowCounter++;
+            uint64_t route_hash = 0;
+            AsyncForwarder::Admission admission(*forwarder_);
+            Status admitted = forwarder_->admit(context, ownerOf(*request, &route_hash), &admission);
+            if (!admitted.ok()) {
+                return admitted;
             }
-    
-            // Compute the SHA-256 hash and get modulo value.
-            unsigned char hash[SHA256_DIGEST_LENGTH];
-            SHA256(reinterpret_cast<const unsigned char*>(payload_str.data()),
-                   payload_str.size(), hash);
-    
-            uint32_t hash_val;
-            std::memcpy(&hash_val, hash, sizeof(uint32_t));
-    
-            // Use modulo 4 to route:
-            // 0 -> NodeB (local), 1 -> NodeC, 2 or 3 -> NodeD.
-            unsigned int mod_val = hash_val % 4;
-            std::cout << "NodeB: Computed hash mod 4 value: " << mod_val << std::endl;
-    
-            if (mod_val == 0) {
-                // Local branch: update shared memory using extracted index.
-                shared_memory_.incrementCounter();
-                shared_memory_.addMessageToNode(row_index, 0);
-                std::cout << "NodeB: Handled locally. Stored row index " << row_index << " in shared memory." << std::endl;
-                return Status::OK;
-            } else if (mod_val == 1) {
-                // Forward to NodeC.
-                std::cout << "NodeB: Mod value is 1, forwarding message " << request->id() << " to Node C" << std::endl;
-                shared_memory_.setLastTarget(1);
-                // Update shared memory with the extracted index.
-                shared_memory_.addMessageToNode(row_index, 1);
-                std::string target_address = config_["edges"][0]["address"];
-                auto channel = grpc::CreateChannel(target_address, grpc::InsecureChannelCredentials());
-                auto stub = DataService::NewStub(channel);
-                ClientContext client_context;
-                Empty response;
-                Status status = stub->PushData(&client_context, *request, &response);
-                if (!status.ok()) {
-                    std::cerr << "NodeB: Failed to forward message " << request->id()
-                              << " to Node C: " << status.error_message() << std::endl;
-                    return Status(grpc::StatusCode::INTERNAL, "Failed to forward message");
-                }
-                return status;
-            } else {
-                // For mod_val 2 or 3, forward to NodeD.
-                std::cout << "NodeB: Mod value is " << mod_val
-                          << ", forwarding message " << request->id() << " to Node D" << std::endl;
-                shared_memory_.setLastTarget(2);
-                // Update shared memory with the extracted index.
-                shared_memory_.addMessageToNode(row_index, 2);
-                std::string target_address = config_["edges"][1]["address"];
-                auto channel = grpc::CreateChannel(target_address, grpc::InsecureChannelCredentials());
-                auto stub = DataService::NewStub(channel);
-                ClientContext client_context;
-                Empty response;
-                Status status = stub->PushData(&client_context, *request, &response);
-                if (!status.ok()) {
-                    std::cerr << "NodeB: Failed to forward message " << request->id()
-                              << " to Node D: " << status.error_message() << std::endl;
-                    return Status(grpc::StatusCode::INTERNAL, "Failed to forward message");
-                }
+            std::string edge_id;
+            Status status = routeMessage(*request, route_hash, &edge_id);
+            if (!status.ok() || edge_id.empty()) {
                 return status;
             }
+            DataMessage forwarded = *request;
+            RouteStamp::stamp(&forwarded, route_hash);
+            return coalescer_->forward(edge_id, forwarded, &admission);
         } catch (const std::exception& e) {
             std::cerr << "NodeB: Error processing message: " << e.what() << std::endl;
             return Status(grpc::StatusCode::INTERNAL, "Error processing message");
         }
     }
+
+    Status PushBatch(ServerContext* context, const DataBatch* request, Empty* reply) override {
+        try {
+            // Admit the batch only if every edge its rows go to has room.
+            std::vector<uint64_t> route_hashes;
+            route_hashes.reserve(request->messages_size());
+            AsyncForwarder::Admission admission(*forwarder_);
+            for (const auto& message : request->messages()) {
+                uint64_t route_hash = 0;
+                Status admitted = forwarder_->admit(context, ownerOf(message, &route_hash), &admission);
+                if (!admitted.ok()) {
+                    return admitted;
+                }
+                route_hashes.push_back(route_hash);
+            }
+            std::cout << "NodeB: Received batch of " << request->messages_size() << " messages" << std::endl;
+            // Re-batch the rows per destination edge and forward each batch in one call.
+            std::unordered_map<std::string, DataBatch> outgoing;
+            for (int i = 0; i < request->messages_size(); i++) {
+                routeIntoBatches(request->messages(i), route_hashes[i], &outgoing);
+            }
+            return forwarder_->forwardAll(outgoing, &admission);
+        } catch (const std::exception& e) {
+            std::cerr << "NodeB: Error processing batch: " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error processing batch");
+        }
+    }
+
+    Status PushStream(ServerContext* context, ServerReader<DataMessage>* reader, Empty* reply) override {
+        try {
+            // Forward in batches of forward_batch_size_ rows as the stream is consumed.
+            // Reading pauses while the edge a row goes to is full, so flow control
+            // throttles the sender.
+            std::unordered_map<std::string, DataBatch> outgoing;
+            Status result = Status::OK;
+            int received = 0;
+            int pending = 0;
+            DataMessage message;
+            while (reader->Read(&message)) {
+                received++;
+                uint64_t route_hash = 0;
+                forwarder_->waitForCapacity(ownerOf(message, &route_hash));
+                routeIntoBatches(message, route_hash, &outgoing);
+                if (++pending >= forward_batch_size_) {
+                    Status status = forwarder_->forwardAll(outgoing);
+                    if (!status.ok()) {
+                        result = status;
+                    }
+                    outgoing.clear();
+                    pending = 0;
+                }
+            }
+            Status status = forwarder_->forwardAll(outgoing);
+            if (!status.ok()) {
+                result = status;
+            }
+            std::cout << "NodeB: Stream finished after " << received << " messages" << std::endl;
+            return result;
+        } catch (const std::exception& e) {
+            std::cerr << "NodeB: Error processing stream: " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error processing stream");
+        }
+    }
+
+    Status GetRow(ServerContext* context, const RowRequest* request, Row* reply) override {
+        try {
+            return row_lookup_->get(*request, reply);
+        } catch (const std::exception& e) {
+            std::cerr << "NodeB: Error looking up row " << request->row_index() << ": " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error looking up row");
+        }
+    }
+
+    Status Scan(ServerContext* context, const ScanRequest* request, ServerWriter<RowBatch>* writer) override {
+        try {
+            return scanner_->scan(context, *request, writer);
+        } catch (const std::exception& e) {
+            std::cerr << "NodeB: Error scanning local table: " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error scanning local table");
+        }
+    }
 };
 
 void RunServer(const std::string& server_address, const std::string& user_id) {
@@ -2,68 +2,57 @@
 #include "data.grpc.pb.h"
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <nlohmann/json.hpp>
 #include <memory>
 #include <cstdlib>
 #include "shared_memory.hpp"  // Uses dynamic shared memory (see our revised version)
-#include <openssl/sha.h>
-#include <cstring>    // For memcpy
+#include "table_writer.hpp"
+#include "channel_pool.hpp"
+#include "async_forwarder.hpp"
+#include "edge_coalescer.hpp"
+#include "handler_pool.hpp"
+#include "routing_hash.hpp"
+#include "hash_ring.hpp"
+#include "route_stamp.hpp"
+#include "row_index.hpp"
+#include "table_scan.hpp"
+#include "wal.hpp"
+#include "csv_row.hpp"
+#include "raw_message.hpp"
+#include <cstring>
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <unordered_map>
 
 using grpc::Server;
 using grpc::ServerBuilder;
 using grpc::ServerContext;
+using grpc::ServerReader;
+using grpc::ServerWriter;
 using grpc::Status;
 using grpc::Channel;
 using grpc::ClientContext;
 using grpc::CreateChannel;
 using data::DataMessage;
+using data::DataBatch;
 using data::Empty;
+using data::Row;
+using data::RowRequest;
+using data::RowBatch;
+using data::ScanRequest;
 using data::DataService;
 using json = nlohmann::json;
 
 // Number of columns expected in the local table.
 const int NUM_COLS = 16;
-// Name of the CSV file used to store rows locally for NodeD.
-const std::string LOCAL_TABLE_FILENAME = "nodeD_table.csv";
+// Name of the table used to store rows locally for NodeD (".csv" or ".seg" is appended).
+const std::string LOCAL_TABLE_NAME = "nodeD_table";
 
 // Global counter for the number of rows saved locally (for NodeD).
 // (This may still be used for logging purposes if desired.)
 static int localRowCounter = 0;
 
-// Helper: Split a string by a given delimiter.
-std::vector<std::string> splitRow(const std::string& row, char delimiter) {
-    std::vector<std::string> tokens;
-    std::istringstream ss(row);
-    std::string token;
-    while (std::getline(ss, token, delimiter)) {
-        tokens.push_back(token);
-    }
-    return tokens;
-}
-
-// Helper: Append a row (vector of strings) to the CSV file.
-void appendRowToCSV(const std::vector<std::string>& row) {
-    std::ofstream outfile;
-    // Open in append mode.
-    outfile.open(LOCAL_TABLE_FILENAME, std::ios::app);
-    if (!outfile.is_open()) {
-        std::cerr << "NodeD: Error opening local table file for writing." << std::endl;
-        return;
-    }
-    // Write the row: join columns with commas.
-    for (size_t i = 0; i < row.size(); i++) {
-        outfile << row[i];
-        if (i < row.size() - 1)
-            outfile << ",";
-    }
-    outfile << "\n";
-    outfile.close();
-}
-
 // Client class for forwarding messages to Node E.
 class DataServiceClient {
  public:
@@ -88,11 +77,43 @@ class DataServiceClient {
   std::unique_ptr<DataService::Stub> stub_;
 };
 
-class DataServiceImpl final : public DataService::Service {
+// PushData is served through the raw (byte-buffer) callback API so rows that
+// only pass through this node are forwarded without being parsed.
+class DataServiceImpl final : public DataService::WithRawCallbackMethod_PushData<DataService::Service> {
 private:
     // Dynamic shared memory instance; its filename is determined by the passed user_id.
     SharedMemory shared_memory_;
     json config_;
+    // Local table kept open for the life of the node.
+    std::unique_ptr<TableWriter> table_;
+    // Primary index of table_ by row_index, reloaded from its stored runs on startup.
+    std::unique_ptr<RowIndex> row_index_;
+    // Log of accepted rows; table_, row_index_ and shared_memory_ are applied from it.
+    std::unique_ptr<WriteAheadLog> wal_;
+    // Long-lived channels/stubs to the downstream edges, built once from config_["edges"].
+    std::unique_ptr<ChannelPool> channels_;
+    // Completion-queue based forwarding engine on top of channels_.
+    std::unique_ptr<AsyncForwarder> forwarder_;
+    // Groups single forwarded rows into per-edge PushBatch calls.
+    std::unique_ptr<EdgeCoalescer> coalescer_;
+    // Routing hash selected by "hash_policy"; must match the other routing nodes.
+    std::unique_ptr<RoutingHash> routing_hash_;
+    // Reuses the routing hash carried in forwarded messages and guards against loops.
+    std::unique_ptr<RouteStamp> route_stamp_;
+    // Consistent-hash ring over NodeD and its edges, built from config_.
+    std::unique_ptr<HashRing> ring_;
+    // Answers GetRow from row_index_ or passes it to the node the row routes to.
+    std::unique_ptr<RowLookup> row_lookup_;
+    // Answers Scan from table_, with the predicates and projection applied there.
+    std::unique_ptr<TableScanner> scanner_;
+    std::string node_id_;
+    // Number of streamed rows routed before the per-edge batches are forwarded.
+    int forward_batch_size_ = DEFAULT_FORWARD_BATCH_SIZE;
+    // Forward rows owned by another node as the bytes they arrived in ("raw_transit").
+    bool raw_transit_ = true;
+    // Runs the PushData work that may block off the callback threads. Declared
+    // last so its queued work finishes before anything it uses is destroyed.
+    std::unique_ptr<HandlerPool> handlers_;
 
     // Load configuration from config.json.
     json load_config() {
@@ -112,88 +133,280 @@ public:
         try {
             config_ = load_config();
             std::cout << "NodeD: Configuration loaded successfully." << std::endl;
+            wal_ = std::make_unique<WriteAheadLog>(LOCAL_TABLE_NAME, tableFormat(config_), "NodeD", config_);
+            table_ = std::make_unique<TableWriter>(LOCAL_TABLE_NAME, "NodeD", config_);
+            row_index_ = std::make_unique<RowIndex>(*table_, "NodeD", config_);
+            routing_hash_ = makeRoutingHash(config_.value("hash_policy", "fast"));
+            route_stamp_ = std::make_unique<RouteStamp>(*routing_hash_, "NodeD", config_);
+            node_id_ = config_.value("id", "D");
+            ring_ = std::make_unique<HashRing>(buildHashRing(config_, "D"));
+            channels_ = std::make_unique<ChannelPool>(config_);
+            forwarder_ = std::make_unique<AsyncForwarder>(*channels_, "NodeD", config_);
+            coalescer_ = std::make_unique<EdgeCoalescer>(*forwarder_, "NodeD", config_);
+            row_lookup_ = std::make_unique<RowLookup>(*row_index_, *route_stamp_, *ring_, *channels_, *forwarder_,
+                                                      node_id_, config_);
+            scanner_ = std::make_unique<TableScanner>(*table_, "NodeD", node_id_, config_);
+            forward_batch_size_ = config_.value("forward_batch_size", DEFAULT_FORWARD_BATCH_SIZE);
+            raw_transit_ = config_.value("raw_transit", true);
+            handlers_ = std::make_unique<HandlerPool>("NodeD", config_);
+            recover();
         } catch (const std::exception& e) {
             std::cerr << "NodeD: Error in constructor: " << e.what() << std::endl;
             throw;
         }
     }
 
-    Status PushData(ServerContext* context, const DataMessage* request, Empty* reply) override {
+private:
+    // Replay the rows logged since the last checkpoint, then start logging new ones.
+    void recover() {
+        shared_memory_.setDurability(sharedMemoryDurability(config_, wal_->enabled()),
+                                     config_.value("shared_memory_sync_interval_ms",
+                                                   DEFAULT_SHARED_MEMORY_SYNC_INTERVAL_MS));
+        shared_memory_.setHugePages(config_.value("shared_memory_huge_pages", false));
+        wal_->replay([this](const WalRecord& record) {
+            applyWalRecord(record, true, *table_, *row_index_, shared_memory_);
+        });
+        std::vector<uint32_t> positions;
+        for (int slot = 0; slot < 4; slot++) {
+            positions.push_back(static_cast<uint32_t>(shared_memory_.messageCount(slot)));
+        }
+        wal_->start(*table_, *row_index_, positions, [this] { shared_memory_.sync(); });
+    }
+
+    // Ring member that owns a message, from the hash it carries or its payload,
+    // which *route_hash receives. Known before any work is done, so admission
+    // can be checked against that node alone.
+    const std::string& ownerOf(const DataMessage& message, uint64_t* route_hash) {
+        *route_hash = route_stamp_->routeHash(message);
+        return ring_->owner(*route_hash);
+    }
+
+    // Process a row this node owns and decide whether it moves on, given its route_hash.
+    // Sets *edge_id to the edge the row must be forwarded to, or leaves it empty
+    // when the row was stored locally.
+    Status routeMessage(const DataMessage& message, uint64_t route_hash, std::string* edge_id) {
+        std::cout << "NodeD: Received data - ID: " << message.id() 
+                  << ", Size: " << message.payload().size() << std::endl;
+
+        Status hops = route_stamp_->checkHops(message);
+        if (!hops.ok()) {
+            return hops;
+        }
+
+        const std::string& owner = ring_->owner(route_hash);
+
+        if (owner == node_id_) {
+            // Data belongs to NodeD: save the row locally and update shared memory.
+            std::cout << "NodeD: Saving data locally in tabular format." << std::endl;
+
+            // Split the row into exactly NUM_COLS columns that view the payload's own bytes.
+            WalRecord record;
+            splitColumns(message.payload(), NUM_COLS, &record.columns);
+
+            // **Extract the first value as the index.**
+            if (parseRowIndex(record.columns[0], &record.row_index)) {
+                record.flags |= WAL_INDEXED;
+            } else {
+                std::cerr << "NodeD: Error converting first column to integer, defaulting to local counter." << std::endl;
+                record.row_index = localRowCounter;
+                localRowCounter++;
+            }
+
+            // Shared memory: increment counter and add the extracted row index for NodeD.
+            record.flags |= WAL_COUNTED;
+            // For NodeD, we use node value 2.
+            record.slot = 2;
+            // Log the row, then append it to the local table and update shared memory from the log record.
+            wal_->write(&record, [this](const WalRecord& logged) {
+                applyWalRecord(logged, false, *table_, *row_index_, shared_memory_);
+            });
+            return Status::OK;
+        }
+        // Another member of the ring owns the row: forward it there.
+        std::cout << "NodeD: Ring owner is Node " << owner
+                  << ", forwarding message " << message.id() << std::endl;
+        *edge_id = owner;
+        return Status::OK;
+    }
+
+    // Route one row of a batch or stream, adding it to the outgoing batch of its edge.
+    // Rows that cannot be processed are logged and skipped.
+    void routeIntoBatches(const DataMessage& message, uint64_t route_hash,
+                          std::unordered_map<std::string, DataBatch>* outgoing) {
+        std::string edge_id;
+        Status status = routeMessage(message, route_hash, &edge_id);
+        if (!status.ok()) {
+            std::cerr << "NodeD: Skipping message " << message.id() << ": " << status.error_message() << std::endl;
+            return;
+        }
+        if (!edge_id.empty()) {
+            DataMessage* forwarded = (*outgoing)[edge_id].add_messages();
+            *forwarded = message;
+            RouteStamp::stamp(forwarded, route_hash);
+        }
+    }
+
+    // Route a parsed message and forward it if another node owns it, taking
+    // over the place `admission` holds for it.
+    Status pushMessage(const DataMessage& message, uint64_t route_hash, AsyncForwarder::Admission* admission) {
+        std::string edge_id;
+        Status status = routeMessage(message, route_hash, &edge_id);
+        if (!status.ok() || edge_id.empty()) {
+            return status;
+        }
+        DataMessage forwarded = message;
+        RouteStamp::stamp(&forwarded, route_hash);
+        return coalescer_->forward(edge_id, forwarded, admission);
+    }
+
+public:
+    // Transit rows (carried hash owned by another node) are passed through as raw
+    // bytes with only hop_count updated; everything else is parsed and routed as
+    // usual on a handler thread, since storing a row waits for its group commit
+    // and forwarding it may, under ack_mode "downstream", wait for the edge.
+    grpc::ServerUnaryReactor* PushData(grpc::CallbackServerContext* context, const grpc::ByteBuffer* request,
+                                       grpc::ByteBuffer* reply) override {
+        grpc::ServerUnaryReactor* reactor = context->DefaultReactor();
+        // An empty buffer is the serialized form of Empty.
+        grpc::Slice empty;
+        *reply = grpc::ByteBuffer(&empty, 1);
         try {
-            std::cout << "NodeD: Received data - ID: " << request->id() 
-                      << ", Size: " << request->payload().size() << std::endl;
-            
-            // Compute SHA‑256 hash of the payload.
-            unsigned char hash[SHA256_DIGEST_LENGTH];
-            SHA256(reinterpret_cast<const unsigned char*>(request->payload().data()),
-                   request->payload().size(), hash);
-            
-            // Convert the first 4 bytes of the hash to a 32‑bit unsigned integer.
-            uint32_t hash_val;
-            std::memcpy(&hash_val, hash, sizeof(uint32_t));
-            
-            // Compute modulo 4 so that valid results are 0, 1, 2, or 3.
-            unsigned int mod_val = hash_val % 4;
-            std::cout << "NodeD: Computed hash mod 4 value: " << mod_val << std::endl;
-            
-            if (mod_val == 2) {
-                // Data belongs to NodeD: save the row locally and update shared memory.
-                std::cout << "NodeD: Mod value is 2, saving data locally in tabular format." << std::endl;
-                
-                // Convert payload to string.
-                std::string payload_str = request->payload();
-                // Split the row using comma as delimiter.
-                std::vector<std::string> columns = splitRow(payload_str, ',');
-                // Ensure there are exactly NUM_COLS columns.
-                if (columns.size() < NUM_COLS) {
-                    columns.resize(NUM_COLS, "");
-                } else if (columns.size() > NUM_COLS) {
-                    columns.resize(NUM_COLS);
+            RouteHeader header;
+            if (!scanRouteHeader(*request, &header)) {
+                reactor->Finish(Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed DataMessage"));
+                return reactor;
+            }
+            if (raw_transit_ && header.has_route_hash && !route_stamp_->verifies()) {
+                Status hops = route_stamp_->checkHops(header.id, header.hop_count);
+                if (!hops.ok()) {
+                    reactor->Finish(hops);
+                    return reactor;
                 }
-                // Append the row to the local CSV file.
-                appendRowToCSV(columns);
-                
-                // **Extract the first value as the index.**
-                int row_index = 0;
-                try {
-                    row_index = std::stoi(columns[0]);
-                } catch (const std::exception& ex) {
-                    std::cerr << "NodeD: Error converting first column to integer, defaulting to local counter." << std::endl;
-                    row_index = localRowCounter;
-                    localRowCounter++;
+                const std::string& owner = ring_->owner(header.route_hash);
+                if (owner != node_id_) {
+                    AsyncForwarder::Admission admission(*forwarder_);
+                    Status admitted = forwarder_->admit(context, owner, &admission);
+                    if (!admitted.ok()) {
+                        reactor->Finish(admitted);
+                        return reactor;
+                    }
+                    std::cout << "NodeD: Ring owner is Node " << owner
+                              << ", passing message " << header.id << " through" << std::endl;
+                    coalescer_->forwardRaw(owner, header.id, withHopCount(*request, header.hop_count + 1),
+                                            [reactor](const Status& status) { reactor->Finish(status); },
+                                            &admission);
+                    return reactor;
                 }
-                
-                // Update shared memory: increment counter and add the extracted row index for NodeD.
-                shared_memory_.incrementCounter();
-                // For NodeD, we use node value 2.
-                shared_memory_.addMessageToNode(row_index, 2);
-                return Status::OK;
-            } else if (mod_val == 3) {
-                // Data belongs to NodeE: forward the message.
-                std::cout << "NodeD: Mod value is 3, forwarding message " << request->id() 
-                          << " to Node E." << std::endl;
-                std::string nodeE_address = config_.value("nodeE_address", "0.0.0.0:50055");
-                auto channel = CreateChannel(nodeE_address, grpc::InsecureChannelCredentials());
-                auto stub = DataService::NewStub(channel);
-                ClientContext client_context;
-                Empty response;
-                Status status = stub->PushData(&client_context, *request, &response);
-                if (!status.ok()) {
-                    std::cerr << "NodeD: Failed to forward message " << request->id() 
-                              << " to Node E: " << status.error_message() << std::endl;
-                    return Status(grpc::StatusCode::INTERNAL, "Failed to forward message");
+            }
+            DataMessage message;
+            if (!parseMessage(*request, &message)) {
+                reactor->Finish(Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed DataMessage"));
+                return reactor;
+            }
+            uint64_t route_hash = 0;
+            // Held by the task, so the row keeps its place until it is forwarded or dropped.
+            auto admission = std::make_shared<AsyncForwarder::Admission>(*forwarder_);
+            Status admitted = forwarder_->admit(context, ownerOf(message, &route_hash), admission.get());
+            if (!admitted.ok()) {
+                reactor->Finish(admitted);
+                return reactor;
+            }
+            bool posted = handlers_->post([this, reactor, message = std::move(message), route_hash, admission] {
+                try {
+                    reactor->Finish(pushMessage(message, route_hash, admission.get()));
+                } catch (const std::exception& e) {
+                    std::cerr << "NodeD: Error processing message: " << e.what() << std::endl;
+                    reactor->Finish(Status(grpc::StatusCode::INTERNAL, "Error processing message"));
                 }
-                return status;
-            } else {
-                // For any other mod value, ignore the message.
-                std::cout << "NodeD: Mod value " << mod_val 
-                          << " does not correspond to Node D or Node E. Ignoring message " 
-                          << request->id() << std::endl;
-                return Status::OK;
+            });
+            if (!posted) {
+                reactor->Finish(forwarder_->reject(context, node_id_));
             }
         } catch (const std::exception& e) {
             std::cerr << "NodeD: Error processing message: " << e.what() << std::endl;
-            return Status(grpc::StatusCode::INTERNAL, "Error processing message");
+            reactor->Finish(Status(grpc::StatusCode::INTERNAL, "Error processing message"));
+        }
+        return reactor;
+    }
+
+    Status PushBatch(ServerContext* context, const DataBatch* request, Empty* reply) override {
+        try {
+            // Admit the batch only if every edge its rows go to has room.
+            std::vector<uint64_t> route_hashes;
+            route_hashes.reserve(request->messages_size());
+            AsyncForwarder::Admission admission(*forwarder_);
+            for (const auto& message : request->messages()) {
+                uint64_t route_hash = 0;
+                Status admitted = forwarder_->admit(context, ownerOf(message, &route_hash), &admission);
+                if (!admitted.ok()) {
+                    return admitted;
+                }
+                route_hashes.push_back(route_hash);
+            }
+            std::cout << "NodeD: Received batch of " << request->messages_size() << " messages" << std::endl;
+            // Re-batch the rows per destination edge and forward each batch in one call.
+            std::unordered_map<std::string, DataBatch> outgoing;
+            for (int i = 0; i < request->messages_size(); i++) {
+                routeIntoBatches(request->messages(i), route_hashes[i], &outgoing);
+            }
+            return forwarder_->forwardAll(outgoing, &admission);
+        } catch (const std::exception& e) {
+            std::cerr << "NodeD: Error processing batch: " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error processing batch");
+        }
+    }
+
+    Status PushStream(ServerContext* context, ServerReader<DataMessage>* reader, Empty* reply) override {
+        try {
+            // Forward in batches of forward_batch_size_ rows as the stream is consumed.
+            // Reading pauses while the edge a row goes to is full, so flow control
+            // throttles the sender.
+            std::unordered_map<std::string, DataBatch> outgoing;
+            Status result = Status::OK;
+            int received = 0;
+            int pending = 0;
+            DataMessage message;
+            while (reader->Read(&message)) {
+                received++;
+                uint64_t route_hash = 0;
+                forwarder_->waitForCapacity(ownerOf(message, &route_hash));
+                routeIntoBatches(message, route_hash, &outgoing);
+                if (++pending >= forward_batch_size_) {
+                    Status status = forwarder_->forwardAll(outgoing);
+                    if (!status.ok()) {
+                        result = status;
+                    }
+                    outgoing.clear();
+                    pending = 0;
+                }
+            }
+            Status status = forwarder_->forwardAll(outgoing);
+            if (!status.ok()) {
+                result = status;
+            }
+            std::cout << "NodeD: Stream finished after " << received << " messages" << std::endl;
+            return result;
+        } catch (const std::exception& e) {
+            std::cerr << "NodeD: Error processing stream: " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error processing stream");
+        }
+    }
+
+    Status GetRow(ServerContext* context, const RowRequest* request, Row* reply) override {
+        try {
+            return row_lookup_->get(*request, reply);
+        } catch (const std::exception& e) {
+            std::cerr << "NodeD: Error looking up row " << request->row_index() << ": " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error looking up row");
+        }
+    }
+
+    Status Scan(ServerContext* context, const ScanRequest* request, ServerWriter<RowBatch>* writer) override {
+        try {
+            return scanner_->scan(context, *request, writer);
+        } catch (const std::exception& e) {
+            std::cerr << "NodeD: Error scanning local table: " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error scanning local table");
         }
     }
 };
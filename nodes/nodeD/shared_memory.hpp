@@ -8,25 +8,71 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 #include <nlohmann/json.hpp>
 #include <sys/stat.h>
+#include <sys/file.h>
 #include <limits.h>
 
 using json = nlohmann::json;
 
-// Default capacities for each dynamic array (adjust as needed)
+// Entries in the message history ring buffer.
 const int DEFAULT_HISTORY_CAPACITY = 1000000;
-const int DEFAULT_B_CAPACITY = 1000000;
-const int DEFAULT_C_CAPACITY = 1000000;
-const int DEFAULT_D_CAPACITY = 1000000;
-const int DEFAULT_E_CAPACITY = 1000000;
+// Entries in the first chunk of each node's array; every further chunk holds
+// twice as many as the one before, so an array grows as far as it is used.
+const int DEFAULT_B_CAPACITY = 1024;
+const int DEFAULT_C_CAPACITY = 1024;
+const int DEFAULT_D_CAPACITY = 1024;
+const int DEFAULT_E_CAPACITY = 1024;
+// Most chunks a node's array can have; its capacity also stays below INT_MAX.
+const int SHARED_MAX_CHUNKS = 32;
+// Stored in the header, so a file written with another layout is refused.
+const int SHARED_LAYOUT = 0x53484d05;
+// Size of a transparent huge page on x86-64 and on arm64 with 4 KiB pages.
+const size_t SHARED_HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+// Default interval between background flushes under "periodic" durability.
+const int DEFAULT_SHARED_MEMORY_SYNC_INTERVAL_MS = 200;
+
+// How far an update must get before it returns.
+enum class SharedMemoryDurability {
+    None,       // left in the page cache until the kernel writes it back or sync() is called
+    Periodic,   // flushed by a background thread every sync interval
+    Dirty       // the pages the update touched are msync'ed before it returns
+};
+
+inline SharedMemoryDurability parseSharedMemoryDurability(const std::string& policy) {
+    if (policy == "none") {
+        return SharedMemoryDurability::None;
+    }
+    if (policy == "periodic") {
+        return SharedMemoryDurability::Periodic;
+    }
+    if (policy == "dirty") {
+        return SharedMemoryDurability::Dirty;
+    }
+    throw std::runtime_error("Unknown shared_memory_durability: " + policy);
+}
+
+// Durability selected by "shared_memory_durability" in a node's config. With a
+// write-ahead log the default is "none": checkpoints sync shared memory and
+// replay restores the updates made since.
+inline SharedMemoryDurability sharedMemoryDurability(const json& config, bool logged) {
+    return parseSharedMemoryDurability(config.value("shared_memory_durability", logged ? "none" : "dirty"));
+}
 
 // Header structure stored at the beginning of the shared memory file.
 // This holds counters, current sizes, and the capacities of each dynamic array.
 struct SharedDataHeader {
     int counter;
     int last_target;      // e.g., 0 for Node C, 1 for Node D, etc.
-    int history_size;
     int b_size;
     int c_size;
     int d_size;
@@ -38,22 +84,101 @@ struct SharedDataHeader {
     int c_capacity;
     int d_capacity;
     int e_capacity;
+    int layout;           // SHARED_LAYOUT
+    // The arrays of messages to each node (B, C, D, E) grow online by
+    // appending chunks to the file: chunk k of array n holds
+    // first_chunk[n] << k entries at file offset chunk_offset[n][k], and the
+    // first chunk_count[n] chunks exist. b_capacity and the like add them up.
+    // Each entry is a 64-bit word (see packEntry); b_size and the like count
+    // the entries reserved, some of which may not be written yet.
+    int first_chunk[4];
+    int chunk_count[4];
+    // The message history is a ring buffer of history_capacity 64-bit
+    // entries. history_count counts every insert ever made: insert n goes to
+    // entry n % history_capacity, tagged with its lap (see historyLap), so
+    // the newest min(history_count, history_capacity) inserts are kept.
+    int64_t history_count;
+    int64_t chunk_offset[4][SHARED_MAX_CHUNKS];
+};
+
+// Atomic view of an int in the mapping, shared by the node's handler threads
+// and by every other process mapping the same file. Header fields and array
+// entries are naturally aligned ints, so the operations are lock-free and
+// work across processes. Stands in for C++20 std::atomic_ref<int>.
+class AtomicIntRef {
+public:
+    explicit AtomicIntRef(int& value) : value_(&value) {}
+
+    int load() const {
+        return __atomic_load_n(value_, __ATOMIC_ACQUIRE);
+    }
+
+    void store(int desired) const {
+        __atomic_store_n(value_, desired, __ATOMIC_RELEASE);
+    }
+
+    int fetch_add(int arg) const {
+        return __atomic_fetch_add(value_, arg, __ATOMIC_ACQ_REL);
+    }
+
+    bool compare_exchange_weak(int& expected, int desired) const {
+        return __atomic_compare_exchange_n(value_, &expected, desired, true, __ATOMIC_ACQ_REL,
+                                           __ATOMIC_ACQUIRE);
+    }
+
+private:
+    int* value_;
 };
 
+// Array entries pair a message id (low 32 bits) with a tag (high 32 bits) in
+// one 64-bit word, stored and loaded atomically, so a reader sees both or
+// neither. A tag of 0 means the entry was never written: it is still a hole in
+// the file, or its writer has reserved it and not stored it yet (or crashed).
+inline uint64_t packEntry(uint32_t tag, int message_id) {
+    return (static_cast<uint64_t>(tag) << 32) | static_cast<uint32_t>(message_id);
+}
+
+inline uint32_t entryTag(uint64_t word) {
+    return static_cast<uint32_t>(word >> 32);
+}
+
+inline int entryMessageId(uint64_t word) {
+    return static_cast<int>(static_cast<uint32_t>(word));
+}
+
+// Tag of a written entry in a node's array.
+const uint32_t SHARED_ENTRY_FILLED = 1;
+
+// Tag of history insert `insert`: the lap of the ring it was made on, counted
+// from 1, so an entry left from an earlier lap (or never written) is told
+// apart from the one a reader expects.
+inline uint32_t historyLap(int64_t insert, int capacity) {
+    return static_cast<uint32_t>(insert / capacity + 1);
+}
+
 class SharedMemory {
 private:
     std::string filename_;
     int fd_;
     void* mapped_;
     size_t size_;
+    SharedMemoryDurability durability_ = SharedMemoryDurability::Dirty;
+    std::chrono::milliseconds sync_interval_{DEFAULT_SHARED_MEMORY_SYNC_INTERVAL_MS};
+    uintptr_t page_mask_ = ~static_cast<uintptr_t>(sysconf(_SC_PAGESIZE) - 1);
+    // Periodic durability: set by updates, cleared by the flusher.
+    std::atomic<bool> dirty_{false};
+    std::mutex flush_mutex_;
+    std::condition_variable flush_cv_;
+    bool stop_flusher_ = false;
+    std::thread flusher_;
 
-    // Pointers into the mapped memory.
+    // Pointers into the mapped memory: the header and history mapping, then
+    // the chunks of each node's array, each mapped on first use.
     SharedDataHeader* header_;
-    int* message_history_;
-    int* messages_to_b_;
-    int* messages_to_c_;
-    int* messages_to_d_;
-    int* messages_to_e_;
+    uint64_t* message_history_;
+    mutable std::atomic<uint64_t*> chunks_[4][SHARED_MAX_CHUNKS] = {};
+    mutable std::mutex chunk_mutex_;      // maps and adds chunks
+    bool huge_pages_ = false;             // advise huge pages for new chunks
 
     void initialize() {
         // Get current working directory to build an absolute path.
@@ -77,38 +202,43 @@ private:
             throw std::runtime_error("Failed to open file");
         }
 
-        // Calculate total size: header plus space for all dynamic arrays.
-        size_ = sizeof(SharedDataHeader) +
-                (DEFAULT_HISTORY_CAPACITY +
-                 DEFAULT_B_CAPACITY +
-                 DEFAULT_C_CAPACITY +
-                 DEFAULT_D_CAPACITY +
-                 DEFAULT_E_CAPACITY) * sizeof(int);
+        // Nodes sharing the file may start together. Whoever gets the lock
+        // first creates it; the others see it only once its header is written.
+        flock(fd_, LOCK_EX);
+        file_exists = fstat(fd_, &st) == 0 && st.st_size > 0;
 
-        // If the file is new, set its size; otherwise use existing size.
+        // The header and the history come first; chunks of the node arrays are
+        // appended behind them as the arrays grow.
+        size_ = pageAligned(sizeof(SharedDataHeader) + DEFAULT_HISTORY_CAPACITY * sizeof(uint64_t));
         if (!file_exists) {
             if (ftruncate(fd_, size_) == -1) {
                 close(fd_);
                 throw std::runtime_error("Failed to set file size");
             }
         } else {
-            size_ = st.st_size;
+            // A file written with another header layout (before the arrays
+            // could grow, say) would be misread.
+            SharedDataHeader header;
+            if (pread(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+                header.layout != SHARED_LAYOUT) {
+                close(fd_);
+                throw std::runtime_error("Shared memory file " + abs_path + " has an older layout; delete it");
+            }
+            size_ = pageAligned(sizeof(SharedDataHeader) + header.history_capacity * sizeof(uint64_t));
         }
 
-        // Map the file into memory.
-        mapped_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        mapped_ = mapShared(fd_, size_, 0);
         if (mapped_ == MAP_FAILED) {
             close(fd_);
             throw std::runtime_error("Failed to map file");
         }
 
-        // The header is stored at the beginning.
         header_ = static_cast<SharedDataHeader*>(mapped_);
-        // Initialize the header if the file is new.
+        // Initialize the header if the file is new. The node arrays start
+        // without chunks; the first is added with the first message.
         if (!file_exists) {
             header_->counter = 0;
             header_->last_target = -1;
-            header_->history_size = 0;
             header_->b_size = 0;
             header_->c_size = 0;
             header_->d_size = 0;
@@ -116,20 +246,248 @@ private:
             header_->last_even_id = 0;
             header_->last_odd_id = 0;
             header_->history_capacity = DEFAULT_HISTORY_CAPACITY;
-            header_->b_capacity = DEFAULT_B_CAPACITY;
-            header_->c_capacity = DEFAULT_C_CAPACITY;
-            header_->d_capacity = DEFAULT_D_CAPACITY;
-            header_->e_capacity = DEFAULT_E_CAPACITY;
-            msync(mapped_, size_, MS_SYNC);
+            header_->b_capacity = 0;
+            header_->c_capacity = 0;
+            header_->d_capacity = 0;
+            header_->e_capacity = 0;
+            header_->layout = SHARED_LAYOUT;
+            header_->first_chunk[0] = DEFAULT_B_CAPACITY;
+            header_->first_chunk[1] = DEFAULT_C_CAPACITY;
+            header_->first_chunk[2] = DEFAULT_D_CAPACITY;
+            header_->first_chunk[3] = DEFAULT_E_CAPACITY;
+            header_->history_count = 0;
+            // Only the header was written; the history pages stay holes in
+            // the file until an entry lands on them.
+            syncRange(header_, sizeof(SharedDataHeader));
         }
 
-        // Set pointers to dynamic arrays.
-        char* base = static_cast<char*>(mapped_);
-        message_history_ = reinterpret_cast<int*>(base + sizeof(SharedDataHeader));
-        messages_to_b_ = message_history_ + header_->history_capacity;
-        messages_to_c_ = messages_to_b_ + header_->b_capacity;
-        messages_to_d_ = messages_to_c_ + header_->c_capacity;
-        messages_to_e_ = messages_to_d_ + header_->d_capacity;
+        flock(fd_, LOCK_UN);
+
+        message_history_ = reinterpret_cast<uint64_t*>(static_cast<char*>(mapped_) + sizeof(SharedDataHeader));
+    }
+
+    // msync the pages holding [start, start + length).
+    void syncRange(const void* start, size_t length) {
+        uintptr_t first = reinterpret_cast<uintptr_t>(start) & page_mask_;
+        uintptr_t end = reinterpret_cast<uintptr_t>(start) + length;
+        msync(reinterpret_cast<void*>(first), end - first, MS_SYNC);
+    }
+
+    // Make an update to the header and to [start, start + length) as durable as
+    // the policy asks. Under "dirty" only the pages it touched are written back.
+    void syncUpdate(const void* start = nullptr, size_t length = 0) {
+        switch (durability_) {
+            case SharedMemoryDurability::Dirty:
+                syncRange(header_, sizeof(SharedDataHeader));
+                if (length > 0) {
+                    syncRange(start, length);
+                }
+                break;
+            case SharedMemoryDurability::Periodic:
+                dirty_.store(true, std::memory_order_relaxed);
+                break;
+            case SharedMemoryDurability::None:
+                break;
+        }
+    }
+
+    // Reserve the next free index of an array holding `size` entries, or -1
+    // if it is full. Concurrent writers each get a different index, and size
+    // never passes capacity.
+    static int reserveSlot(int& size, int capacity) {
+        AtomicIntRef ref(size);
+        int current = ref.load();
+        while (current < capacity) {
+            if (ref.compare_exchange_weak(current, current + 1)) {
+                return current;
+            }
+        }
+        return -1;
+    }
+
+    // Raise `size` to at least `value`.
+    static void raiseTo(int& size, int value) {
+        AtomicIntRef ref(size);
+        int current = ref.load();
+        while (current < value && !ref.compare_exchange_weak(current, value)) {
+        }
+    }
+
+    // Ask for transparent huge pages behind a mapping. For a shared file
+    // mapping the kernel only honours this on a file system that supports
+    // them, such as tmpfs.
+    static bool adviseHugePages(void* start, size_t length) {
+#ifdef MADV_HUGEPAGE
+        return madvise(start, length, MADV_HUGEPAGE) == 0;
+#else
+        (void)start;
+        (void)length;
+        return false;
+#endif
+    }
+
+    // Map `length` bytes of the file at `offset`. A range of at least a huge
+    // page that starts on a huge page boundary in the file is placed on one in
+    // memory too, as a transparent huge page needs both: a slightly larger
+    // range is reserved, the file is mapped over its aligned part and the
+    // rest is unmapped again. MAP_FAILED on failure.
+    static void* mapShared(int fd, size_t length, off_t offset) {
+        if (length < SHARED_HUGE_PAGE_BYTES || offset % SHARED_HUGE_PAGE_BYTES != 0) {
+            return mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+        }
+        size_t reserved = length + SHARED_HUGE_PAGE_BYTES;
+        void* range = mmap(nullptr, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (range == MAP_FAILED) {
+            return MAP_FAILED;
+        }
+        char* start = static_cast<char*>(range);
+        char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(start) + SHARED_HUGE_PAGE_BYTES - 1) &
+                                                ~static_cast<uintptr_t>(SHARED_HUGE_PAGE_BYTES - 1));
+        void* mapped = mmap(aligned, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, offset);
+        if (mapped == MAP_FAILED) {
+            munmap(range, reserved);
+            return MAP_FAILED;
+        }
+        if (aligned > start) {
+            munmap(start, aligned - start);
+        }
+        if (aligned + length < start + reserved) {
+            munmap(aligned + length, start + reserved - (aligned + length));
+        }
+        return mapped;
+    }
+
+    size_t pageAligned(size_t bytes) const {
+        return (bytes + ~page_mask_) & page_mask_;
+    }
+
+    int* sizeField(int node) const {
+        switch (node) {
+            case 0: return &header_->b_size;
+            case 1: return &header_->c_size;
+            case 2: return &header_->d_size;
+            case 3: return &header_->e_size;
+            default: return nullptr;
+        }
+    }
+
+    int* capacityField(int node) const {
+        switch (node) {
+            case 0: return &header_->b_capacity;
+            case 1: return &header_->c_capacity;
+            case 2: return &header_->d_capacity;
+            case 3: return &header_->e_capacity;
+            default: return nullptr;
+        }
+    }
+
+    size_t chunkBytes(int node, int chunk) const {
+        return (static_cast<size_t>(header_->first_chunk[node]) << chunk) * sizeof(uint64_t);
+    }
+
+    // Chunk `k` of a node's array, mapped on first use; it must be in the file.
+    uint64_t* chunk(int node, int k) const {
+        uint64_t* entries = chunks_[node][k].load(std::memory_order_acquire);
+        if (entries != nullptr) {
+            return entries;
+        }
+        std::lock_guard<std::mutex> lock(chunk_mutex_);
+        entries = chunks_[node][k].load(std::memory_order_relaxed);
+        if (entries == nullptr) {
+            off_t offset = __atomic_load_n(&header_->chunk_offset[node][k], __ATOMIC_ACQUIRE);
+            void* mapped = mapShared(fd_, chunkBytes(node, k), offset);
+            if (mapped == MAP_FAILED) {
+                throw std::runtime_error("Failed to map shared memory chunk");
+            }
+            entries = static_cast<uint64_t*>(mapped);
+            if (huge_pages_) {
+                adviseHugePages(mapped, chunkBytes(node, k));
+            }
+            chunks_[node][k].store(entries, std::memory_order_release);
+        }
+        return entries;
+    }
+
+    // Entry `index` of a node's array, which must be below its capacity.
+    uint64_t* entry(int node, int index) const {
+        int64_t first = header_->first_chunk[node];
+        int k = 63 - __builtin_clzll(static_cast<uint64_t>(index / first + 1));
+        return chunk(node, k) + (index - first * ((int64_t(1) << k) - 1));
+    }
+
+    // Append a chunk to a node's array, which held `capacity` entries when the
+    // caller found it too small. Other threads and processes may be growing it
+    // too; the file lock lets one of them add the chunk and the rest see it.
+    // False if the array is as large as it can get.
+    bool grow(int node, int capacity) {
+        std::lock_guard<std::mutex> lock(chunk_mutex_);
+        flock(fd_, LOCK_EX);
+        AtomicIntRef total(*capacityField(node));
+        bool grown = true;
+        if (total.load() <= capacity) {
+            int k = AtomicIntRef(header_->chunk_count[node]).load();
+            int64_t first = header_->first_chunk[node];
+            struct stat st;
+            if (k >= SHARED_MAX_CHUNKS || first * ((int64_t(1) << (k + 1)) - 1) > INT_MAX ||
+                fstat(fd_, &st) != 0) {
+                grown = false;
+            } else {
+                off_t offset = pageAligned(st.st_size);
+                // A huge page can only back a chunk whose file offset is
+                // aligned to one.
+                if (huge_pages_ && chunkBytes(node, k) >= SHARED_HUGE_PAGE_BYTES) {
+                    offset = (offset + SHARED_HUGE_PAGE_BYTES - 1) & ~static_cast<off_t>(SHARED_HUGE_PAGE_BYTES - 1);
+                }
+                if (ftruncate(fd_, offset + chunkBytes(node, k)) != 0) {
+                    grown = false;
+                } else {
+                    __atomic_store_n(&header_->chunk_offset[node][k], offset, __ATOMIC_RELEASE);
+                    AtomicIntRef(header_->chunk_count[node]).store(k + 1);
+                    total.store(static_cast<int>(first * ((int64_t(1) << (k + 1)) - 1)));
+                }
+            }
+        }
+        flock(fd_, LOCK_UN);
+        if (!grown) {
+            std::cerr << "Shared memory array " << node << " cannot grow past " << capacity
+                      << " entries" << std::endl;
+        }
+        return grown;
+    }
+
+    // Make room for entry `index` of a node's array. False if it cannot grow that far.
+    bool reserveCapacity(int node, int index) {
+        int capacity;
+        while (index >= (capacity = AtomicIntRef(*capacityField(node)).load())) {
+            if (!grow(node, capacity)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void flushLoop() {
+        std::unique_lock<std::mutex> lock(flush_mutex_);
+        bool stopping = false;
+        while (!stopping) {
+            stopping = flush_cv_.wait_for(lock, sync_interval_, [this] { return stop_flusher_; });
+            if (dirty_.exchange(false)) {
+                sync();
+            }
+        }
+    }
+
+    void stopFlusher() {
+        if (!flusher_.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(flush_mutex_);
+            stop_flusher_ = true;
+        }
+        flush_cv_.notify_all();
+        flusher_.join();
+        stop_flusher_ = false;
     }
 
 public:
@@ -139,6 +497,14 @@ public:
     }
 
     ~SharedMemory() {
+        stopFlusher();
+        for (int node = 0; node < 4; node++) {
+            for (int k = 0; k < SHARED_MAX_CHUNKS; k++) {
+                if (uint64_t* entries = chunks_[node][k].load()) {
+                    munmap(entries, chunkBytes(node, k));
+                }
+            }
+        }
         if (mapped_ != MAP_FAILED) {
             munmap(mapped_, size_);
         }
@@ -148,99 +514,201 @@ public:
     }
 
     void incrementCounter() {
-        header_->counter++;
-        msync(mapped_, size_, MS_SYNC);
+        AtomicIntRef(header_->counter).fetch_add(1);
+        syncUpdate();
     }
 
     int getCounter() const {
-        return header_->counter;
+        return AtomicIntRef(header_->counter).load();
     }
 
+    // Append message_id to the history, overwriting the oldest entry once it
+    // is full. The entry only moves forward a lap: a writer overtaken by one a
+    // lap ahead on the same entry leaves that newer insert in place.
     void updateMessageHistory(int message_id) {
-        if (header_->history_size < header_->history_capacity) {
-            message_history_[header_->history_size] = message_id;
-            header_->history_size++;
-        } else {
-            // Shift elements left (circular buffer approach) if full.
-            memmove(message_history_, message_history_ + 1, (header_->history_capacity - 1) * sizeof(int));
-            message_history_[header_->history_capacity - 1] = message_id;
+        int capacity = header_->history_capacity;
+        int64_t insert = __atomic_fetch_add(&header_->history_count, 1, __ATOMIC_ACQ_REL);
+        uint32_t lap = historyLap(insert, capacity);
+        uint64_t* stored = &message_history_[insert % capacity];
+        uint64_t word = __atomic_load_n(stored, __ATOMIC_ACQUIRE);
+        while (entryTag(word) < lap &&
+               !__atomic_compare_exchange_n(stored, &word, packEntry(lap, message_id), true, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE)) {
         }
-        msync(mapped_, size_, MS_SYNC);
+        syncUpdate(stored, sizeof(uint64_t));
+    }
+
+    // The history, oldest first. Its bounds come from history_count alone;
+    // an entry whose lap does not match (not written yet, or already
+    // overwritten by a newer insert) is left out.
+    std::vector<int> messageHistory() const {
+        int capacity = header_->history_capacity;
+        int64_t count = __atomic_load_n(&header_->history_count, __ATOMIC_ACQUIRE);
+        std::vector<int> history;
+        for (int64_t insert = count > capacity ? count - capacity : 0; insert < count; ++insert) {
+            uint64_t word = __atomic_load_n(&message_history_[insert % capacity], __ATOMIC_ACQUIRE);
+            if (entryTag(word) == historyLap(insert, capacity)) {
+                history.push_back(entryMessageId(word));
+            }
+        }
+        return history;
     }
 
+    // Write message_id into an entry of a node's array, marking it filled.
+    void storeEntry(int node, int index, int message_id) {
+        uint64_t* stored = entry(node, index);
+        __atomic_store_n(stored, packEntry(SHARED_ENTRY_FILLED, message_id), __ATOMIC_RELEASE);
+        syncUpdate(stored, sizeof(uint64_t));
+    }
+
+    // Append message_id to a node's array, growing it when full. The size is
+    // raised when the entry is reserved, before it is written; readers skip
+    // entries that are not filled yet.
     void addMessageToNode(int message_id, int node) {
-        switch (node) {
-            case 0: // Node B
-                if (header_->b_size < header_->b_capacity) {
-                    messages_to_b_[header_->b_size] = message_id;
-                    header_->b_size++;
-                }
-                break;
-            case 1: // Node C
-                if (header_->c_size < header_->c_capacity) {
-                    messages_to_c_[header_->c_size] = message_id;
-                    header_->c_size++;
-                    header_->last_odd_id = message_id;
-                }
-                break;
-            case 2: // Node D
-                if (header_->d_size < header_->d_capacity) {
-                    messages_to_d_[header_->d_size] = message_id;
-                    header_->d_size++;
-                    header_->last_even_id = message_id;
-                }
-                break;
-            case 3: // Node E
-                if (header_->e_size < header_->e_capacity) {
-                    messages_to_e_[header_->e_size] = message_id;
-                    header_->e_size++;
-                }
-                break;
+        int* size = sizeField(node);
+        if (size == nullptr) {
+            return;
         }
-        msync(mapped_, size_, MS_SYNC);
+        int index;
+        int capacity;
+        while ((index = reserveSlot(*size, capacity = AtomicIntRef(*capacityField(node)).load())) < 0) {
+            if (!grow(node, capacity)) {
+                return;
+            }
+        }
+        if (node == 1) {
+            AtomicIntRef(header_->last_odd_id).store(message_id);
+        } else if (node == 2) {
+            AtomicIntRef(header_->last_even_id).store(message_id);
+        }
+        storeEntry(node, index, message_id);
     }
 
     void setLastTarget(int target) {
-        header_->last_target = target;
-        msync(mapped_, size_, MS_SYNC);
+        AtomicIntRef(header_->last_target).store(target);
+        syncUpdate();
     }
 
-    json toJson() const {
-        json j;
-        j["counter"] = header_->counter;
-        j["last_target"] = header_->last_target;
-        j["history_size"] = header_->history_size;
-        j["b_size"] = header_->b_size;
-        j["c_size"] = header_->c_size;
-        j["d_size"] = header_->d_size;
-        j["e_size"] = header_->e_size;
-        j["last_even_id"] = header_->last_even_id;
-        j["last_odd_id"] = header_->last_odd_id;
+    // Choose how updates reach the file; sync_interval_ms is only used by
+    // "periodic".
+    void setDurability(SharedMemoryDurability durability,
+                       int sync_interval_ms = DEFAULT_SHARED_MEMORY_SYNC_INTERVAL_MS) {
+        stopFlusher();
+        durability_ = durability;
+        sync_interval_ = std::chrono::milliseconds(sync_interval_ms < 1 ? 1 : sync_interval_ms);
+        if (durability_ == SharedMemoryDurability::Periodic) {
+            flusher_ = std::thread(&SharedMemory::flushLoop, this);
+        }
+    }
 
-        j["message_history"] = json::array();
-        for (int i = 0; i < header_->history_size; ++i) {
-            j["message_history"].push_back(message_history_[i]);
+    // Back the mappings with transparent huge pages where the kernel allows
+    // it, to cut TLB misses for tenants with large arrays. Chunks mapped or
+    // added afterwards are advised and aligned for them too.
+    void setHugePages(bool enabled) {
+        std::lock_guard<std::mutex> lock(chunk_mutex_);
+        huge_pages_ = enabled;
+        if (!enabled) {
+            return;
+        }
+        bool advised = adviseHugePages(mapped_, size_);
+        for (int node = 0; node < 4; node++) {
+            for (int k = 0; k < SHARED_MAX_CHUNKS; k++) {
+                if (uint64_t* entries = chunks_[node][k].load(std::memory_order_relaxed)) {
+                    adviseHugePages(entries, chunkBytes(node, k));
+                }
+            }
+        }
+        if (!advised) {
+            std::cerr << "Huge pages are not available for shared memory file " << filename_ << std::endl;
         }
+    }
 
-        j["messages_to_b"] = json::array();
-        for (int i = 0; i < header_->b_size; ++i) {
-            j["messages_to_b"].push_back(messages_to_b_[i]);
+    // Flush everything mapped to the file.
+    void sync() {
+        msync(mapped_, size_, MS_SYNC);
+        for (int node = 0; node < 4; node++) {
+            for (int k = 0; k < SHARED_MAX_CHUNKS; k++) {
+                if (uint64_t* entries = chunks_[node][k].load(std::memory_order_acquire)) {
+                    msync(entries, chunkBytes(node, k), MS_SYNC);
+                }
+            }
         }
+    }
 
-        j["messages_to_c"] = json::array();
-        for (int i = 0; i < header_->c_size; ++i) {
-            j["messages_to_c"].push_back(messages_to_c_[i]);
+    // Number of message ids stored for a node (0 = B, 1 = C, 2 = D, 3 = E).
+    int messageCount(int node) const {
+        switch (node) {
+            case 0: return AtomicIntRef(header_->b_size).load();
+            case 1: return AtomicIntRef(header_->c_size).load();
+            case 2: return AtomicIntRef(header_->d_size).load();
+            case 3: return AtomicIntRef(header_->e_size).load();
+            default: return 0;
         }
+    }
 
-        j["messages_to_d"] = json::array();
-        for (int i = 0; i < header_->d_size; ++i) {
-            j["messages_to_d"].push_back(messages_to_d_[i]);
+    // Store message_id at a fixed position of a node's array, growing its size
+    // to cover it. Positions are handed out in one order and may be stored in
+    // another, so the size can cover entries not filled yet; hasMessageAt()
+    // tells them apart. Storing the same id at the same position again
+    // changes nothing, so a replayed log entry is harmless.
+    void setMessageAt(int node, int position, int message_id) {
+        int* size = sizeField(node);
+        if (size == nullptr || position < 0 || !reserveCapacity(node, position)) {
+            return;
         }
+        if (node == 1) {
+            AtomicIntRef(header_->last_odd_id).store(message_id);
+        } else if (node == 2) {
+            AtomicIntRef(header_->last_even_id).store(message_id);
+        }
+        raiseTo(*size, position + 1);
+        storeEntry(node, position, message_id);
+    }
 
-        j["messages_to_e"] = json::array();
-        for (int i = 0; i < header_->e_size; ++i) {
-            j["messages_to_e"].push_back(messages_to_e_[i]);
+    // True if the entry at `position` of a node's array has been written.
+    bool hasMessageAt(int node, int position) const {
+        int* capacity = capacityField(node);
+        if (capacity == nullptr || position < 0 || position >= AtomicIntRef(*capacity).load()) {
+            return false;
+        }
+        return entryTag(__atomic_load_n(entry(node, position), __ATOMIC_ACQUIRE)) != 0;
+    }
+
+    // Message ids written to a node's array, in position order. Entries that
+    // are reserved but not filled yet are left out.
+    std::vector<int> messagesTo(int node) const {
+        std::vector<int> messages;
+        for (int i = 0, size = messageCount(node); i < size; ++i) {
+            uint64_t word = __atomic_load_n(entry(node, i), __ATOMIC_ACQUIRE);
+            if (entryTag(word) != 0) {
+                messages.push_back(entryMessageId(word));
+            }
         }
+        return messages;
+    }
+
+    json toJson() const {
+        json j;
+        j["counter"] = AtomicIntRef(header_->counter).load();
+        j["last_target"] = AtomicIntRef(header_->last_target).load();
+        j["b_size"] = AtomicIntRef(header_->b_size).load();
+        j["c_size"] = AtomicIntRef(header_->c_size).load();
+        j["d_size"] = AtomicIntRef(header_->d_size).load();
+        j["e_size"] = AtomicIntRef(header_->e_size).load();
+        j["last_even_id"] = AtomicIntRef(header_->last_even_id).load();
+        j["last_odd_id"] = AtomicIntRef(header_->last_odd_id).load();
+
+        std::vector<int> history = messageHistory();
+        j["history_size"] = history.size();
+        j["message_history"] = history;
+
+        j["messages_to_b"] = messagesTo(0);
+
+        j["messages_to_c"] = messagesTo(1);
+
+        j["messages_to_d"] = messagesTo(2);
+
+        j["messages_to_e"] = messagesTo(3);
 
         return j;
     }
@@ -1,41 +1,147 @@
 #include <iostream>
+#include <fstream>
+#include <map>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 #include <grpcpp/grpcpp.h>
 #include "data.grpc.pb.h"
+#include "data_client.hpp"
+#include "routing_client.hpp"
 
-using grpc::Channel;
-using grpc::ClientContext;
-using grpc::Status;
-using data::DataService;
 using data::DataMessage;
-using data::Empty;
 
-class DataClient {
-public:
-    DataClient(std::shared_ptr<Channel> channel)
-        : stub_(DataService::NewStub(channel)) {}
+// Send every row of a CSV file straight to the node that owns it.
+int pushTable(const std::string& table_path, const std::string& rows_path) {
+    RoutingClient client(loadRoutingTable(table_path));
 
-    bool PushData(const DataMessage& message) {
-        Empty reply;
-        ClientContext context;
+    std::ifstream rows(rows_path);
+    if (!rows.is_open()) {
+        std::cerr << "Client: Failed to open " << rows_path << std::endl;
+        return 1;
+    }
+    std::string line;
+    int id = 0;
+    int failed = 0;
+    while (std::getline(rows, line)) {
+        DataMessage message;
+        message.set_id(++id);
+        message.set_payload(line);
+        message.set_timestamp("2024-03-21T12:00:00Z");
+        grpc::Status status = client.push(message);
+        if (!status.ok()) {
+            std::cerr << "Client: Row " << id << " failed: " << status.error_message() << std::endl;
+            failed++;
+        }
+    }
+    std::cout << "Client: Sent " << (id - failed) << " of " << id << " rows" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
 
-        Status status = stub_->PushData(&context, message, &reply);
+// Fetch one row by row_index and print it as a CSV line.
+int getRow(const std::string& table_path, int row_index) {
+    RoutingClient client(loadRoutingTable(table_path));
+    data::Row row;
+    grpc::Status status = client.getRow(row_index, &row);
+    if (!status.ok()) {
+        std::cerr << "Client: Row " << row_index << ": " << status.error_message() << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < row.columns_size(); i++) {
+        std::cout << (i > 0 ? "," : "") << row.columns(i);
+    }
+    std::cout << std::endl;
+    std::cerr << "Client: Row " << row_index << " served by Node " << row.node() << std::endl;
+    return 0;
+}
 
-        if (!status.ok()) {
-            std::cerr << "NodeE: RPC failed: " << status.error_message() << std::endl;
+// Parse a scan condition: "<column>=<value>" for equality, "<column>:<min>..<max>"
+// for an inclusive range (either bound may be left out) or "<column>^<prefix>".
+bool parsePredicate(const std::string& text, data::Predicate* predicate) {
+    size_t op = text.find_first_of("=:^");
+    if (op == 0 || op == std::string::npos || text.find_first_not_of("0123456789") != op) {
+        return false;
+    }
+    predicate->set_column(static_cast<uint32_t>(std::stoul(text.substr(0, op))));
+    std::string value = text.substr(op + 1);
+    if (text[op] == '=') {
+        predicate->set_equals(value);
+    } else if (text[op] == '^') {
+        predicate->set_prefix(value);
+    } else {
+        size_t dots = value.find("..");
+        if (dots == std::string::npos) {
             return false;
         }
-        return true;
+        data::Range* range = predicate->mutable_range();
+        if (dots > 0) {
+            range->set_min(value.substr(0, dots));
+        }
+        if (dots + 2 < value.size()) {
+            range->set_max(value.substr(dots + 2));
+        }
     }
+    return true;
+}
 
-private:
-    std::unique_ptr<DataService::Stub> stub_;
-};
+// Scan the nodes' tables and print the matching rows as CSV lines.
+// Arguments: [--node id] [--columns c,c,...] [--limit n] condition...
+int scanTables(const std::string& table_path, const std::vector<std::string>& args) {
+    data::ScanRequest request;
+    std::string only;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--node" && i + 1 < args.size()) {
+            only = args[++i];
+        } else if (args[i] == "--columns" && i + 1 < args.size()) {
+            std::stringstream columns(args[++i]);
+            std::string column;
+            while (std::getline(columns, column, ',')) {
+                request.add_columns(static_cast<uint32_t>(std::stoul(column)));
+            }
+        } else if (args[i] == "--limit" && i + 1 < args.size()) {
+            request.set_limit(std::stoull(args[++i]));
+        } else if (!parsePredicate(args[i], request.add_predicates())) {
+            std::cerr << "Client: Bad scan condition " << args[i] << std::endl;
+            return 1;
+        }
+    }
+    RoutingClient client(loadRoutingTable(table_path));
+    std::map<std::string, uint64_t> per_node;
+    grpc::Status status = client.scan(request, [&](const data::Row& row, const std::string& node) {
+        for (int i = 0; i < row.columns_size(); i++) {
+            std::cout << (i > 0 ? "," : "") << row.columns(i);
+        }
+        std::cout << '\n';
+        per_node[node]++;
+    }, only);
+    std::cout << std::flush;
+    uint64_t total = 0;
+    std::cerr << "Client: Scan returned";
+    for (const auto& entry : per_node) {
+        std::cerr << " " << entry.second << " rows from Node " << entry.first << ",";
+        total += entry.second;
+    }
+    std::cerr << " " << total << " in all" << std::endl;
+    return status.ok() ? 0 : 1;
+}
 
 int main(int argc, char** argv) {
+    if (argc == 4 && std::string(argv[1]) == "--table") {
+        return pushTable(argv[2], argv[3]);
+    }
+    if (argc == 4 && std::string(argv[1]) == "--get") {
+        return getRow(argv[2], std::stoi(argv[3]));
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--scan") {
+        return scanTables(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
     if (argc != 2) {
         std::cerr << "Usage: " << argv[0] << " <server_address>" << std::endl;
+        std::cerr << "       " << argv[0] << " --table <routing_table.json> <rows.csv>" << std::endl;
+        std::cerr << "       " << argv[0] << " --get <routing_table.json> <row_index>" << std::endl;
+        std::cerr << "       " << argv[0] << " --scan <routing_table.json> [--node id] [--columns c,c,...] [--limit n] "
+                  << "[<column>=<value> | <column>:<min>..<max> | <column>^<prefix>]..." << std::endl;
         return 1;
     }
 
@@ -45,7 +151,7 @@ int main(int argc, char** argv) {
 
     // Example usage
     DataMessage message;
-    message.set_id("test_id");
+    message.set_id(1);
     message.set_payload("test_payload");
     message.set_timestamp("2024-03-21T12:00:00Z");
 
@@ -55,4 +161,4 @@ int main(int argc, char** argv) {
     }
 
     return 0;
-} 
\ No newline at end of file
+}
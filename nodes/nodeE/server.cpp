@@ -6,11 +6,15 @@
 #include <grpcpp/ext/proto_server_reflection_plugin.h>
 #include "data.grpc.pb.h"
 #include <fstream>
-#include <sstream>
 #include <nlohmann/json.hpp>
 #include <random>
 #include <chrono>
 #include "shared_memory.hpp"
+#include "table_writer.hpp"
+#include "row_index.hpp"
+#include "table_scan.hpp"
+#include "wal.hpp"
+#include "csv_row.hpp"
 #include <vector>
 #include <algorithm>
 #include <cstring>
@@ -18,92 +22,156 @@
 using grpc::Server;
 using grpc::ServerBuilder;
 using grpc::ServerContext;
+using grpc::ServerReader;
+using grpc::ServerWriter;
 using grpc::Status;
 using data::DataService;
 using data::DataMessage;
+using data::DataBatch;
 using data::Empty;
+using data::Row;
+using data::RowRequest;
+using data::RowBatch;
+using data::ScanRequest;
 using json = nlohmann::json;
 
 // Number of columns expected in the local table.
 const int NUM_COLS = 16;
-// Name of the CSV file used to store rows locally for NodeE.
-const std::string LOCAL_TABLE_FILENAME = "nodeE_table.csv";
-
-// Helper: Split a string by a given delimiter.
-std::vector<std::string> splitRow(const std::string& row, char delimiter) {
-    std::vector<std::string> tokens;
-    std::istringstream ss(row);
-    std::string token;
-    while (std::getline(ss, token, delimiter)) {
-        tokens.push_back(token);
-    }
-    return tokens;
-}
-
-// Helper: Append a row (vector of strings) to the CSV file.
-void appendRowToCSV(const std::vector<std::string>& row) {
-    std::ofstream outfile;
-    outfile.open(LOCAL_TABLE_FILENAME, std::ios::app);
-    if (!outfile.is_open()) {
-        std::cerr << "NodeE: Error opening local table file for writing." << std::endl;
-        return;
-    }
-    for (size_t i = 0; i < row.size(); i++) {
-        outfile << row[i];
-        if (i < row.size() - 1)
-            outfile << ",";
-    }
-    outfile << "\n";
-    outfile.close();
-}
+// Name of the table used to store rows locally for NodeE (".csv" or ".seg" is appended).
+const std::string LOCAL_TABLE_NAME = "nodeE_table";
 
 class DataServiceImpl final : public DataService::Service {
 private:
     int message_count_;  // Local counter for messages received.
     SharedMemory shared_memory_;  // Dynamic shared memory instance.
+    // Log of accepted rows; table_, row_index_ and shared_memory_ are applied from it.
+    // Opened before table_ so that recovery can cut the table back to the last checkpoint.
+    WriteAheadLog wal_;
+    // Local table, kept open with default buffering and durability (NodeE has no config.json).
+    TableWriter table_;
+    // Primary index of table_ by row_index, reloaded from its stored runs on startup.
+    RowIndex row_index_;
+    // Answers Scan from table_, with the predicates and projection applied there.
+    TableScanner scanner_;
 
 public:
     DataServiceImpl(const std::string& user_id)
-        : message_count_(0), shared_memory_(user_id) {
+        : message_count_(0), shared_memory_(user_id),
+          wal_(LOCAL_TABLE_NAME, tableFormat(json::object()), "NodeE", json::object()),
+          table_(LOCAL_TABLE_NAME, "NodeE", json::object()),
+          row_index_(table_, "NodeE", json::object()),
+          scanner_(table_, "NodeE", "E", json::object()) {
+        // Replay the rows logged since the last checkpoint, then start logging new ones.
+        shared_memory_.setDurability(sharedMemoryDurability(json::object(), wal_.enabled()));
+        wal_.replay([this](const WalRecord& record) {
+            applyWalRecord(record, true, table_, row_index_, shared_memory_);
+        });
+        std::vector<uint32_t> positions;
+        for (int slot = 0; slot < 4; slot++) {
+            positions.push_back(static_cast<uint32_t>(shared_memory_.messageCount(slot)));
+        }
+        wal_.start(table_, row_index_, positions, [this] { shared_memory_.sync(); });
         std::cout << "NodeE: Server initialized with user ID: " << user_id << std::endl;
     }
 
+    // wal_ outlives table_, so its checkpoints must stop first.
+    ~DataServiceImpl() {
+        wal_.stop();
+    }
+
+private:
+    // Save one row locally and record its index in shared memory.
+    Status storeMessage(const DataMessage& message) {
+        message_count_++;  // Increment local message counter.
+        std::cout << "NodeE: Received data ID " << message.id()
+                  << " (Message #" << message_count_ << ")\n";
+
+        // Save data locally: exactly NUM_COLS columns that view the payload's own bytes.
+        WalRecord record;
+        splitColumns(message.payload(), NUM_COLS, &record.columns);
+
+        // Extract the first field as the row index.
+        if (parseRowIndex(record.columns[0], &record.row_index)) {
+            record.flags |= WAL_INDEXED;
+        } else {
+            record.row_index = 0;
+            std::cerr << "NodeE: Failed to convert first field to integer. Using 0 as index." << std::endl;
+        }
+
+        // Dynamic shared memory: increment the counter and add the row index.
+        record.flags |= WAL_COUNTED;
+        // For NodeE, we use node value 3.
+        record.slot = 3;
+        // Log the row, then save it locally and update shared memory from the log record.
+        wal_.write(&record, [this](const WalRecord& logged) {
+            applyWalRecord(logged, false, table_, row_index_, shared_memory_);
+        });
+
+        std::cout << "NodeE: Data saved locally and row index " << record.row_index
+                  << " stored in shared memory.\n";
+        return Status::OK;
+    }
+
+public:
     Status PushData(ServerContext* context, const DataMessage* request, Empty* reply) override {
         try {
-            message_count_++;  // Increment local message counter.
-            std::cout << "NodeE: Received data ID " << request->id()
-                      << " (Message #" << message_count_ << ")\n";
-            
-            // Save data locally:
-            std::string payload_str = request->payload();
-            std::vector<std::string> columns = splitRow(payload_str, ',');
-            // Ensure there are exactly NUM_COLS columns.
-            if (columns.size() < NUM_COLS) {
-                columns.resize(NUM_COLS, "");
-            } else if (columns.size() > NUM_COLS) {
-                columns.resize(NUM_COLS);
+            return storeMessage(*request);
+        } catch (const std::exception& e) {
+            std::cerr << "NodeE: Error processing message: " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error processing message");
+        }
+    }
+
+    Status PushBatch(ServerContext* context, const DataBatch* request, Empty* reply) override {
+        try {
+            std::cout << "NodeE: Received batch of " << request->messages_size() << " messages\n";
+            for (const auto& message : request->messages()) {
+                storeMessage(message);
             }
-            appendRowToCSV(columns);
-            
-            // Extract the first field as the row index.
-            int row_index = 0;
-            try {
-                row_index = std::stoi(columns[0]);
-            } catch (const std::exception& ex) {
-                std::cerr << "NodeE: Failed to convert first field to integer. Using 0 as index. Error: " << ex.what() << std::endl;
+            return Status::OK;
+        } catch (const std::exception& e) {
+            std::cerr << "NodeE: Error processing batch: " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error processing batch");
+        }
+    }
+
+    Status PushStream(ServerContext* context, ServerReader<DataMessage>* reader, Empty* reply) override {
+        try {
+            int received = 0;
+            DataMessage message;
+            while (reader->Read(&message)) {
+                received++;
+                storeMessage(message);
             }
-            
-            // Update dynamic shared memory:
-            shared_memory_.incrementCounter();
-            // For NodeE, we use node value 3.
-            shared_memory_.addMessageToNode(row_index, 3);
-            
-            std::cout << "NodeE: Data saved locally and row index " << row_index
-                      << " stored in shared memory.\n";
+            std::cout << "NodeE: Stream finished after " << received << " messages\n";
             return Status::OK;
         } catch (const std::exception& e) {
-            std::cerr << "NodeE: Error processing message: " << e.what() << std::endl;
-            return Status(grpc::StatusCode::INTERNAL, "Error processing message");
+            std::cerr << "NodeE: Error processing stream: " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error processing stream");
+        }
+    }
+
+    // NodeE stores every row it receives, so a lookup ends here.
+    Status GetRow(ServerContext* context, const RowRequest* request, Row* reply) override {
+        try {
+            if (!row_index_.get(request->row_index(), reply)) {
+                return Status(grpc::StatusCode::NOT_FOUND,
+                              "No row with index " + std::to_string(request->row_index()));
+            }
+            reply->set_node("E");
+            return Status::OK;
+        } catch (const std::exception& e) {
+            std::cerr << "NodeE: Error looking up row " << request->row_index() << ": " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error looking up row");
+        }
+    }
+
+    Status Scan(ServerContext* context, const ScanRequest* request, ServerWriter<RowBatch>* writer) override {
+        try {
+            return scanner_.scan(context, *request, writer);
+        } catch (const std::exception& e) {
+            std::cerr << "NodeE: Error scanning local table: " << e.what() << std::endl;
+            return Status(grpc::StatusCode::INTERNAL, "Error scanning local table");
         }
     }
 };
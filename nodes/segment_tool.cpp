@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "column_store.hpp"
+#include "row_segment.hpp"
+
+// Converts node tables between CSV and the binary row segment or columnar
+// formats and inspects them:
+//   segment_tool csv2seg <in.csv> <out.seg>   pad/truncate to 16 columns like the nodes
+//   segment_tool seg2csv <in.seg> [out.csv]   write to stdout when no output is given
+//   segment_tool csv2col <in.csv> <out.col> [row_group_rows]
+//   segment_tool col2csv <in.col> [out.csv]
+//   segment_tool scan <in.col> <column>...    print only the given columns (0-based)
+//   segment_tool stats <in.seg|in.col>        rows, bytes, damaged tail; per-column
+//                                             encodings and min/max for columnar tables
+
+// Number of columns the nodes store per row.
+const size_t NUM_COLS = 16;
+
+std::vector<std::string> splitRow(const std::string& line, char delimiter) {
+    std::vector<std::string> columns;
+    size_t start = 0;
+    size_t end;
+    while ((end = line.find(delimiter, start)) != std::string::npos) {
+        columns.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+    columns.push_back(line.substr(start));
+    return columns;
+}
+
+int csvToSegment(const std::string& in_path, const std::string& out_path) {
+    std::ifstream in(in_path);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << in_path << std::endl;
+        return 1;
+    }
+    std::ofstream out(out_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open " << out_path << std::endl;
+        return 1;
+    }
+    std::string buffer = segmentHeader();
+    std::string line;
+    size_t rows = 0;
+    while (std::getline(in, line)) {
+        std::vector<std::string> columns = splitRow(line, ',');
+        columns.resize(NUM_COLS);
+        encodeRow(columns, &buffer);
+        rows++;
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    std::cout << "Wrote " << rows << " rows (" << buffer.size() << " bytes) to " << out_path << std::endl;
+    return out ? 0 : 1;
+}
+
+int csvToColumnar(const std::string& in_path, const std::string& out_path, size_t row_group_rows) {
+    std::ifstream in(in_path);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << in_path << std::endl;
+        return 1;
+    }
+    std::ofstream out(out_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open " << out_path << std::endl;
+        return 1;
+    }
+    std::string buffer = columnarHeader();
+    RowGroupBuilder group;
+    std::string line;
+    size_t rows = 0;
+    while (std::getline(in, line)) {
+        std::vector<std::string> columns = splitRow(line, ',');
+        columns.resize(NUM_COLS);
+        group.add(columns);
+        if (group.rows() >= row_group_rows) {
+            group.encode(&buffer);
+        }
+        rows++;
+    }
+    if (!group.empty()) {
+        group.encode(&buffer);
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    std::cout << "Wrote " << rows << " rows (" << buffer.size() << " bytes) to " << out_path << std::endl;
+    return out ? 0 : 1;
+}
+
+// Print the given columns of every row; only their chunks are read.
+int scanColumnar(const std::string& in_path, const std::vector<size_t>& selected, std::ostream& out) {
+    ColumnarReader reader(in_path);
+    for (const auto& group : reader.groups()) {
+        std::vector<std::vector<std::string>> values(selected.size());
+        for (size_t k = 0; k < selected.size(); k++) {
+            ChunkView chunk;
+            if (selected[k] >= group.columnCount()) {
+                values[k].assign(group.rows(), std::string());
+                continue;
+            }
+            if (!group.chunk(selected[k], &chunk)) {
+                std::cerr << "Damaged chunk for column " << selected[k] << std::endl;
+                return 1;
+            }
+            values[k].reserve(group.rows());
+            chunk.forEach([&](size_t, std::string_view value) { values[k].emplace_back(value); });
+        }
+        for (size_t i = 0; i < group.rows(); i++) {
+            for (size_t k = 0; k < selected.size(); k++) {
+                if (k > 0) {
+                    out << ',';
+                }
+                out << values[k][i];
+            }
+            out << '\n';
+        }
+    }
+    return out ? 0 : 1;
+}
+
+int columnarToCsv(const std::string& in_path, const std::string& out_path) {
+    std::ofstream file;
+    if (!out_path.empty()) {
+        file.open(out_path, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << out_path << std::endl;
+            return 1;
+        }
+    }
+    size_t columns = 0;
+    {
+        ColumnarReader reader(in_path);
+        for (const auto& group : reader.groups()) {
+            columns = std::max(columns, group.columnCount());
+        }
+    }
+    std::vector<size_t> all(columns);
+    for (size_t c = 0; c < columns; c++) {
+        all[c] = c;
+    }
+    return scanColumnar(in_path, all, out_path.empty() ? std::cout : file);
+}
+
+int columnarStats(const std::string& in_path) {
+    ColumnarReader reader(in_path);
+    std::cout << in_path << ": " << reader.rows() << " rows in " << reader.groups().size() << " row groups, "
+              << reader.size() << " bytes" << std::endl;
+    for (size_t g = 0; g < reader.groups().size(); g++) {
+        const RowGroupView& group = reader.groups()[g];
+        std::cout << "group " << g << ": " << group.rows() << " rows" << std::endl;
+        for (size_t c = 0; c < group.columnCount(); c++) {
+            const ColumnMeta& meta = group.meta(c);
+            std::cout << "  column " << c << ": " << columnEncodingName(meta.encoding) << ", " << meta.length
+                      << " bytes";
+            if (meta.stats == COLUMN_STATS_INTEGER) {
+                std::cout << ", min " << meta.min_integer << ", max " << meta.max_integer;
+            } else if (meta.stats == COLUMN_STATS_TEXT) {
+                std::cout << ", min \"" << meta.min_text << "\", max \"" << meta.max_text << "\"";
+            }
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
+
+bool isColumnarFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(COLUMNAR_MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    return file && std::memcmp(magic, COLUMNAR_MAGIC, sizeof(magic)) == 0;
+}
+
+int segmentToCsv(const std::string& in_path, const std::string& out_path) {
+    SegmentReader reader(in_path);
+    std::ofstream file;
+    if (!out_path.empty()) {
+        file.open(out_path, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << out_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = out_path.empty() ? std::cout : file;
+    reader.forEach([&out](const RowView& row) {
+        for (size_t i = 0; i < row.columnCount(); i++) {
+            if (i > 0) {
+                out << ',';
+            }
+            out << row.column(i);
+        }
+        out << '\n';
+    });
+    return out ? 0 : 1;
+}
+
+int segmentStats(const std::string& in_path) {
+    SegmentReader reader(in_path);
+    size_t field_bytes = 0;
+    size_t rows = reader.forEach([&field_bytes](const RowView& row) {
+        for (size_t i = 0; i < row.columnCount(); i++) {
+            field_bytes += row.column(i).size();
+        }
+    });
+    std::cout << in_path << ": " << rows << " rows, " << reader.size() << " bytes, "
+              << field_bytes << " field bytes" << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::string command = argc > 1 ? argv[1] : "";
+    try {
+        if (command == "csv2seg" && argc == 4) {
+            return csvToSegment(argv[2], argv[3]);
+        }
+        if (command == "seg2csv" && (argc == 3 || argc == 4)) {
+            return segmentToCsv(argv[2], argc == 4 ? argv[3] : "");
+        }
+        if (command == "csv2col" && (argc == 4 || argc == 5)) {
+            return csvToColumnar(argv[2], argv[3], argc == 5 ? std::stoul(argv[4]) : DEFAULT_ROW_GROUP_ROWS);
+        }
+        if (command == "col2csv" && (argc == 3 || argc == 4)) {
+            return columnarToCsv(argv[2], argc == 4 ? argv[3] : "");
+        }
+        if (command == "scan" && argc >= 4) {
+            std::vector<size_t> selected;
+            for (int i = 3; i < argc; i++) {
+                selected.push_back(std::stoul(argv[i]));
+            }
+            return scanColumnar(argv[2], selected, std::cout);
+        }
+        if (command == "stats" && argc == 3) {
+            return isColumnarFile(argv[2]) ? columnarStats(argv[2]) : segmentStats(argv[2]);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "Usage: " << argv[0] << " csv2seg <in.csv> <out.seg>" << std::endl;
+    std::cerr << "       " << argv[0] << " seg2csv <in.seg> [out.csv]" << std::endl;
+    std::cerr << "       " << argv[0] << " csv2col <in.csv> <out.col> [row_group_rows]" << std::endl;
+    std::cerr << "       " << argv[0] << " col2csv <in.col> [out.csv]" << std::endl;
+    std::cerr << "       " << argv[0] << " scan <in.col> <column>..." << std::endl;
+    std::cerr << "       " << argv[0] << " stats <in.seg|in.col>" << std::endl;
+    return 1;
+}
@@ -3,17 +3,21 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <cstdint>
 #include <cstring>
+#include <sys/stat.h>
 #include <vector>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
 // The header layout must match the one in shared_memory.hpp.
+const int SHARED_MAX_CHUNKS = 32;
+const int SHARED_LAYOUT = 0x53484d05;
+
 struct SharedDataHeader {
     int counter;
     int last_target;
-    int history_size;
     int b_size;
     int c_size;
     int d_size;
@@ -25,8 +29,39 @@ struct SharedDataHeader {
     int c_capacity;
     int d_capacity;
     int e_capacity;
+    int layout;
+    // Node arrays grow in chunks: chunk k of array n holds first_chunk[n] << k
+    // entries at file offset chunk_offset[n][k]. An entry is a 64-bit word:
+    // the message id in the low half, and a tag that is 0 until it is written.
+    int first_chunk[4];
+    int chunk_count[4];
+    // The history is a ring buffer of 64-bit entries: insert n of
+    // history_count goes to entry n % history_capacity, tagged with its lap
+    // n / history_capacity + 1.
+    int64_t history_count;
+    int64_t chunk_offset[4][SHARED_MAX_CHUNKS];
 };
 
+// Entry `index` of array `node` (0 = B, 1 = C, 2 = D, 3 = E) in the mapped file.
+static uint64_t nodeEntry(const char* base, const SharedDataHeader* header, int node, int index) {
+    int64_t first = header->first_chunk[node];
+    int k = 63 - __builtin_clzll(static_cast<uint64_t>(index / first + 1));
+    const uint64_t* chunk = reinterpret_cast<const uint64_t*>(base + header->chunk_offset[node][k]);
+    return chunk[index - first * ((int64_t(1) << k) - 1)];
+}
+
+// The message ids written to the first `size` entries of array `node`.
+static std::vector<int> nodeMessages(const char* base, const SharedDataHeader* header, int node, int size) {
+    std::vector<int> messages;
+    for (int i = 0; i < size; ++i) {
+        uint64_t word = nodeEntry(base, header, node, i);
+        if ((word >> 32) != 0) {
+            messages.push_back(static_cast<int>(static_cast<uint32_t>(word)));
+        }
+    }
+    return messages;
+}
+
 int main(int argc, char* argv[]) {
     if (argc != 2) {
         std::cerr << "Usage: " << argv[0] << " <user_id>" << std::endl;
@@ -54,13 +89,20 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    // Calculate total size.
-    size_t totalSize = sizeof(SharedDataHeader) +
-        (header.history_capacity + header.b_capacity +
-         header.c_capacity + header.d_capacity +
-         header.e_capacity) * sizeof(int);
+    if (header.layout != SHARED_LAYOUT) {
+        std::cerr << "File has another shared memory layout." << std::endl;
+        close(fd);
+        return 1;
+    }
 
-    // Map the entire file.
+    // Map the entire file, including every chunk the node arrays have grown by.
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "Failed to stat file" << std::endl;
+        close(fd);
+        return 1;
+    }
+    size_t totalSize = st.st_size;
     void* mapped = mmap(nullptr, totalSize, PROT_READ, MAP_SHARED, fd, 0);
     if (mapped == MAP_FAILED) {
         std::cerr << "Failed to map file" << std::endl;
@@ -69,21 +111,20 @@ int main(int argc, char* argv[]) {
     }
 
     SharedDataHeader* headerPtr = static_cast<SharedDataHeader*>(mapped);
-
-    // Get pointers to the dynamic arrays.
     char* base = static_cast<char*>(mapped);
-    int* message_history = reinterpret_cast<int*>(base + sizeof(SharedDataHeader));
-    int* messages_to_b = message_history + headerPtr->history_capacity;
-    int* messages_to_c = messages_to_b + headerPtr->b_capacity;
-    int* messages_to_d = messages_to_c + headerPtr->c_capacity;
-    int* messages_to_e = messages_to_d + headerPtr->d_capacity;
-
-    // Convert arrays to vectors for JSON.
-    std::vector<int> history(message_history, message_history + headerPtr->history_size);
-    std::vector<int> to_b(messages_to_b, messages_to_b + headerPtr->b_size);
-    std::vector<int> to_c(messages_to_c, messages_to_c + headerPtr->c_size);
-    std::vector<int> to_d(messages_to_d, messages_to_d + headerPtr->d_size);
-    std::vector<int> to_e(messages_to_e, messages_to_e + headerPtr->e_size);
+    const uint64_t* message_history = reinterpret_cast<const uint64_t*>(base + sizeof(SharedDataHeader));
+
+    // The history oldest first: the newest history_capacity inserts, skipping
+    // entries whose lap does not match (not written, or already overwritten).
+    std::vector<int> history;
+    int64_t capacity = headerPtr->history_capacity;
+    int64_t count = headerPtr->history_count;
+    for (int64_t insert = count > capacity ? count - capacity : 0; insert < count; ++insert) {
+        uint64_t word = message_history[insert % capacity];
+        if ((word >> 32) == static_cast<uint64_t>(insert / capacity + 1)) {
+            history.push_back(static_cast<int>(static_cast<uint32_t>(word)));
+        }
+    }
 
     // Build JSON for pretty printing.
     json j;
@@ -91,36 +132,21 @@ int main(int argc, char* argv[]) {
     j["last_target"] = headerPtr->last_target;
     j["last_even_id"] = headerPtr->last_even_id;
     j["last_odd_id"] = headerPtr->last_odd_id;
-    j["history_size"] = headerPtr->history_size;
+    j["history_size"] = history.size();
     j["b_size"] = headerPtr->b_size;
     j["c_size"] = headerPtr->c_size;
     j["d_size"] = headerPtr->d_size;
     j["e_size"] = headerPtr->e_size;
 
-    j["message_history"] = json::array();
-    for (int i = 0; i < headerPtr->history_size; ++i) {
-        j["message_history"].push_back(message_history[i]);
-    }
+    j["message_history"] = history;
 
-    j["messages_to_b"] = json::array();
-    for (int i = 0; i < headerPtr->b_size; ++i) {
-        j["messages_to_b"].push_back(messages_to_b[i]);
-    }
+    j["messages_to_b"] = nodeMessages(base, headerPtr, 0, headerPtr->b_size);
 
-    j["messages_to_c"] = json::array();
-    for (int i = 0; i < headerPtr->c_size; ++i) {
-        j["messages_to_c"].push_back(messages_to_c[i]);
-    }
+    j["messages_to_c"] = nodeMessages(base, headerPtr, 1, headerPtr->c_size);
 
-    j["messages_to_d"] = json::array();
-    for (int i = 0; i < headerPtr->d_size; ++i) {
-        j["messages_to_d"].push_back(messages_to_d[i]);
-    }
+    j["messages_to_d"] = nodeMessages(base, headerPtr, 2, headerPtr->d_size);
 
-    j["messages_to_e"] = json::array();
-    for (int i = 0; i < headerPtr->e_size; ++i) {
-        j["messages_to_e"].push_back(messages_to_e[i]);
-    }
+    j["messages_to_e"] = nodeMessages(base, headerPtr, 3, headerPtr->e_size);
 
     std::cout << "\nShared Memory Contents:" << std::endl;
     std::cout << "======================" << std::endl;
@@ -0,0 +1,250 @@
+// Tests of the columnar row group encoding (nodes/common/column_store.hpp):
+// every group must decode back to the rows it was built from.
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "column_store.hpp"
+#include "test_util.hpp"
+
+using Rows = std::vector<std::vector<std::string>>;
+
+const std::string INT64_MIN_TEXT = std::to_string(std::numeric_limits<int64_t>::min());
+const std::string INT64_MAX_TEXT = std::to_string(std::numeric_limits<int64_t>::max());
+
+// A column of `rows` as one row per value.
+Rows singleColumn(const std::vector<std::string>& values) {
+    Rows rows;
+    for (const auto& value : values) {
+        rows.push_back({value});
+    }
+    return rows;
+}
+
+// Encode `rows` as one row group, parse it back and check every value, read
+// row by row, chunk by chunk and, for integer columns, as integers.
+// *encoded keeps the bytes *group points into.
+bool roundTrips(const Rows& rows, std::string* encoded, RowGroupView* group) {
+    RowGroupBuilder builder;
+    for (const auto& row : rows) {
+        builder.add(row);
+    }
+    encoded->clear();
+    builder.encode(encoded);
+    CHECK(builder.empty());
+
+    size_t group_size = 0;
+    if (!RowGroupView::parse(reinterpret_cast<const uint8_t*>(encoded->data()), encoded->size(), group,
+                             &group_size)) {
+        return false;
+    }
+    bool same = group_size == encoded->size() && group->rows() == rows.size();
+    std::vector<std::string> columns;
+    for (size_t i = 0; i < rows.size(); i++) {
+        same = same && group->row(i, &columns) && columns == rows[i];
+    }
+    for (size_t c = 0; c < group->columnCount(); c++) {
+        ChunkView chunk;
+        if (!group->chunk(c, &chunk)) {
+            return false;
+        }
+        chunk.forEach([&](size_t i, std::string_view value) {
+            same = same && value == rows[i][c];
+        });
+        if (chunk.isInteger()) {
+            std::vector<int64_t> values;
+            chunk.integers(&values);
+            for (size_t i = 0; i < rows.size(); i++) {
+                same = same && std::to_string(values[i]) == rows[i][c];
+            }
+        }
+    }
+    return same;
+}
+
+// Encoded chunk of a column in a group built by roundTrips().
+const uint8_t* chunkBytes(const std::string& encoded, const RowGroupView& group, size_t column) {
+    return reinterpret_cast<const uint8_t*>(encoded.data()) + ROW_GROUP_HEADER_SIZE + group.meta(column).offset;
+}
+
+// Bit width a delta chunk packs its deltas at.
+unsigned deltaWidth(const std::string& encoded, const RowGroupView& group, size_t column) {
+    return chunkBytes(encoded, group, column)[8];
+}
+
+// Bit width a dictionary chunk packs its codes at.
+unsigned codeWidth(const std::string& encoded, const RowGroupView& group, size_t column) {
+    const uint8_t* chunk = chunkBytes(encoded, group, column);
+    uint32_t entries = getU32(chunk);
+    uint32_t entry_bytes = getU32(chunk + 4 + 4 * (entries - 1));
+    return chunk[4 + 4 * entries + entry_bytes];
+}
+
+void testParseCanonicalInt() {
+    int64_t value = 0;
+    CHECK(parseCanonicalInt("12", &value) && value == 12);
+    CHECK(parseCanonicalInt("-3", &value) && value == -3);
+    CHECK(parseCanonicalInt("0", &value) && value == 0);
+    CHECK(parseCanonicalInt(INT64_MIN_TEXT, &value) && value == std::numeric_limits<int64_t>::min());
+    CHECK(parseCanonicalInt(INT64_MAX_TEXT, &value) && value == std::numeric_limits<int64_t>::max());
+    // Text that would not print back the same is left to the other encodings.
+    for (const char* text : {"", "007", "+1", "-0", " 1", "1 ", "1a", "-", "9223372036854775808",
+                             "-9223372036854775809", "000000000000000000001"}) {
+        CHECK(!parseCanonicalInt(text, &value));
+    }
+}
+
+// The extremes of int64_t, with deltas between them that wrap around.
+void testIntegerExtremes() {
+    std::string encoded;
+    RowGroupView group;
+    Rows rows = singleColumn({INT64_MIN_TEXT, INT64_MAX_TEXT, "0", INT64_MIN_TEXT, "-1", INT64_MAX_TEXT});
+    CHECK(roundTrips(rows, &encoded, &group));
+    CHECK(group.meta(0).encoding == COLUMN_DELTA);
+    CHECK(group.meta(0).stats == COLUMN_STATS_INTEGER);
+    CHECK(group.meta(0).min_integer == std::numeric_limits<int64_t>::min());
+    CHECK(group.meta(0).max_integer == std::numeric_limits<int64_t>::max());
+
+    // INT64_MIN after 0 is the one delta whose zigzag form needs all 64 bits.
+    rows = singleColumn({"0", INT64_MIN_TEXT, "0"});
+    CHECK(roundTrips(rows, &encoded, &group));
+    CHECK(group.meta(0).encoding == COLUMN_DELTA);
+    CHECK(deltaWidth(encoded, group, 0) == 64);
+}
+
+// Columns whose deltas are all zero, or that have no deltas at all, pack at width 0.
+void testZeroWidthDeltas() {
+    std::string encoded;
+    RowGroupView group;
+    CHECK(roundTrips(singleColumn({"42", "42", "42", "42", "42"}), &encoded, &group));
+    CHECK(group.meta(0).encoding == COLUMN_DELTA);
+    CHECK(deltaWidth(encoded, group, 0) == 0);
+    CHECK(group.meta(0).min_integer == 42 && group.meta(0).max_integer == 42);
+
+    CHECK(roundTrips(singleColumn({INT64_MIN_TEXT}), &encoded, &group));
+    CHECK(group.meta(0).encoding == COLUMN_DELTA);
+    CHECK(deltaWidth(encoded, group, 0) == 0);
+
+    // A steady step of one packs every delta in 2 bits.
+    CHECK(roundTrips(singleColumn({"7", "8", "9", "10", "11"}), &encoded, &group));
+    CHECK(deltaWidth(encoded, group, 0) == 2);
+}
+
+// Integers that do not print back the same stay text.
+void testNonCanonicalIntegers() {
+    std::string encoded;
+    RowGroupView group;
+    CHECK(roundTrips(singleColumn({"1", "007", "+1", "-0", "2"}), &encoded, &group));
+    CHECK(group.meta(0).encoding != COLUMN_DELTA);
+    CHECK(group.meta(0).stats == COLUMN_STATS_TEXT);
+}
+
+// Empty values, in a column of their own and padding rows narrower than the group.
+void testEmptyStrings() {
+    std::string encoded;
+    RowGroupView group;
+    CHECK(roundTrips(singleColumn({"", "", "", ""}), &encoded, &group));
+    CHECK(group.meta(0).encoding == COLUMN_DICTIONARY);
+    CHECK(codeWidth(encoded, group, 0) == 0);
+    CHECK(group.meta(0).min_text.empty() && group.meta(0).max_text.empty());
+
+    CHECK(roundTrips(singleColumn({"", "a", "", "bc", "", "def"}), &encoded, &group));
+    CHECK(group.meta(0).min_text.empty() && group.meta(0).max_text == "def");
+
+    Rows rows = {{"1", "Berlin", "x"}, {"2", "", ""}, {"3", "Paris", ""}};
+    CHECK(roundTrips(rows, &encoded, &group));
+    RowGroupBuilder narrow;
+    narrow.add(std::vector<std::string>{"1"});
+    narrow.add(std::vector<std::string>{"2", "b"});
+    std::vector<std::string> padded;
+    narrow.row(0, &padded);
+    CHECK(padded == std::vector<std::string>({"1", ""}));
+    CHECK(roundTrips({{"1", ""}, {"2", "b"}}, &encoded, &group));
+}
+
+// Dictionaries with one entry fewer than, exactly and one more than a power
+// of two, so the code width is at and just past each step.
+void testDictionaryWidths() {
+    for (size_t entries : {2, 3, 4, 5, 8, 9, 255, 256, 257, 1024, 1025}) {
+        std::vector<std::string> values;
+        for (size_t i = 0; i < 4 * entries; i++) {
+            values.push_back("city-" + std::to_string(i % entries));
+        }
+        std::string encoded;
+        RowGroupView group;
+        CHECK(roundTrips(singleColumn(values), &encoded, &group));
+        CHECK(group.meta(0).encoding == COLUMN_DICTIONARY);
+        CHECK(codeWidth(encoded, group, 0) == bitWidth(entries - 1));
+        CHECK(getU32(chunkBytes(encoded, group, 0)) == entries);
+        CHECK(group.meta(0).min_text == *std::min_element(values.begin(), values.end()));
+        CHECK(group.meta(0).max_text == *std::max_element(values.begin(), values.end()));
+    }
+}
+
+// Mostly distinct text is stored plain, with its min and max in the footer.
+void testPlainStats() {
+    std::vector<std::string> values = {"pear", "apple", "zucchini", "fig", "banana"};
+    std::string encoded;
+    RowGroupView group;
+    CHECK(roundTrips(singleColumn(values), &encoded, &group));
+    CHECK(group.meta(0).encoding == COLUMN_PLAIN);
+    CHECK(group.meta(0).stats == COLUMN_STATS_TEXT);
+    CHECK(group.meta(0).min_text == "apple" && group.meta(0).max_text == "zucchini");
+
+    // A damaged footer is caught by its checksum.
+    size_t footer = ROW_GROUP_HEADER_SIZE + getU32(reinterpret_cast<const uint8_t*>(encoded.data()) + 12);
+    encoded[footer + 1] ^= 1;
+    size_t group_size = 0;
+    CHECK(!RowGroupView::parse(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size(), &group,
+                               &group_size));
+}
+
+// Several groups in a file, each with its own encodings, read back in order.
+void testGroupsInFile() {
+    std::vector<Rows> groups = {
+        {{INT64_MIN_TEXT, "", "a"}, {INT64_MAX_TEXT, "", "a"}},
+        {{"1", "x"}, {"1", "y"}, {"1", "x"}, {"1", "y"}},
+        {{"-0", "text"}},
+    };
+    std::string file = columnarHeader();
+    for (const auto& rows : groups) {
+        RowGroupBuilder builder;
+        for (const auto& row : rows) {
+            builder.add(row);
+        }
+        builder.encode(&file);
+    }
+    std::ofstream("groups.col", std::ios::binary).write(file.data(), file.size());
+
+    ColumnarReader reader("groups.col");
+    CHECK(reader.validEnd() == file.size());
+    CHECK(reader.groups().size() == groups.size());
+    CHECK(reader.rows() == 7);
+    for (size_t g = 0; g < reader.groups().size() && g < groups.size(); g++) {
+        std::vector<std::string> columns;
+        for (size_t i = 0; i < groups[g].size(); i++) {
+            CHECK(reader.groups()[g].row(i, &columns) && columns == groups[g][i]);
+        }
+    }
+}
+
+int main() {
+    enterScratchDirectory("column_store_test");
+    testParseCanonicalInt();
+    testIntegerExtremes();
+    testZeroWidthDeltas();
+    testNonCanonicalIntegers();
+    testEmptyStrings();
+    testDictionaryWidths();
+    testPlainStats();
+    testGroupsInFile();
+    if (testFailures() > 0) {
+        std::cerr << testFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "column_store_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,231 @@
+// Tests of the row index (nodes/common/row_index.hpp and index_run.hpp):
+// lookups return the newest row stored under a row_index, before and after
+// the node restarts.
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "row_index.hpp"
+#include "test_util.hpp"
+
+// Row `row_index` as stored in round `round`; later rounds replace earlier ones.
+std::vector<std::string> makeRow(int32_t row_index, int round) {
+    return {std::to_string(row_index), "round" + std::to_string(round)};
+}
+
+// Even row_indexes only, so every odd one between them is a miss that falls
+// inside a run's range rather than before or after it.
+const int32_t KEYS = 600;
+
+int32_t keyAt(int32_t i) {
+    return 2 * i;
+}
+
+// What get() answers for every row_index from before the first key to past
+// the last: the row's columns, or nothing.
+std::map<int32_t, std::optional<std::vector<std::string>>> answers(const RowIndex& index) {
+    std::map<int32_t, std::optional<std::vector<std::string>>> result;
+    for (int32_t row_index = -2; row_index <= keyAt(KEYS) + 2; row_index++) {
+        data::Row reply;
+        if (index.get(row_index, &reply)) {
+            result[row_index] = std::vector<std::string>(reply.columns().begin(), reply.columns().end());
+        } else {
+            result[row_index] = std::nullopt;
+        }
+    }
+    return result;
+}
+
+bool fileExists(const std::string& path) {
+    return ::access(path.c_str(), F_OK) == 0;
+}
+
+// Rows are upserted over two checkpoints and then once more without one, so
+// a row_index can have versions in two runs and the memtable at once. get()
+// must return the newest, and return it again once the index is reopened
+// from its runs, and once it is rebuilt from the table alone.
+void testUpsertAcrossFlush() {
+    const std::string name = "upserted";
+    std::map<int32_t, std::vector<std::string>> newest;
+    std::map<int32_t, std::optional<std::vector<std::string>>> before_restart;
+    {
+        TableWriter table(name, "Test", json::object());
+        RowIndex index(table, "Test", 1000, 100);
+        auto store = [&](int32_t row_index, int round) {
+            std::optional<RowLocation> location = table.append(makeRow(row_index, round));
+            CHECK(location.has_value());
+            index.add(row_index, location.value_or(RowLocation()));
+            newest[row_index] = makeRow(row_index, round);
+        };
+        auto checkpoint = [&] {
+            CHECK(index.freeze(table.seal(), true));
+            table.sync();
+            index.flush();
+        };
+        for (int32_t i = 0; i < KEYS; i++) {
+            store(keyAt(i), 0);
+        }
+        checkpoint();
+        // Every other key again, so both runs hold it.
+        for (int32_t i = 0; i < KEYS; i += 2) {
+            store(keyAt(i), 1);
+        }
+        checkpoint();
+        CHECK(fileExists(name + ".run.1") && fileExists(name + ".run.2"));
+        // Every third key once more, left in the memtable.
+        for (int32_t i = 0; i < KEYS; i += 3) {
+            store(keyAt(i), 2);
+        }
+        table.sync();
+
+        before_restart = answers(index);
+        for (const auto& entry : before_restart) {
+            auto it = newest.find(entry.first);
+            if (it == newest.end()) {
+                CHECK(!entry.second.has_value());
+            } else {
+                CHECK(entry.second.has_value() && *entry.second == it->second);
+            }
+        }
+    }
+
+    // Reopened, the index reuses both runs and indexes only the rows stored
+    // after the last checkpoint.
+    {
+        TableWriter table(name, "Test", json::object());
+        RowIndex index(table, "Test", 1000, 100);
+        CHECK(fileExists(name + ".run.1") && fileExists(name + ".run.2"));
+        CHECK(answers(index) == before_restart);
+    }
+
+    // Without "<name>.index" the index is rebuilt from the table, spilling
+    // runs as its small memtable fills, and answers the same.
+    CHECK(std::remove((name + ".index").c_str()) == 0);
+    TableWriter table(name, "Test", json::object());
+    RowIndex index(table, "Test", 100, 100);
+    CHECK(answers(index) == before_restart);
+}
+
+// A run over several blocks finds every row_index it holds, at and around
+// the block boundaries, and none of those it does not.
+void testRunLookups() {
+    const std::string path = "lookups.run";
+    const int32_t count = 3 * static_cast<int32_t>(RUN_BLOCK_ENTRIES) + 17;
+    auto locationOf = [](int32_t i) {
+        return RowLocation{static_cast<uint32_t>(i % 5), static_cast<uint64_t>(i) * 40, 30};
+    };
+    {
+        IndexRunWriter writer(path, count);
+        for (int32_t i = 0; i < count; i++) {
+            writer.add(keyAt(i) - count, locationOf(i));
+        }
+        writer.finish();
+    }
+    IndexRun run(path);
+    CHECK(run.size() == static_cast<size_t>(count));
+    CHECK(run.verify());
+    for (int32_t i = 0; i < count; i++) {
+        RowLocation location;
+        CHECK(run.mayContain(keyAt(i) - count));
+        CHECK(run.find(keyAt(i) - count, &location) && location == locationOf(i));
+        CHECK(run.rowIndex(i) == keyAt(i) - count && run.location(i) == locationOf(i));
+    }
+    int misses = 0;
+    int filtered = 0;
+    for (int32_t row_index = -count - 10; row_index < count + 10; row_index++) {
+        if (row_index >= -count && row_index < count && (row_index + count) % 2 == 0) {
+            continue;
+        }
+        RowLocation location;
+        CHECK(!run.find(row_index, &location));
+        misses++;
+        filtered += run.mayContain(row_index) ? 0 : 1;
+    }
+    // The filter answers most misses without the fences being searched.
+    CHECK(filtered > misses * 9 / 10);
+
+    // An empty run finds nothing.
+    {
+        IndexRunWriter writer("empty.run", 0);
+        writer.finish();
+    }
+    RowLocation location;
+    CHECK(!IndexRun("empty.run").find(0, &location));
+}
+
+// A damaged block is caught when it is read, a damaged filter or fence when
+// the run is opened, and a run that was never finished is not left behind.
+void testDamagedRun() {
+    const std::string path = "damaged.run";
+    const int32_t count = 2 * static_cast<int32_t>(RUN_BLOCK_ENTRIES);
+    auto write = [&] {
+        IndexRunWriter writer(path, count);
+        for (int32_t i = 0; i < count; i++) {
+            writer.add(i, RowLocation{0, static_cast<uint64_t>(i), 1});
+        }
+        writer.finish();
+    };
+    auto flipByte = [&](long offset) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(offset);
+        char byte = 0;
+        file.get(byte);
+        file.seekp(offset);
+        file.put(static_cast<char>(byte ^ 1));
+    };
+
+    // The last entry of the second block.
+    write();
+    flipByte(RUN_HEADER_SIZE + (count - 1) * RUN_ENTRY_SIZE + 8);
+    {
+        IndexRun run(path);
+        RowLocation location;
+        CHECK(run.find(0, &location) && location.offset == 0);
+        CHECK(!run.verify());
+        bool thrown = false;
+        try {
+            run.find(count - 1, &location);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+
+    // The first row_index of the second block's fence.
+    write();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    long size = static_cast<long>(file.tellg());
+    file.close();
+    flipByte(size - RUN_FOOTER_SIZE - RUN_FENCE_SIZE);
+    bool thrown = false;
+    try {
+        IndexRun run(path);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    {
+        IndexRunWriter writer("unfinished.run", 1);
+        writer.add(1, RowLocation{0, 0, 1});
+    }
+    CHECK(!fileExists("unfinished.run"));
+}
+
+int main() {
+    enterScratchDirectory("row_index_test");
+    testUpsertAcrossFlush();
+    testRunLookups();
+    testDamagedRun();
+    if (testFailures() > 0) {
+        std::cerr << testFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "row_index_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,177 @@
+// Tests of SharedMemory (nodes/nodeC/shared_memory.hpp) shared by several
+// processes and threads, the way Nodes C, D and E use it.
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include "shared_memory.hpp"
+#include "test_util.hpp"
+
+const int PROCESSES = 2;
+const int THREADS = 8;
+const int MESSAGES_PER_THREAD = 20000;
+// Enough inserts to go round the history ring more than once.
+const int HISTORY_PER_THREAD = DEFAULT_HISTORY_CAPACITY / (PROCESSES * THREADS) * 5 / 4;
+
+// Id written by `thread` of `process`, `per_thread` ids apart; never 0, so an
+// entry read before it was written would show up as one.
+int messageId(int process, int thread, int i, int per_thread = MESSAGES_PER_THREAD) {
+    return 1 + (process * THREADS + thread) * per_thread + i;
+}
+
+// Run write(shared_memory, process, thread) on eight threads in each of two
+// child processes sharing file `name`, and call read() over and over from
+// this process until they are done.
+void runWriters(const std::string& name, std::function<void(SharedMemory&, int, int)> write,
+                std::function<void()> read) {
+    std::vector<pid_t> children;
+    for (int process = 0; process < PROCESSES; process++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            SharedMemory shared_memory(name);
+            shared_memory.setDurability(SharedMemoryDurability::None);
+            std::vector<std::thread> threads;
+            for (int thread = 0; thread < THREADS; thread++) {
+                threads.emplace_back([&shared_memory, &write, process, thread] {
+                    write(shared_memory, process, thread);
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            _exit(0);
+        }
+        children.push_back(pid);
+    }
+
+    std::atomic<bool> done{false};
+    std::thread reading([&] {
+        while (!done.load()) {
+            read();
+        }
+    });
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    done = true;
+    reading.join();
+}
+
+// Two processes of eight threads append to one array at once, growing it
+// across several chunks, while a reader keeps listing it.
+void testConcurrentAppends() {
+    SharedMemory reader("appends");
+    // Entries the size covers but that are not written yet must be skipped.
+    std::atomic<int> unwritten_seen{0};
+    runWriters(
+        "appends",
+        [](SharedMemory& shared_memory, int process, int thread) {
+            for (int i = 0; i < MESSAGES_PER_THREAD; i++) {
+                shared_memory.addMessageToNode(messageId(process, thread, i), 1);
+            }
+        },
+        [&] {
+            for (int id : reader.messagesTo(1)) {
+                if (id == 0) {
+                    unwritten_seen++;
+                }
+            }
+        });
+    CHECK(unwritten_seen.load() == 0);
+
+    int total = PROCESSES * THREADS * MESSAGES_PER_THREAD;
+    CHECK(reader.messageCount(1) == total);
+    std::vector<int> messages = reader.messagesTo(1);
+    CHECK(static_cast<int>(messages.size()) == total);
+    std::sort(messages.begin(), messages.end());
+    bool every_id_once = true;
+    for (int i = 0; i < static_cast<int>(messages.size()); i++) {
+        every_id_once = every_id_once && messages[i] == i + 1;
+    }
+    CHECK(every_id_once);
+}
+
+// True if `history` holds only written ids and lists each writer's ids in the
+// order it inserted them, i.e. oldest first.
+bool historyInOrder(const std::vector<int>& history) {
+    std::vector<int> last(PROCESSES * THREADS, 0);
+    for (int id : history) {
+        if (id < 1 || id > PROCESSES * THREADS * HISTORY_PER_THREAD) {
+            return false;
+        }
+        int writer = (id - 1) / HISTORY_PER_THREAD;
+        if (id <= last[writer]) {
+            return false;
+        }
+        last[writer] = id;
+    }
+    return true;
+}
+
+// The same writers insert into the history until it wraps, while a reader
+// keeps listing it: every listing is oldest first and has no unwritten entry.
+void testConcurrentHistory() {
+    SharedMemory reader("history");
+    std::atomic<int> bad_listings{0};
+    runWriters(
+        "history",
+        [](SharedMemory& shared_memory, int process, int thread) {
+            for (int i = 0; i < HISTORY_PER_THREAD; i++) {
+                shared_memory.updateMessageHistory(messageId(process, thread, i, HISTORY_PER_THREAD));
+            }
+        },
+        [&] {
+            std::vector<int> history = reader.messageHistory();
+            if (static_cast<int>(history.size()) > DEFAULT_HISTORY_CAPACITY || !historyInOrder(history)) {
+                bad_listings++;
+            }
+        });
+    CHECK(bad_listings.load() == 0);
+
+    // Once the writers are done the ring holds exactly the newest inserts.
+    std::vector<int> history = reader.messageHistory();
+    CHECK(static_cast<int>(history.size()) == DEFAULT_HISTORY_CAPACITY);
+    CHECK(historyInOrder(history));
+    CHECK(reader.toJson()["history_size"] == DEFAULT_HISTORY_CAPACITY);
+}
+
+// Positions stored out of order: the size covers the gap, but only the
+// written entries count, and id 0 is stored like any other.
+void testOutOfOrderPositions() {
+    SharedMemory shared_memory("positions");
+    shared_memory.setDurability(SharedMemoryDurability::None);
+    shared_memory.setMessageAt(2, 5000, 42);
+    CHECK(shared_memory.messageCount(2) == 5001);
+    CHECK(shared_memory.hasMessageAt(2, 5000));
+    CHECK(!shared_memory.hasMessageAt(2, 4999));
+    CHECK(!shared_memory.hasMessageAt(2, 0));
+    CHECK(shared_memory.messagesTo(2) == std::vector<int>({42}));
+
+    shared_memory.setMessageAt(2, 4999, 0);
+    CHECK(shared_memory.hasMessageAt(2, 4999));
+    CHECK(shared_memory.messagesTo(2) == std::vector<int>({0, 42}));
+
+    // Storing the same id at the same position again changes nothing.
+    shared_memory.setMessageAt(2, 5000, 42);
+    CHECK(shared_memory.messageCount(2) == 5001);
+    CHECK(shared_memory.messagesTo(2) == std::vector<int>({0, 42}));
+    CHECK(shared_memory.toJson()["messages_to_d"] == json::array({0, 42}));
+}
+
+int main() {
+    enterScratchDirectory("shared_memory_test");
+    testConcurrentAppends();
+    testConcurrentHistory();
+    testOutOfOrderPositions();
+    if (testFailures() > 0) {
+        std::cerr << testFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "shared_memory_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,289 @@
+// Tests of TableWriter (nodes/common/table_writer.hpp): storing, reading,
+// compacting, rolling back and reopening a node's local table.
+
+#include <chrono>
+#include <csignal>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "table_writer.hpp"
+#include "test_util.hpp"
+
+std::vector<std::string> makeRow(int row_index) {
+    return {std::to_string(row_index), "value" + std::to_string(row_index)};
+}
+
+// Row `row_index` as stored in round `round`; later rounds replace earlier ones.
+std::vector<std::string> makeRow(int row_index, int round) {
+    return {std::to_string(row_index), "round" + std::to_string(round)};
+}
+
+bool fileExists(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+// The newest location of each row_index, kept the way RowIndex keeps it:
+// replaced rows are reported to the table, and compaction asks through the
+// hooks which rows are current and where they moved.
+class LatestRows {
+private:
+    std::mutex mutex_;
+    std::map<std::string, RowLocation> latest_;
+    size_t moves_ = 0;
+
+public:
+    void attach(TableWriter& table) {
+        table.setRowIndexHooks(
+            [this](std::string_view first_column, const RowLocation& location) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = latest_.find(std::string(first_column));
+                return it != latest_.end() && it->second == location;
+            },
+            [this](std::string_view first_column, const RowLocation& from, const RowLocation& to) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = latest_.find(std::string(first_column));
+                if (it == latest_.end() || !(it->second == from)) {
+                    return false;
+                }
+                it->second = to;
+                moves_++;
+                return true;
+            });
+    }
+
+    void stored(TableWriter& table, const std::string& row_index, const RowLocation& location) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = latest_.find(row_index);
+        if (it != latest_.end()) {
+            table.superseded(it->second);
+        }
+        latest_[row_index] = location;
+    }
+
+    std::map<std::string, RowLocation> snapshot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return latest_;
+    }
+
+    size_t moves() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return moves_;
+    }
+};
+
+bool readsBack(TableWriter& table, const RowLocation& location, int row_index) {
+    std::vector<std::string> columns;
+    return table.read(location, &columns) && columns == makeRow(row_index);
+}
+
+// Under "batch" a row whose group cannot be written is reported as not
+// stored, and the rows after it still land where their locations say. The
+// write is made to fail by a file size limit, which tears the group.
+void testBatchWriteFailure() {
+    std::vector<RowLocation> locations;
+    {
+        TableWriter table("batch_table", "Test", TableFormat::Segment, Durability::Batch, 1 << 20, 3600000);
+        for (int row_index = 0; row_index < 10; row_index++) {
+            std::optional<RowLocation> location = table.append(makeRow(row_index));
+            CHECK(location.has_value());
+            locations.push_back(location.value_or(RowLocation()));
+        }
+
+        signal(SIGXFSZ, SIG_IGN);
+        rlimit original;
+        getrlimit(RLIMIT_FSIZE, &original);
+        rlimit limited = original;
+        limited.rlim_cur = table.seal().offset + 4;
+        setrlimit(RLIMIT_FSIZE, &limited);
+        CHECK(!table.append(makeRow(10)).has_value());
+        setrlimit(RLIMIT_FSIZE, &original);
+
+        std::optional<RowLocation> location = table.append(makeRow(11));
+        CHECK(location.has_value());
+        locations.push_back(location.value_or(RowLocation()));
+        for (int i = 0; i < 10; i++) {
+            CHECK(readsBack(table, locations[i], i));
+        }
+        CHECK(readsBack(table, locations[10], 11));
+    }
+
+    // The failed row was written with the next group, so the file holds
+    // every row, whole.
+    TableWriter table("batch_table", "Test", TableFormat::Segment, Durability::Batch, 1 << 20, 3600000);
+    std::vector<std::string> first_columns;
+    table.forEachRow([&](const RowLocation&, std::string_view first_column) {
+        first_columns.emplace_back(first_column);
+    });
+    CHECK(first_columns.size() == 12);
+    CHECK(!first_columns.empty() && first_columns.back() == "11");
+    CHECK(readsBack(table, locations[10], 11));
+}
+
+// Small segments full of replaced rows are merged, keeping only the newest
+// row of each row_index, and the index follows the rows that moved.
+void testCompaction(TableFormat format) {
+    const std::string name = std::string("compacted_") + tableFormatName(format);
+    const int keys = 10;
+    const int rounds = 6;
+    const int segment_bytes = 256;
+    LatestRows latest;
+    std::map<std::string, std::vector<std::string>> newest;
+    size_t segments_before = 0;
+    {
+        TableWriter table(name, "Test", format, Durability::Periodic, 1 << 16, 10, 4, 10, segment_bytes, 10, 0);
+        latest.attach(table);
+        auto store = [&](const std::vector<std::string>& row) {
+            std::optional<RowLocation> location = table.append(row);
+            CHECK(location.has_value());
+            latest.stored(table, row[0], location.value_or(RowLocation()));
+            newest[row[0]] = row;
+        };
+        // The last round replaces only the even row_indexes, so the odd ones
+        // stay newest in segments that are mostly dead.
+        for (int round = 0; round < rounds; round++) {
+            for (int row_index = 0; row_index < keys; row_index++) {
+                if (round < rounds - 1 || row_index % 2 == 0) {
+                    store(makeRow(row_index, round));
+                }
+            }
+        }
+        // Rows stored once, so the newest rows above are sealed and must be moved.
+        for (int row_index = keys; row_index < 4 * keys; row_index++) {
+            store(makeRow(row_index));
+        }
+        table.sync();
+        segments_before = table.segmentCount();
+        CHECK(segments_before > 3);
+
+        table.compactBefore(std::numeric_limits<uint32_t>::max());
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while ((table.segmentCount() >= segments_before - 1 || latest.moves() == 0) &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        table.stopCompaction();
+        CHECK(table.segmentCount() < segments_before - 1);
+        CHECK(latest.moves() > 0);
+
+        std::vector<std::string> columns;
+        for (const auto& entry : latest.snapshot()) {
+            CHECK(table.read(entry.second, &columns) && columns == newest[entry.first]);
+        }
+    }
+
+    // Reopened, the table holds fewer rows than were stored, and the last
+    // row seen for each row_index is the newest one, where the index says.
+    TableWriter table(name, "Test", format, Durability::Periodic, 1 << 16, 10, 4, 10, segment_bytes, 0, 0);
+    std::map<std::string, RowLocation> last_seen;
+    size_t visited = table.forEachRow([&](const RowLocation& location, std::string_view first_column) {
+        last_seen[std::string(first_column)] = location;
+    });
+    CHECK(visited < static_cast<size_t>(keys * rounds));
+    CHECK(last_seen == latest.snapshot());
+    std::vector<std::string> columns;
+    for (const auto& entry : last_seen) {
+        CHECK(table.read(entry.second, &columns) && columns == newest[entry.first]);
+    }
+    TableManifest manifest(name, format);
+    CHECK(manifest.segments().size() == table.segmentCount());
+    for (const auto& entry : manifest.segments()) {
+        CHECK(fileExists(entry.file));
+    }
+    for (const auto& file : manifest.unlistedFiles()) {
+        CHECK(!fileExists(file));
+    }
+}
+
+// Rolling a table back to a position in an earlier segment drops the
+// segments started after it, cuts that one back, and the table reopens
+// with exactly the rows before the position and takes new ones after them.
+void testRollBackAcrossRollover() {
+    const std::string name = "rolled_back";
+    const int segment_bytes = 256;
+    TablePosition position;
+    std::vector<std::string> dropped_files;
+    {
+        TableWriter table(name, "Test", TableFormat::Segment, Durability::Periodic, 1 << 16, 10, 4, 10,
+                          segment_bytes, 0, 0);
+        for (int row_index = 0; row_index < 30; row_index++) {
+            CHECK(table.append(makeRow(row_index)).has_value());
+        }
+        position = table.seal();
+        for (int row_index = 30; row_index < 100; row_index++) {
+            CHECK(table.append(makeRow(row_index)).has_value());
+        }
+        table.sync();
+    }
+    {
+        TableManifest manifest(name, TableFormat::Segment);
+        CHECK(manifest.segments().size() > 2);
+        for (const auto& entry : manifest.segments()) {
+            if (entry.id > position.segment) {
+                dropped_files.push_back(entry.file);
+            }
+        }
+        CHECK(!dropped_files.empty());
+    }
+
+    rollBackTable(name, "Test", TableFormat::Segment, position);
+    TableManifest manifest(name, TableFormat::Segment);
+    CHECK(!manifest.segments().empty() && manifest.segments().back().id == position.segment);
+    for (const auto& file : dropped_files) {
+        CHECK(!fileExists(file));
+    }
+    {
+        TableWriter table(name, "Test", TableFormat::Segment, Durability::Periodic, 1 << 16, 10, 4, 10,
+                          segment_bytes, 0, 0);
+        std::vector<std::string> first_columns;
+        table.forEachRow([&](const RowLocation&, std::string_view first_column) {
+            first_columns.emplace_back(first_column);
+        });
+        CHECK(first_columns.size() == 30);
+        CHECK(!first_columns.empty() && first_columns.back() == "29");
+        TablePosition end = table.seal();
+        CHECK(end.segment == position.segment && end.offset == position.offset);
+
+        // New rows go after the position, in segments the manifest lists.
+        std::vector<RowLocation> locations;
+        for (int row_index = 100; row_index < 140; row_index++) {
+            std::optional<RowLocation> location = table.append(makeRow(row_index));
+            CHECK(location.has_value());
+            locations.push_back(location.value_or(RowLocation()));
+        }
+        table.sync();
+        CHECK(locations.front().segment == position.segment && locations.front().offset == position.offset);
+        for (size_t i = 0; i < locations.size(); i++) {
+            CHECK(readsBack(table, locations[i], 100 + static_cast<int>(i)));
+        }
+    }
+    TableWriter table(name, "Test", TableFormat::Segment, Durability::Periodic, 1 << 16, 10, 4, 10,
+                      segment_bytes, 0, 0);
+    std::vector<std::string> first_columns;
+    table.forEachRow([&](const RowLocation&, std::string_view first_column) {
+        first_columns.emplace_back(first_column);
+    });
+    CHECK(first_columns.size() == 70);
+    CHECK(!first_columns.empty() && first_columns.back() == "139");
+    CHECK(TableManifest(name, TableFormat::Segment).segments().size() == table.segmentCount());
+}
+
+int main() {
+    enterScratchDirectory("table_writer_test");
+    testBatchWriteFailure();
+    testCompaction(TableFormat::Segment);
+    testCompaction(TableFormat::Columnar);
+    testRollBackAcrossRollover();
+    if (testFailures() > 0) {
+        std::cerr << testFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "table_writer_test passed" << std::endl;
+    return 0;
+}
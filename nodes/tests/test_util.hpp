@@ -0,0 +1,36 @@
+#ifndef TEST_UTIL_HPP
+#define TEST_UTIL_HPP
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Failed checks are counted here; a test program exits non-zero if any failed.
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition      \
+                      << std::endl;                                                        \
+            testFailures()++;                                                              \
+        }                                                                                  \
+    } while (0)
+
+// Run the test in a fresh directory "<tmp>/node", as a node runs in its own
+// directory; Nodes C, D and E keep their shared memory file one level up.
+inline void enterScratchDirectory(const std::string& test_name) {
+    std::string root = "/tmp/" + test_name + ".XXXXXX";
+    if (mkdtemp(&root[0]) == nullptr || mkdir((root + "/node").c_str(), 0755) != 0 ||
+        chdir((root + "/node").c_str()) != 0) {
+        std::cerr << "Failed to create a scratch directory under /tmp" << std::endl;
+        std::exit(1);
+    }
+}
+
+#endif // TEST_UTIL_HPP
@@ -0,0 +1,155 @@
+// Tests of replaying the write-ahead log (nodes/common/wal.hpp) into shared
+// memory after a crash.
+
+#include <csignal>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "csv_row.hpp"
+#include "shared_memory.hpp"
+#include "wal.hpp"
+#include "test_util.hpp"
+
+const std::string TABLE_NAME = "replay_table";
+const int SLOT = 2;
+
+// Periodic checkpoints are pushed out of the way so only replay runs.
+json walConfig() {
+    return json{{"checkpoint_interval_ms", 3600000}};
+}
+
+WalRecord makeRecord(const std::string& payload, int32_t row_index) {
+    WalRecord record;
+    splitColumns(payload, 3, &record.columns);
+    record.row_index = row_index;
+    record.flags = WAL_INDEXED | WAL_COUNTED;
+    record.slot = SLOT;
+    return record;
+}
+
+// Rows are applied after leaving the log's lock, so a crash can find a later
+// position applied and an earlier one not. Replay must apply the earlier one
+// even though the array size already covers it.
+void testReplayFillsEarlierPosition() {
+    pid_t pid = fork();
+    if (pid == 0) {
+        SharedMemory shared_memory("replay");
+        WriteAheadLog wal(TABLE_NAME, tableFormat(json::object()), "Test", walConfig());
+        TableWriter table(TABLE_NAME, "Test", json::object());
+        RowIndex index(table, "Test", json::object());
+        wal.replay([&](const WalRecord& record) {
+            applyWalRecord(record, true, table, index, shared_memory);
+        });
+        wal.start(table, index, {0, 0, 0, 0}, [&] { shared_memory.sync(); });
+
+        // The first row is logged at position 0, but its writer "crashes"
+        // before applying it; the second, at position 1, is applied.
+        WalRecord first = makeRecord("10,a,b", 10);
+        wal.write(&first, [](const WalRecord&) {});
+        WalRecord second = makeRecord("11,c,d", 11);
+        wal.write(&second, [&](const WalRecord& logged) {
+            applyWalRecord(logged, false, table, index, shared_memory);
+        });
+        _exit(first.position == 0 && second.position == 1 ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    SharedMemory shared_memory("replay");
+    CHECK(shared_memory.messageCount(SLOT) == 2);
+    CHECK(!shared_memory.hasMessageAt(SLOT, 0));
+
+    WriteAheadLog wal(TABLE_NAME, tableFormat(json::object()), "Test", walConfig());
+    TableWriter table(TABLE_NAME, "Test", json::object());
+    RowIndex index(table, "Test", json::object());
+    size_t replayed = wal.replay([&](const WalRecord& record) {
+        applyWalRecord(record, true, table, index, shared_memory);
+    });
+    CHECK(replayed == 2);
+    CHECK(shared_memory.hasMessageAt(SLOT, 0));
+    CHECK(shared_memory.messagesTo(SLOT) == std::vector<int>({10, 11}));
+    // The second row's counter update is not applied twice.
+    CHECK(shared_memory.getCounter() == 2);
+    wal.stop();
+}
+
+// A group that cannot be written fails as a whole and is cut off the log
+// again, so every row acknowledged before or after it replays. The write is
+// made to fail by a file size limit, which tears the record it stops in.
+void testFailedWriteIsNotAcknowledged() {
+    const std::string table_name = "limited_table";
+    const rlim_t limit = 4096;
+    int acknowledged_pipe[2];
+    CHECK(pipe(acknowledged_pipe) == 0);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(acknowledged_pipe[0]);
+        SharedMemory shared_memory("limited");
+        WriteAheadLog wal(table_name, tableFormat(json::object()), "Test", walConfig());
+        TableWriter table(table_name, "Test", json{{"table_flush_interval_ms", 3600000}});
+        RowIndex index(table, "Test", json::object());
+        wal.start(table, index, {}, [&] { shared_memory.sync(); });
+
+        signal(SIGXFSZ, SIG_IGN);
+        rlimit original;
+        getrlimit(RLIMIT_FSIZE, &original);
+        rlimit limited = original;
+        limited.rlim_cur = limit;
+        setrlimit(RLIMIT_FSIZE, &limited);
+        int failures = 0;
+        for (int32_t row_index = 0; row_index < 1000; row_index++) {
+            if (row_index == 500) {
+                setrlimit(RLIMIT_FSIZE, &original);
+            }
+            std::string payload = std::to_string(row_index) + ",some,columns";
+            WalRecord record = makeRecord(payload, row_index);
+            record.slot = -1;
+            try {
+                wal.write(&record, [&](const WalRecord& logged) {
+                    applyWalRecord(logged, false, table, index, shared_memory);
+                });
+                CHECK(write(acknowledged_pipe[1], &row_index, sizeof(row_index)) == sizeof(row_index));
+            } catch (const std::exception&) {
+                failures++;
+            }
+        }
+        _exit(failures > 0 && failures < 500 ? 0 : 1);
+    }
+    close(acknowledged_pipe[1]);
+    std::vector<int32_t> acknowledged;
+    int32_t row_index;
+    while (read(acknowledged_pipe[0], &row_index, sizeof(row_index)) == sizeof(row_index)) {
+        acknowledged.push_back(row_index);
+    }
+    close(acknowledged_pipe[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    SharedMemory shared_memory("limited");
+    WriteAheadLog wal(table_name, tableFormat(json::object()), "Test", walConfig());
+    TableWriter table(table_name, "Test", json::object());
+    RowIndex index(table, "Test", json::object());
+    std::vector<int32_t> replayed;
+    wal.replay([&](const WalRecord& record) {
+        replayed.push_back(record.row_index);
+        applyWalRecord(record, true, table, index, shared_memory);
+    });
+    CHECK(!acknowledged.empty() && acknowledged.back() == 999);
+    CHECK(replayed == acknowledged);
+    wal.stop();
+}
+
+int main() {
+    enterScratchDirectory("wal_replay_test");
+    testReplayFillsEarlierPosition();
+    testFailedWriteIsNotAcknowledged();
+    if (testFailures() > 0) {
+        std::cerr << testFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "wal_replay_test passed" << std::endl;
+    return 0;
+}
@@ -41,6 +41,15 @@ echo "Building shared memory viewer..."
 cd "$ORIGINAL_DIR"
 g++ -std=c++11 -I/opt/homebrew/include -o nodes/shared_memory_viewer nodes/shared_memory_viewer.cpp
 
+# Build routing hash micro-benchmark
+echo "Building routing hash benchmark..."
+g++ -std=c++17 -O2 -I/opt/homebrew/include -I/opt/homebrew/opt/openssl/include -Inodes/common \
+    -o nodes/hash_bench nodes/hash_bench.cpp -L/opt/homebrew/opt/openssl/lib -lcrypto
+
+# Build row segment tool
+echo "Building row segment tool..."
+g++ -std=c++17 -O2 -Inodes/common -o nodes/segment_tool nodes/segment_tool.cpp
+
 # Generate Python protobuf files for Node A
 echo "Generating Python protobuf files for Node A..."
 cd "$ORIGINAL_DIR"
@@ -3,11 +3,44 @@
 # Store the original directory
 ORIGINAL_DIR="$(pwd)"
 
-# Remove old CSV files from node directories
+# Remove old tables (CSV, row segment and columnar, with their segment files and manifests), their
+# row index runs and their write-ahead logs from node directories
 rm -f "$ORIGINAL_DIR/nodes/nodeB/nodeB_table.csv"
+rm -f "$ORIGINAL_DIR/nodes/nodeB/nodeB_table.seg"
+rm -f "$ORIGINAL_DIR/nodes/nodeB/nodeB_table.col"
+rm -f "$ORIGINAL_DIR/nodes/nodeB/nodeB_table.0"*
+rm -f "$ORIGINAL_DIR/nodes/nodeB/nodeB_table.manifest"
+rm -f "$ORIGINAL_DIR/nodes/nodeB/nodeB_table.index"
+rm -f "$ORIGINAL_DIR/nodes/nodeB/nodeB_table.run."*
+rm -f "$ORIGINAL_DIR/nodes/nodeB/nodeB_table.wal."*
+rm -f "$ORIGINAL_DIR/nodes/nodeB/nodeB_table.checkpoint"
 rm -f "$ORIGINAL_DIR/nodes/nodeC/nodeC_table.csv"
+rm -f "$ORIGINAL_DIR/nodes/nodeC/nodeC_table.seg"
+rm -f "$ORIGINAL_DIR/nodes/nodeC/nodeC_table.col"
+rm -f "$ORIGINAL_DIR/nodes/nodeC/nodeC_table.0"*
+rm -f "$ORIGINAL_DIR/nodes/nodeC/nodeC_table.manifest"
+rm -f "$ORIGINAL_DIR/nodes/nodeC/nodeC_table.index"
+rm -f "$ORIGINAL_DIR/nodes/nodeC/nodeC_table.run."*
+rm -f "$ORIGINAL_DIR/nodes/nodeC/nodeC_table.wal."*
+rm -f "$ORIGINAL_DIR/nodes/nodeC/nodeC_table.checkpoint"
 rm -f "$ORIGINAL_DIR/nodes/nodeD/nodeD_table.csv"
+rm -f "$ORIGINAL_DIR/nodes/nodeD/nodeD_table.seg"
+rm -f "$ORIGINAL_DIR/nodes/nodeD/nodeD_table.col"
+rm -f "$ORIGINAL_DIR/nodes/nodeD/nodeD_table.0"*
+rm -f "$ORIGINAL_DIR/nodes/nodeD/nodeD_table.manifest"
+rm -f "$ORIGINAL_DIR/nodes/nodeD/nodeD_table.index"
+rm -f "$ORIGINAL_DIR/nodes/nodeD/nodeD_table.run."*
+rm -f "$ORIGINAL_DIR/nodes/nodeD/nodeD_table.wal."*
+rm -f "$ORIGINAL_DIR/nodes/nodeD/nodeD_table.checkpoint"
 rm -f "$ORIGINAL_DIR/nodes/nodeE/nodeE_table.csv"
+rm -f "$ORIGINAL_DIR/nodes/nodeE/nodeE_table.seg"
+rm -f "$ORIGINAL_DIR/nodes/nodeE/nodeE_table.col"
+rm -f "$ORIGINAL_DIR/nodes/nodeE/nodeE_table.0"*
+rm -f "$ORIGINAL_DIR/nodes/nodeE/nodeE_table.manifest"
+rm -f "$ORIGINAL_DIR/nodes/nodeE/nodeE_table.index"
+rm -f "$ORIGINAL_DIR/nodes/nodeE/nodeE_table.run."*
+rm -f "$ORIGINAL_DIR/nodes/nodeE/nodeE_table.wal."*
+rm -f "$ORIGINAL_DIR/nodes/nodeE/nodeE_table.checkpoint"
 
 
 # Remove old shared memory files